@@ -12,6 +12,10 @@ namespace ez_arch {
     STEP,
     STEP_STAGE,
     RUN,
+    CONTINUE,
+    REVERSE_CONTINUE,
+    BACK,
+    SEEK,
     REGISTERS,
     REGISTER,
     MEMORY,
@@ -19,8 +23,20 @@ namespace ez_arch {
     DISASSEMBLE,
     ASSEMBLE,
     WATCH,
+    BREAK,
+    DELETE,
     SAVE,
     LOAD_STATE,
+    SWEEP,
+    SAMPLE,
+    TIME_PARALLEL,
+    VERIFY,
+    TRACE,
+    CACHE_SIM,
+    SHARE,
+    HASH,
+    RUN_CACHE,
+    LOOP_CHECK,
     RESET,
     QUIT,
     UNKNOWN
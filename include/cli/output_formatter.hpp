@@ -1,6 +1,7 @@
 # pragma once 
 
 #include "core/cpu.hpp"
+#include "core/elf_loader.hpp"
 #include "core/register_file.hpp"
 #include "core/memory.hpp"
 #include <string>
@@ -13,6 +14,7 @@ namespace ez_arch {
     static void print_registers(const RegisterFile& regs,
         std::optional<register_id_t> reg = std::nullopt);
     static void print_memory(const Memory& mem, address_t start, address_t end);
-    static void print_cpu_state(const CPU& cpu);
+    // Names PC after a symbol when `symbols` covers it
+    static void print_cpu_state(const CPU& cpu, const SymbolTable* symbols = nullptr);
   };
 } // ez_arch
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "cpu.hpp"
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+
+namespace ez_arch {
+
+// Posted by an AsyncRun to whoever drives it
+struct RunNotification {
+    uint64_t instructions = 0;  // Retired by this run so far
+    address_t pc = 0;
+    bool finished = false;      // Last notification of the run
+    std::exception_ptr error;   // On the last one, if the runner threw
+};
+
+// A run on a worker thread, started by CPU::run_async or around any runner
+// that executes a bounded number of instructions (TimeTravel::run, say).
+//
+// The worker calls the runner `notify_interval` instructions at a time. After
+// each call it updates the progress counters and posts a notification, but
+// only once the consumer has taken the previous one: a slow event loop finds
+// one current notification rather than a backlog, and the worker never waits
+// on it. The final notification always gets through, carrying the exception
+// if the runner threw one; the run ends there.
+//
+// Until finished(), the CPU belongs to the worker; the owner may only use the
+// counters, poll(), cancel() and wait(). Destroying the handle cancels the run
+// and waits for it.
+class AsyncRun {
+public:
+    // Executes at most n instructions and returns how many it did; fewer than
+    // n means it stopped (halt, stop request, breakpoint) and ends the run
+    using Runner = std::function<uint64_t(uint64_t)>;
+
+    static constexpr uint64_t DEFAULT_NOTIFY_INTERVAL = 1000000;
+
+    // Throws std::invalid_argument if notify_interval is zero
+    AsyncRun(CPU& cpu, Runner runner, uint64_t max_instructions = CPU::UNLIMITED,
+             uint64_t notify_interval = DEFAULT_NOTIFY_INTERVAL);
+    ~AsyncRun();
+
+    AsyncRun(const AsyncRun&) = delete;
+    AsyncRun& operator=(const AsyncRun&) = delete;
+
+    // Stop at the next taken branch or jump (see CPU::request_stop)
+    void cancel();
+    // Block until the worker is done; the CPU is the caller's again after this
+    void wait();
+
+    bool finished() const { return m_finished.load(std::memory_order_acquire); }
+    bool cancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+    // As of the last completed chunk
+    uint64_t instructions() const { return m_instructions.load(std::memory_order_relaxed); }
+    address_t pc() const { return m_pc.load(std::memory_order_relaxed); }
+
+    // Next notification, if any; from one consumer thread only
+    bool poll(RunNotification& notification) { return m_notifications.pop(notification); }
+
+private:
+    CPU& m_cpu;
+    Runner m_runner;
+    uint64_t m_maxInstructions;
+    uint64_t m_notifyInterval;
+
+    std::atomic<uint64_t> m_instructions;
+    std::atomic<address_t> m_pc;
+    std::atomic<bool> m_finished;
+    std::atomic<bool> m_cancelled;
+    // Holds at most one progress notification plus the final one
+    SpscQueue<RunNotification, 4> m_notifications;
+
+    std::thread m_worker;  // Last, so it starts after everything above
+
+    void work();
+};
+
+} // namespace ez_arch
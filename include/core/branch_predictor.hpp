@@ -0,0 +1,55 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace ez_arch {
+
+enum class PredictorType {
+    NOT_TAKEN,  // Always predict fall-through
+    BTFN,       // Backward taken, forward not taken
+    ONE_BIT,    // Table of last outcomes indexed by PC
+    TWO_BIT     // Table of 2-bit saturating counters indexed by PC
+};
+
+constexpr std::string_view predictorTypeToString(PredictorType type) {
+  switch (type) {
+    case PredictorType::NOT_TAKEN: return "not-taken";
+    case PredictorType::BTFN: return "btfn";
+    case PredictorType::ONE_BIT: return "1bit";
+    case PredictorType::TWO_BIT: return "2bit";
+    default: return "unknown";
+  };
+}
+
+std::optional<PredictorType> parsePredictorType(std::string_view name);
+
+class BranchPredictor {
+public:
+    explicit BranchPredictor(PredictorType type, size_t table_entries = 1024);
+
+    bool predict(address_t pc, address_t target) const;
+    void update(address_t pc, bool taken);
+
+    // Predict, train and count one conditional branch. Returns true if the
+    // prediction was correct.
+    bool resolve(address_t pc, address_t target, bool taken);
+    void reset();
+
+    PredictorType type() const { return m_type; }
+    uint64_t branches() const { return m_branches; }
+    uint64_t mispredictions() const { return m_mispredictions; }
+
+private:
+    PredictorType m_type;
+    std::vector<uint8_t> m_table;
+    uint64_t m_branches;
+    uint64_t m_mispredictions;
+
+    size_t index(address_t pc) const { return (pc >> 2) & (m_table.size() - 1); }
+};
+
+} // namespace ez_arch
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "types.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ez_arch {
+
+// PC breakpoints, checked after every instruction of a run.
+//
+// Addresses are kept in a two-level bitmap laid out like Memory's page table:
+// a directory indexed by the top 10 PC bits, tables by the next 10, and a
+// 1024-bit word bitmap per page. contains() is two loads and a bit test, and
+// stops at the first null level, so PCs on pages without breakpoints cost a
+// load or two whatever the number of breakpoints.
+class Breakpoints {
+public:
+    Breakpoints() = default;
+    Breakpoints(const Breakpoints&) = delete;
+    Breakpoints& operator=(const Breakpoints&) = delete;
+
+    // False if already set. Throws std::invalid_argument unless addr is word
+    // aligned.
+    bool add(address_t addr);
+    // False if not set
+    bool remove(address_t addr);
+    void clear();
+
+    bool contains(address_t pc) const {
+      const Table* table = m_directory[pc >> DIRECTORY_SHIFT].get();
+      if (!table) return false;
+      const PageBits* page = table->pages[(pc >> PAGE_SHIFT) & INDEX_MASK].get();
+      if (!page) return false;
+      size_t word = (pc >> 2) & INDEX_MASK;
+      return ((*page)[word >> 6] >> (word & 63)) & 1;
+    }
+
+    // Ascending
+    const std::vector<address_t>& addresses() const { return m_addresses; }
+    size_t size() const { return m_addresses.size(); }
+    bool empty() const { return m_addresses.empty(); }
+
+private:
+    static constexpr unsigned PAGE_SHIFT = 12;
+    static constexpr unsigned INDEX_BITS = 10;
+    static constexpr unsigned DIRECTORY_SHIFT = PAGE_SHIFT + INDEX_BITS;
+    static constexpr address_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+    using PageBits = std::array<uint64_t, (1u << INDEX_BITS) / 64>;
+    struct Table {
+        std::array<std::unique_ptr<PageBits>, 1u << INDEX_BITS> pages;
+    };
+
+    std::array<std::unique_ptr<Table>, 1u << INDEX_BITS> m_directory;
+    std::vector<address_t> m_addresses;
+};
+
+} // namespace ez_arch
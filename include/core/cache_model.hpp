@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ez_arch {
+
+struct CacheConfig {
+    size_t size_bytes = 4096;
+    size_t line_bytes = 16;
+    size_t associativity = 1;
+};
+
+// Set-associative, write-allocate cache with LRU replacement. Only tags are
+// modelled; data always comes from Memory.
+class CacheModel {
+public:
+    explicit CacheModel(const CacheConfig& config);
+
+    bool access(address_t addr);  // Returns true on hit
+    void reset();
+
+    size_t num_sets() const { return m_numSets; }
+    size_t set_index(address_t addr) const { return (addr >> m_lineShift) & (m_numSets - 1); }
+    const CacheConfig& config() const { return m_config; }
+
+    uint64_t accesses() const { return m_hits + m_misses; }
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+    double miss_rate() const;
+
+private:
+    static constexpr uint64_t INVALID_TAG = ~0ULL;
+
+    CacheConfig m_config;
+    size_t m_numSets;
+    unsigned m_lineShift;
+
+    // Tags per set, most recently used first
+    std::vector<uint64_t> m_tags;
+
+    uint64_t m_hits;
+    uint64_t m_misses;
+};
+
+} // namespace ez_arch
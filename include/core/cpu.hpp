@@ -4,12 +4,19 @@
 #include "memory.hpp"
 #include "instruction.hpp"
 #include "alu.hpp"
+#include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 
 namespace ez_arch {
 
+class AsyncRun;
+class LoopDetector;
+
 enum class ExecutionStage {
     FETCH,
     DECODE,
@@ -94,9 +101,61 @@ public:
     
     // Execution control
     void load_program(const std::vector<word_t>& program);
+    // Raw big-endian bytes at address 0, PC 0
+    void load_image(const uint8_t* data, size_t size);
+    static constexpr uint64_t UNLIMITED = UINT64_MAX;
+
     void step(); // Execute one instruction
-    void run();  // Execute until halt
+    // Execute until halt, until max_instructions have completed, or until a
+    // stop is requested; returns the instructions completed
+    uint64_t run(uint64_t max_instructions = UNLIMITED);
     void reset();
+
+    // Safe to call from a signal handler or another thread. A run notices it at
+    // the next taken branch or jump and returns; straight-line code always ends
+    // in a halt, so that is enough to stop any program. Stays set until
+    // clear_stop(), so later runs return at once too.
+    void request_stop() { m_stop.requested.store(true, std::memory_order_relaxed); }
+    bool stop_requested() const { return m_stop.requested.load(std::memory_order_relaxed); }
+    void clear_stop() { m_stop.requested.store(false, std::memory_order_relaxed); }
+
+    // Let run() halt once it gets into a cycle that can never end: the same
+    // state at two backward branches (see LoopDetector). Off by default; costs
+    // a page rehash per written page every few dozen backward branches. The
+    // search carries over from one run() to the next, so a run split into
+    // chunks finds the same cycles as one long run. reset(), restore(),
+    // loading and turning detection on or off start it over, and so does
+    // restart_loop_detection(), which is needed after editing registers or
+    // memory between runs. Copies and forks start afresh.
+    void set_loop_detection(bool enabled) {
+      m_detectLoops = enabled;
+      restart_loop_detection();
+    }
+    bool loop_detection() const { return m_detectLoops; }
+    void restart_loop_detection() { m_loops.detector.reset(); }
+    // Set when run() halted on such a cycle; PC is at the loop's branch target
+    bool loop_detected() const { return m_loopDetected; }
+
+    // run() on a worker thread, reporting progress every notify_interval
+    // instructions (see AsyncRun, in async_run.hpp). Nothing else may touch
+    // this CPU until the run has finished.
+    std::unique_ptr<AsyncRun> run_async(uint64_t max_instructions = UNLIMITED,
+                                        uint64_t notify_interval = 1000000);
+
+    // Copy-on-write copies: memory pages stay shared with this CPU until either
+    // side writes them, everything else is copied. A snapshot is a frozen state
+    // that any number of CPUs can restore; fork() is a runnable child. Neither
+    // carries the stage callback.
+    struct Snapshot;
+    std::shared_ptr<const Snapshot> snapshot();
+    void restore(const Snapshot& snapshot);
+    CPU fork();
+
+    // Remember the current state; restore_baseline() returns to it, copying
+    // back only the memory pages written since. reset() and restore() drop it.
+    void save_baseline();
+    bool restore_baseline();  // False if no baseline was saved
+    bool has_baseline() const { return m_baseline != nullptr; }
     
     // Step-by-step execution (for educational purposes)
     ExecutionStage get_current_stage() const { return m_currentStage; }
@@ -108,6 +167,22 @@ public:
     const Memory& get_memory() const { return m_memory; }
     Memory& get_memory() { return m_memory; }
     bool is_halted() const { return m_halted; }
+    // Instructions completed since reset; clocked devices count time in these
+    uint64_t get_instruction_count() const { return m_instructionCount; }
+
+    // Set when an access faulted; the CPU halts with PC on the faulting instruction
+    bool is_faulted() const { return m_fault.has_value(); }
+    const std::optional<MemoryFault>& get_fault() const { return m_fault; }
+
+    // Latches of the instruction in flight
+    const PipelineRegisters& get_pipeline() const { return m_pipeline; }
+    word_t get_current_instruction() const { return m_currentInstruction.get_raw(); }
+
+    // Overwrite everything but registers and memory, for a CPU that mirrors
+    // another one (see SharedStateSubscriber) or restores a saved result
+    void set_control_state(ExecutionStage stage, bool halted, uint64_t instruction_count,
+                           word_t current_instruction, const PipelineRegisters& pipeline,
+                           const std::optional<MemoryFault>& fault, bool loop_detected = false);
     
     // Callbacks for visualization
     using StageCallback = std::function<void(ExecutionStage)>;
@@ -120,12 +195,41 @@ private:
     Instruction m_currentInstruction;
     ExecutionStage m_currentStage;
     bool m_halted;
+    std::optional<MemoryFault> m_fault;
+    uint64_t m_instructionCount;
+    bool m_detectLoops;
+    bool m_loopDetected;
     
     StageCallback m_stageCallback;
     
     PipelineRegisters m_pipeline;
 
+    // Copies and forks start without a pending stop
+    struct StopFlag {
+        std::atomic<bool> requested{false};
+        StopFlag() = default;
+        StopFlag(const StopFlag&) {}
+        StopFlag& operator=(const StopFlag&) { return *this; }
+    };
+    StopFlag m_stop;
+
+    // The detector refers to this CPU, so copies and moves do not take it
+    struct LoopSearch {
+        std::shared_ptr<LoopDetector> detector;  // Built by the first run() that needs it
+        LoopSearch() = default;
+        LoopSearch(const LoopSearch&) {}
+        LoopSearch& operator=(const LoopSearch&) {
+          detector.reset();
+          return *this;
+        }
+    };
+    LoopSearch m_loops;
+
+    std::shared_ptr<const Snapshot> m_baseline;  // Shared by copies of this CPU
+    uint64_t m_baselineEpoch;
+
     void clear_pipeline();
+    void raise_fault(const MemoryFault& fault);
     ControlSignals generate_control_signals(uint8_t opcode);
     ALUOperation alu_control(uint8_t ALUOp, uint8_t funct);
 
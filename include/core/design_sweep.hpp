@@ -0,0 +1,42 @@
+#pragma once
+
+#include "timing_model.hpp"
+#include "trace.hpp"
+#include <ostream>
+#include <vector>
+
+namespace ez_arch {
+
+// Axes of a design-space grid. Cache sizes and associativities apply to both
+// the instruction and the data cache.
+struct SweepGrid {
+    std::vector<size_t> cache_sizes = {1024, 4096, 16384};
+    std::vector<size_t> associativities = {1, 2, 4};
+    std::vector<PredictorType> predictors = {PredictorType::NOT_TAKEN,
+                                             PredictorType::TWO_BIT};
+    std::vector<bool> forwarding = {true, false};
+    size_t line_bytes = 16;
+};
+
+struct SweepResult {
+    TimingConfig config;
+    TimingStats stats;
+};
+
+// Replays one recorded trace through many timing models in parallel, so the
+// functional simulator only runs once per program.
+class DesignSweep {
+public:
+    static std::vector<TimingConfig> make_configs(const SweepGrid& grid);
+
+    // threads == 0 uses std::thread::hardware_concurrency(). Results keep the
+    // order of configs.
+    static std::vector<SweepResult> run(const std::vector<TraceRecord>& trace,
+                                        const std::vector<TimingConfig>& configs,
+                                        unsigned threads = 0);
+
+    static void write_csv(std::ostream& out, const std::vector<SweepResult>& results);
+    static void write_json(std::ostream& out, const std::vector<SweepResult>& results);
+};
+
+} // namespace ez_arch
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstdint>
+#include <memory>
+
+namespace ez_arch {
+
+class Memory;
+
+// A memory-mapped device. Memory routes every access inside a mapped range
+// here, with the address made relative to the start of the range. Word
+// offsets are always aligned; Memory raises MemoryFault before calling in.
+class Device {
+public:
+    virtual ~Device() = default;
+
+    virtual word_t read_word(address_t offset) = 0;
+    virtual void write_word(address_t offset, word_t value) = 0;
+
+    // Byte accesses default to the containing word, using big-endian lanes
+    virtual uint8_t read_byte(address_t offset);
+    virtual void write_byte(address_t offset, uint8_t value);
+
+    // Called from Memory::reset()
+    virtual void reset() {}
+
+    // Clocked devices are ticked by the CPU after every instruction, with the
+    // memory they are mapped into and the instruction count
+    virtual bool clocked() const { return false; }
+    virtual void tick(Memory& /*memory*/, uint64_t /*cycle*/) {}
+    // True while the device has work in flight that later ticks will finish
+    virtual bool busy() const { return false; }
+
+    // Copies and forks of a Memory call clone() for their own instance.
+    // Null (the default) shares this device, which suits output sinks such
+    // as a display; devices holding per-machine state return a copy.
+    virtual std::shared_ptr<Device> clone() const { return nullptr; }
+};
+
+} // namespace ez_arch
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "device.hpp"
+#include <cstdint>
+
+namespace ez_arch {
+
+struct DmaConfig {
+    uint64_t setup_cycles = 8;     // Fixed cost of every transfer
+    uint64_t bytes_per_cycle = 4;  // Sustained copy rate
+};
+
+// Memory-mapped DMA controller. The guest writes SRC, DST and LEN, then
+// writes START to CONTROL. The CPU keeps executing while the transfer is in
+// flight; the copy lands in memory once its modeled latency has elapsed, at
+// which point STATUS reads DONE. Register offsets from the base:
+//
+//   0x00 SRC       0x04 DST       0x08 LEN (bytes)
+//   0x0C CONTROL   write START to begin, ACK to clear DONE/ERROR
+//   0x10 STATUS    BUSY | DONE | ERROR
+//   0x14 TRAFFIC_LO, 0x18 TRAFFIC_HI: bytes read plus bytes written so far
+class DmaDevice : public Device {
+public:
+    // Last page of the address space, reachable from $zero
+    static constexpr address_t DEFAULT_BASE = 0xFFFFF000;
+
+    enum Register : address_t {
+        SRC = 0x00,
+        DST = 0x04,
+        LEN = 0x08,
+        CONTROL = 0x0C,
+        STATUS = 0x10,
+        TRAFFIC_LO = 0x14,
+        TRAFFIC_HI = 0x18
+    };
+
+    static constexpr word_t START = 0x1;
+    static constexpr word_t ACK = 0x2;
+
+    static constexpr word_t BUSY = 0x1;
+    static constexpr word_t DONE = 0x2;
+    static constexpr word_t ERROR = 0x4;  // Source or destination faulted
+
+    explicit DmaDevice(const DmaConfig& config = DmaConfig());
+
+    word_t read_word(address_t offset) override;
+    void write_word(address_t offset, word_t value) override;
+    void reset() override;
+
+    bool clocked() const override { return true; }
+    void tick(Memory& memory, uint64_t cycle) override;
+    bool busy() const override { return (m_status & BUSY) != 0; }
+    std::shared_ptr<Device> clone() const override;
+
+    // Statistics since reset
+    uint64_t transfers() const { return m_transfers; }
+    uint64_t bytes_read() const { return m_bytesRead; }
+    uint64_t bytes_written() const { return m_bytesWritten; }
+    uint64_t busy_cycles() const { return m_busyCycles; }
+
+private:
+    DmaConfig m_config;
+
+    word_t m_src;
+    word_t m_dst;
+    word_t m_len;
+    word_t m_status;
+
+    // Latched at START
+    word_t m_activeSrc;
+    word_t m_activeDst;
+    word_t m_activeLen;
+    uint64_t m_doneAt;
+
+    uint64_t m_now;  // Cycle of the last tick
+    uint64_t m_transfers;
+    uint64_t m_bytesRead;
+    uint64_t m_bytesWritten;
+    uint64_t m_busyCycles;
+
+    void start();
+};
+
+} // namespace ez_arch
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ez_arch {
+
+struct Symbol {
+    std::string name;
+    address_t address;
+    uint32_t size;  // 0 when the object file did not record one
+};
+
+// Function and object symbols sorted by address, for naming PCs in profiles
+// and CPU state output.
+class SymbolTable {
+public:
+    SymbolTable() = default;
+    explicit SymbolTable(std::vector<Symbol> symbols);
+
+    // The symbol covering addr: [address, address + size), or up to the next
+    // symbol when size is 0. Null if none does.
+    const Symbol* find(address_t addr) const;
+    // "name" or "name+0x10"; empty if no symbol covers addr
+    std::string describe(address_t addr) const;
+    // The first symbol called name; null if none is
+    const Symbol* lookup(const std::string& name) const;
+
+    size_t size() const { return m_symbols.size(); }
+    bool empty() const { return m_symbols.empty(); }
+
+private:
+    std::vector<Symbol> m_symbols;
+};
+
+struct ElfProgram {
+    address_t entry = 0;
+    size_t segments = 0;        // PT_LOAD segments mapped
+    uint64_t file_bytes = 0;    // Segment bytes backed by the file
+    SymbolTable symbols;
+};
+
+// Loader for 32-bit big-endian MIPS ELF executables.
+//
+// The file is mmap'd and every PT_LOAD segment is mapped into memory with
+// Memory::map_image, so a page is only copied out of the file the first time
+// the program touches it. Loading a multi-megabyte binary costs a header walk
+// plus the pages the run actually uses. Bytes past p_filesz read as zero.
+class ElfLoader {
+public:
+    // Cheap magic check; false for unreadable files
+    static bool is_elf(const std::string& path);
+
+    // Reset `cpu`, map the executable's segments and point PC at e_entry.
+    // Throws std::runtime_error for unreadable or malformed files and for
+    // segments that do not fit in memory, before `cpu` is touched.
+    static ElfProgram load(const std::string& path, CPU& cpu);
+};
+
+} // namespace ez_arch
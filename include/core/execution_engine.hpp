@@ -0,0 +1,49 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace ez_arch {
+
+// A way of executing instructions on a CPU. CPU::step() is the reference
+// interpreter; every other engine must leave the architectural state exactly
+// as repeated step() calls would, which LockstepVerifier checks.
+class ExecutionEngine {
+public:
+    virtual ~ExecutionEngine() = default;
+
+    virtual std::string_view name() const = 0;
+
+    // Execute until max_instructions have retired or the CPU halts; returns
+    // the instructions retired. Fetching the halt word retires nothing, so
+    // it takes a budget of one more to observe it.
+    virtual uint64_t run(CPU& cpu, uint64_t max_instructions) = 0;
+
+    // "step", "stage" or "run"; throws std::invalid_argument otherwise
+    static std::unique_ptr<ExecutionEngine> create(std::string_view name);
+};
+
+// CPU::step(), one instruction at a time: the reference
+class StepEngine : public ExecutionEngine {
+public:
+    std::string_view name() const override { return "step"; }
+    uint64_t run(CPU& cpu, uint64_t max_instructions) override;
+};
+
+// The stage-accurate path: step_stage() until the instruction completes
+class StageEngine : public ExecutionEngine {
+public:
+    std::string_view name() const override { return "stage"; }
+    uint64_t run(CPU& cpu, uint64_t max_instructions) override;
+};
+
+// CPU::run(), with its stop-request and loop checks at taken branches
+class RunEngine : public ExecutionEngine {
+public:
+    std::string_view name() const override { return "run"; }
+    uint64_t run(CPU& cpu, uint64_t max_instructions) override { return cpu.run(max_instructions); }
+};
+
+} // namespace ez_arch
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "device.hpp"
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ez_arch {
+
+// Memory-mapped framebuffer. One word per pixel in 0x00RRGGBB form, row-major
+// from the base address. Pixels are kept as RGBA bytes so a viewer can upload
+// them to a texture as-is, and every write marks its row dirty so only the
+// changed rows need uploading.
+//
+// Writes and taking dirty rows share a lock, so a viewer can pick up changed
+// rows while another thread runs the guest (see the copying
+// take_dirty_rows()); pixels() and row_pixels() are only for when no run is
+// in flight.
+struct RowSpan {
+    unsigned first;
+    unsigned count;
+};
+
+class FramebufferDevice : public Device {
+public:
+    // Reachable from $zero with a negative 16-bit offset
+    static constexpr address_t DEFAULT_BASE = 0xFFFF8000;
+    static constexpr unsigned DEFAULT_WIDTH = 64;
+    static constexpr unsigned DEFAULT_HEIGHT = 64;
+
+    // Throws std::invalid_argument for an empty size
+    FramebufferDevice(unsigned width = DEFAULT_WIDTH, unsigned height = DEFAULT_HEIGHT);
+
+    word_t read_word(address_t offset) override;
+    void write_word(address_t offset, word_t value) override;
+    void reset() override;
+
+    unsigned width() const { return m_width; }
+    unsigned height() const { return m_height; }
+    // Mapped size, rounded up to whole pages
+    uint64_t mapped_size() const;
+
+    // RGBA bytes, width * height * 4
+    const uint8_t* pixels() const { return m_pixels.data(); }
+    const uint8_t* row_pixels(unsigned row) const { return &m_pixels[row * m_width * 4]; }
+
+    // Hand out and clear the rows written since the last call, as runs of
+    // adjacent rows in order. Empty when nothing changed.
+    std::vector<RowSpan> take_dirty_rows();
+    // Same, also copying those rows' pixels into `rows`, span after span,
+    // under the lock the guest's writes take
+    std::vector<RowSpan> take_dirty_rows(std::vector<uint8_t>& rows);
+
+private:
+    unsigned m_width;
+    unsigned m_height;
+    std::mutex m_mutex;  // Guards the pixels and dirty rows
+    std::vector<uint8_t> m_pixels;
+    std::vector<bool> m_dirtyRows;
+    bool m_dirty;  // Any bit set in m_dirtyRows
+
+    std::vector<RowSpan> take_dirty_rows_locked();
+};
+
+} // namespace ez_arch
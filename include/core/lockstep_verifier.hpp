@@ -0,0 +1,63 @@
+#pragma once
+
+#include "execution_engine.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ez_arch {
+
+enum class VerifyGranularity {
+    INSTRUCTION,  // Compare after every instruction
+    BLOCK,        // After every taken branch or jump
+    INTERVAL      // Every `interval` instructions
+};
+
+struct VerifyConfig {
+    VerifyGranularity granularity = VerifyGranularity::BLOCK;
+    uint64_t interval = 1000;
+    uint64_t max_instructions = CPU::UNLIMITED;
+};
+
+struct StateDifference {
+    std::string location;  // "PC", a register name, a word address, "halted", ...
+    uint64_t expected;     // From the reference
+    uint64_t actual;       // From the engine
+};
+
+struct Divergence {
+    uint64_t instruction;  // Instructions retired before the one that diverged
+    address_t pc;          // Its address and encoding, as the reference ran it
+    word_t word;
+    std::vector<StateDifference> differences;  // Right after it
+};
+
+struct VerifyResult {
+    uint64_t instructions = 0;  // Retired with matching states
+    uint64_t comparisons = 0;
+    bool halted = false;
+    std::optional<Divergence> divergence;
+};
+
+// Runs an engine on a CPU in lockstep with the reference interpreter
+// (CPU::step() on a fork) and compares their architectural state: registers,
+// PC, halt and fault flags, instruction count and memory. Memory is compared
+// only in the pages either side wrote since the last comparison, found
+// through dirty epochs. The CPU runs with loop detection off, as step() has
+// none, and gets its setting back afterwards.
+//
+// Coarser comparisons are cheaper but only say which stretch went wrong, so
+// on a mismatch both sides go back to the last checkpoint and repeat it one
+// instruction at a time to find the exact instruction. The CPU is left right
+// after it, as the engine ran it, or at the end of a clean run.
+class LockstepVerifier {
+public:
+    static constexpr size_t MAX_MEMORY_DIFFERENCES = 16;
+    static constexpr uint64_t CHECKPOINT_INTERVAL = 100000;
+
+    // Throws std::invalid_argument for an INTERVAL of 0
+    static VerifyResult run(CPU& cpu, ExecutionEngine& engine, const VerifyConfig& config);
+};
+
+} // namespace ez_arch
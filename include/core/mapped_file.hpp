@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace ez_arch {
+
+// Whole file as read-only bytes: mmap'd where available, read into memory
+// otherwise. The pointer owns the mapping, so aliasing pointers into it keep
+// the file mapped. Throws std::runtime_error for missing, unreadable or empty
+// files.
+std::shared_ptr<const uint8_t> map_file(const std::string& path, size_t& size);
+
+} // namespace ez_arch
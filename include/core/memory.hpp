@@ -1,34 +1,305 @@
 #pragma once
 
 #include "types.hpp"
+#include "device.hpp"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
 #include <vector>
 
 namespace ez_arch {
 
+// Raised for guest accesses outside the memory size or misaligned word
+// accesses. The CPU turns it into a halt instead of touching host memory.
+class MemoryFault : public std::runtime_error {
+public:
+    enum class Kind { OUT_OF_RANGE, MISALIGNED };
+
+    MemoryFault(Kind kind, address_t addr);
+
+    Kind kind() const { return m_kind; }
+    address_t address() const { return m_addr; }
+
+private:
+    Kind m_kind;
+    address_t m_addr;
+};
+
+// Sparse guest memory. The 32-bit address space is split into 4KB pages held
+// in a two-level table; a page is only allocated on its first write, and reads
+// of untouched pages see a shared zero page.
+//
+// Pages store aligned words in host byte order, so word access is a single
+// load or store. The guest is big-endian: byte access selects the matching
+// lane of the containing word.
+//
+// Every page entry is always valid: addresses past size() map to guard
+// entries, so lookups need no range check. Entries carry trap bits instead,
+// and the fast path only tests those (plus alignment) before the access.
+// Trapped accesses take the slow path, which allocates pages and raises
+// MemoryFault for out-of-range or misaligned addresses.
+//
+// Watchpoints use the same traps. Pages overlapping a watch carry a watch
+// trap with the write trap (and the read trap for read watches), which
+// page_for_write keeps set, so accesses to other pages cost nothing extra.
+// Only accesses that reach the slow path on a watched page are looked up in
+// the sorted watch list.
+//
+// Dirty tracking reuses the write trap: begin_epoch() write-protects every
+// resident page, and the first write to a page afterwards stamps it with the
+// epoch. Only touched pages are ever visited, so rolling back to a baseline
+// costs nothing for memory the program never wrote.
+//
+// fork() returns a copy-on-write copy: both memories share every page and
+// keep its write trap set, and whichever side writes a shared page first
+// takes a private copy. Copy construction still copies every page.
+//
+// Devices are mapped at page granularity. Their page entries carry a device
+// trap and an index into the device list, so RAM accesses never compare
+// against device ranges: the trap test they already make covers devices too.
+// Copies and forks clone devices that model machine state and share the rest
+// (see Device::clone).
+//
+// map_image() backs whole pages with a read-only image (typically an mmap'd
+// file) and marks them with a lazy trap; the first access of any kind copies
+// the page in. Copying in does not change contents, so const readers do it
+// too, and one Memory must not be read from several threads while it still
+// has lazy pages.
+// A watched byte range; the first access to it is recorded as a WatchHit
+struct Watchpoint {
+    address_t start;
+    uint32_t length;
+    bool on_read;  // Reads hit too, not just writes
+};
+
+struct WatchHit {
+    address_t addr;  // Start of the access
+    bool write;
+};
+
 class Memory {
 public:
-    explicit Memory(size_t size = 1024 * 1024) :
-      m_memory(size, 0) {} // Default 1MB
-    
+    static constexpr uint64_t ADDRESS_SPACE_SIZE = 1ULL << 32;
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr unsigned PAGE_SHIFT = 12;
+
+    explicit Memory(uint64_t size = ADDRESS_SPACE_SIZE); // Default full 4GB
+    Memory(const Memory& other);
+    Memory& operator=(const Memory& other);
+    Memory(Memory&& other) noexcept;
+    Memory& operator=(Memory&& other) noexcept;
+
+    // Copy-on-write copy; O(page tables) instead of O(resident pages)
+    Memory fork();
+
     word_t read_word(address_t addr) const;
     void write_word(address_t addr, word_t value);
-    
+
     uint8_t read_byte(address_t addr) const;
     void write_byte(address_t addr, uint8_t value);
-    
+
     void load_program(const std::vector<word_t>& program, address_t start_addr = 0);
+    // Copy host-order words into memory
+    void load_words(const word_t* words, size_t count, address_t start_addr);
+    // Copy a raw big-endian byte image into memory
+    void load_image(const uint8_t* data, size_t size, address_t start_addr = 0);
+    // Like load_image, but pages wholly inside the range are only copied in on
+    // first touch. `image` is kept alive by every memory that may still need it.
+    void map_image(std::shared_ptr<const uint8_t> image, size_t size, address_t start_addr = 0);
+    // Image pages not copied in yet
+    size_t lazy_pages() const;
     void reset();
-    
-    size_t size() const { return m_memory.size(); }
+
+    // Route [base, base + size) to `device`. Both must be page aligned, inside
+    // memory, and clear of other devices; throws std::invalid_argument.
+    // Mapping replaces any RAM contents in the range.
+    void map_device(address_t base, uint64_t size, std::shared_ptr<Device> device);
+    size_t device_count() const { return m_devices.size(); }
+    // Reads and writes that reached a device, ever, on this object (copies
+    // and moves do not carry it over); unchanged across a run means the run
+    // did not depend on or change device state
+    uint64_t device_accesses() const { return m_deviceAccesses; }
+    bool has_clocked_devices() const { return !m_clockedDevices.empty(); }
+    void tick_devices(uint64_t cycle);
+    bool devices_busy() const;
+    bool is_device(address_t addr) const { return (entry(addr).trap & TRAP_DEVICE) != 0; }
+
+    // memmove-style block copy in page-sized chunks, with no staging buffer;
+    // chunks go through memmove when the addresses and length are word
+    // aligned. Throws MemoryFault.
+    void copy_block(address_t dst, address_t src, uint64_t length);
+
+    // Watch [start, start + length). Throws std::invalid_argument for empty
+    // ranges, ranges outside memory, or overlap with another watch. Watches
+    // stay set across reset(); copies and forks carry them.
+    void add_watch(address_t start, uint32_t length, bool on_read = false);
+    bool remove_watch(address_t start);  // False if no watch starts there
+    void clear_watches();
+    // Drop this memory's watches and take other's, e.g. after restoring state
+    void copy_watches(const Memory& other);
+    const std::vector<Watchpoint>& watches() const { return m_watches; }
+    // First watched access since the last clear; loads, resets and copies
+    // do not count
+    const std::optional<WatchHit>& watch_hit() const { return m_watchHit; }
+    void clear_watch_hit() { m_watchHit.reset(); }
+
+    uint64_t size() const { return m_size; }
+    size_t resident_pages() const { return m_residentPages; }
+    size_t shared_pages() const;
+
+    // Start a new dirty epoch and return it; costs O(pages written in the
+    // last epoch)
+    uint64_t begin_epoch();
+    // Base addresses of pages written since `epoch` began
+    std::vector<address_t> pages_written_since(uint64_t epoch) const;
+    // Copy back from `baseline` only the pages written since `epoch`. This
+    // memory must have matched `baseline` when the epoch began. Starts and
+    // returns a new epoch.
+    uint64_t restore_since(const Memory& baseline, uint64_t epoch);
+
+    // Visit every resident page in no particular order, copying in lazy image
+    // pages first. `words` holds the
+    // page's PAGE_SIZE / 4 words in host order and stays valid until the page
+    // is next written; `epoch` is the page's dirty stamp. Together they
+    // identify a page version.
+    using PageVisitor = std::function<void(address_t base, const word_t* words, uint64_t epoch)>;
+    void for_each_page(const PageVisitor& visit) const;
+    // Same, leaving lazy image pages alone; for_each_image_page() visits those
+    void for_each_resident_page(const PageVisitor& visit) const;
+    // Visit every page still mapped lazily, without copying it in. `bytes` are
+    // the page's PAGE_SIZE big-endian image bytes; they identify the page
+    // version and stay valid while a memory maps the image.
+    using ImagePageVisitor = std::function<void(address_t base, const uint8_t* bytes)>;
+    void for_each_image_page(const ImagePageVisitor& visit) const;
+    // Same, for the resident pages written since `epoch` began
+    void for_each_page_written_since(uint64_t epoch, const PageVisitor& visit) const;
 
     static constexpr size_t BYTE_ACCESS_SIZE = 1;
     static constexpr size_t WORD_ACCESS_SIZE = 4;
-    
+
 private:
-    std::vector<uint8_t> m_memory;
-    
-    void check_alignment(address_t addr) const;
-    void check_bounds(address_t addr, size_t access_size) const;
+    static constexpr unsigned TABLE_BITS = 10;
+    static constexpr size_t TABLE_SIZE = size_t{1} << TABLE_BITS;
+    static constexpr address_t PAGE_OFFSET_MASK = PAGE_SIZE - 1;
+    static constexpr size_t WORDS_PER_PAGE = PAGE_SIZE / WORD_ACCESS_SIZE;
+
+    // Trap bits; TRAP_READ always comes with TRAP_WRITE
+    static constexpr uint8_t TRAP_WRITE = 0x01;  // Zero, clean or shared page, or bounds check
+    static constexpr uint8_t TRAP_READ = 0x02;   // Bounds check needed
+    static constexpr uint8_t TRAP_DEVICE = 0x04; // Mapped device; set with both above
+    static constexpr uint8_t TRAP_LAZY = 0x08;   // Image page not copied in; set with read/write
+    static constexpr uint8_t TRAP_WATCH = 0x10;  // Watched page; set with write, and read if needed
+
+    struct Page {
+        std::array<word_t, WORDS_PER_PAGE> words{};
+        uint64_t epoch = 0;  // Epoch of the last trapped write
+    };
+
+    struct PageEntry {
+        Page* page;    // Never null: a resident page or the shared zero page
+        uint8_t trap;
+        uint16_t index;  // Into m_devices with TRAP_DEVICE, m_images with TRAP_LAZY
+    };
+
+    struct DeviceMapping {
+        address_t base;
+        uint64_t size;
+        std::shared_ptr<Device> device;
+    };
+
+    struct ImageMapping {
+        address_t base;
+        std::shared_ptr<const uint8_t> data;  // Big-endian bytes from base on
+    };
+
+    struct PageTable {
+        std::array<PageEntry, TABLE_SIZE> entries;
+        std::array<std::shared_ptr<Page>, TABLE_SIZE> pages;  // Shared after fork()
+    };
+
+    // Directory indexed by the top 10 address bits, tables by the next 10.
+    // Untouched regions point at the shared empty or guard table.
+    std::array<PageTable*, TABLE_SIZE> m_directory;
+    std::vector<std::unique_ptr<PageTable>> m_ownedTables;
+    std::vector<address_t> m_residentList;  // Base address of every resident page
+    std::vector<DeviceMapping> m_devices;
+    std::vector<size_t> m_clockedDevices;  // Indices into m_devices
+    std::vector<ImageMapping> m_images;
+    std::vector<address_t> m_lazyList;  // Pages mapped lazily; some may be copied in since
+    std::vector<address_t> m_writtenList;  // Pages whose write trap was cleared this epoch
+    uint64_t m_size;
+    size_t m_residentPages;
+    uint64_t m_epoch;
+    std::vector<Watchpoint> m_watches;  // Sorted, non-overlapping
+    mutable std::optional<WatchHit> m_watchHit;
+    mutable uint64_t m_deviceAccesses = 0;
+
+    static Page& zero_page();
+    static PageTable& empty_table();
+    static PageTable& guard_table();
+    static bool is_shared(const PageTable* table) {
+      return table == &empty_table() || table == &guard_table();
+    }
+
+    const PageEntry& entry(address_t addr) const {
+      return m_directory[addr >> (PAGE_SHIFT + TABLE_BITS)]->entries[(addr >> PAGE_SHIFT) & (TABLE_SIZE - 1)];
+    }
+    static size_t word_index(address_t addr) { return (addr & PAGE_OFFSET_MASK) >> 2; }
+    static unsigned byte_shift(address_t addr) { return (3 - (addr & 0x3)) * 8; }
+
+    void build_directory();
+    void assign(const Memory& other, bool share_pages);
+    void write_protect_resident();
+    void apply_device_mapping(size_t index);
+    const DeviceMapping& device_at(address_t addr) const { return m_devices[entry(addr).index]; }
+    uint8_t resident_trap(uint64_t page_start) const;
+    uint8_t watch_trap(uint64_t page_start) const;
+    void refresh_watch_traps(const Watchpoint& watch);
+    void note_access(address_t addr, uint64_t size, bool write) const;
+    PageTable& own_table(address_t addr);
+    PageEntry& owned_entry(address_t addr);
+    Page& writable_page(address_t addr);
+    void release_page(address_t addr);
+    void materialize(address_t addr) const;
+    void materialize_all() const;
+    Page& page_for_write(address_t addr);
+
+    void check_access(address_t addr, size_t access_size, size_t alignment) const;
+    word_t read_word_slow(address_t addr) const;
+    void write_word_slow(address_t addr, word_t value);
+    uint8_t read_byte_slow(address_t addr) const;
+    void write_byte_slow(address_t addr, uint8_t value);
 };
 
+// Hot path: one table walk, one combined trap/alignment test, one access
+
+inline word_t Memory::read_word(address_t addr) const {
+    const PageEntry& e = entry(addr);
+    if ((addr & 0x3) | (e.trap & TRAP_READ)) return read_word_slow(addr);
+    return e.page->words[word_index(addr)];
+}
+
+inline void Memory::write_word(address_t addr, word_t value) {
+    const PageEntry& e = entry(addr);
+    if ((addr & 0x3) | e.trap) return write_word_slow(addr, value);
+    e.page->words[word_index(addr)] = value;
+}
+
+inline uint8_t Memory::read_byte(address_t addr) const {
+    const PageEntry& e = entry(addr);
+    if (e.trap & TRAP_READ) return read_byte_slow(addr);
+    return (e.page->words[word_index(addr)] >> byte_shift(addr)) & 0xFF;
+}
+
+inline void Memory::write_byte(address_t addr, uint8_t value) {
+    const PageEntry& e = entry(addr);
+    if (e.trap) return write_byte_slow(addr, value);
+    word_t& word = e.page->words[word_index(addr)];
+    unsigned shift = byte_shift(addr);
+    word = (word & ~(word_t{0xFF} << shift)) | (static_cast<word_t>(value) << shift);
+}
+
 } // namespace ez_arch
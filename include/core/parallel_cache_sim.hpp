@@ -0,0 +1,33 @@
+#pragma once
+
+#include "cache_model.hpp"
+#include "trace.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ez_arch {
+
+struct CacheSimStats {
+    uint64_t accesses = 0;
+    uint64_t misses = 0;
+    uint64_t fetch_misses = 0;
+    uint64_t load_misses = 0;
+    uint64_t store_misses = 0;
+
+    double miss_rate() const;
+    CacheSimStats& operator+=(const CacheSimStats& other);
+};
+
+// Trace-driven cache simulation split by set index. Sets never interact, so
+// one pass over the trace deals each access to worker (set index modulo the
+// thread count), keeping trace order; each worker replays only its own share
+// and the per-worker statistics are summed at the end.
+// Results are identical to a single CacheModel replaying the whole trace.
+class ParallelCacheSim {
+public:
+    // threads == 0 uses std::thread::hardware_concurrency()
+    static CacheSimStats run(const std::vector<MemoryAccess>& accesses,
+                             const CacheConfig& config, unsigned threads = 0);
+};
+
+} // namespace ez_arch
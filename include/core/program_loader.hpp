@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ez_arch {
+
+struct HexProgram {
+    std::vector<word_t> words;
+    std::vector<std::string> bad_lines;  // Lines with no hex word, skipped
+};
+
+// Program image formats the CLI loads besides ELF (see ElfLoader).
+//
+// Hex programs hold one word per line, optionally 0x-prefixed; blank lines
+// and lines starting with '#' are skipped and anything after the word is
+// ignored. Files are mmap'd and parsed in one pass without per-line strings.
+// Lines that are exactly eight hex digits take a SWAR decoder that converts
+// and validates all eight characters with a handful of 64-bit operations;
+// every other line goes through std::from_chars.
+//
+// Binary images (.bin, .img) are raw big-endian bytes loaded at address 0.
+class ProgramLoader {
+public:
+    // `swar` selects the eight-digit fast path; results are identical
+    static HexProgram parse_hex(std::string_view text, bool swar = true);
+    // Throws std::runtime_error if the file cannot be read
+    static HexProgram read_hex_file(const std::string& path);
+
+    static bool is_binary_image(const std::string& path);
+    // Load the image at address 0 with PC 0, like CPU::load_program; returns
+    // its size in bytes. Throws std::runtime_error or MemoryFault.
+    static size_t load_binary_file(const std::string& path, CPU& cpu);
+};
+
+} // namespace ez_arch
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace ez_arch {
+
+// Results of deterministic runs, memoized on disk so repeating a run restores
+// its final state instead of simulating it again.
+//
+// An entry is keyed by the StateHasher hash of the starting state, which
+// covers the program image along with the rest of memory and the registers,
+// the instruction budget, whether loop detection was on, and ENGINE_VERSION.
+// The key makes up the entry's directory name. The hash is a sum of per-word
+// mixes that can be made to collide, so it only finds the entry: the starting
+// state is stored with it and compared exactly on load, and a mismatch is a
+// miss. An entry is a directory holding the starting and final states as
+// state files (see StateFile) and a small file with the run's counters. It is
+// written under a temporary name and renamed into place in one step, so
+// processes and threads sharing a directory only ever see complete entries;
+// the first entry installed under a key stays.
+//
+// Device state is neither hashed nor saved, so a run is only stored if it
+// never touched a device and none was busy when it started. Loading a result
+// resets devices, like loadstate.
+class RunCache {
+public:
+    // Bump whenever a change to execution could change the result of a run
+    static constexpr uint32_t ENGINE_VERSION = 1;
+
+    struct Key {
+        uint64_t state_hash;
+        uint64_t max_instructions;
+        bool detect_loops;
+        uint64_t start_instruction;  // Not part of the key; results are relative to it
+        uint64_t device_accesses;    // At the start, to tell whether the run used a device
+        std::shared_ptr<const CPU::Snapshot> start;  // Stored with the entry, checked on load
+    };
+
+    // Creates `directory` if needed. Throws std::runtime_error if it cannot.
+    explicit RunCache(std::string directory);
+
+    // Key for running `cpu` from its current state; nullopt if that run
+    // cannot be cached (a device is busy, or the CPU is halted or mid-instruction).
+    // Starts the CPU's loop detection over, so the run that follows does not
+    // depend on earlier ones.
+    std::optional<Key> key(CPU& cpu, uint64_t max_instructions) const;
+
+    // Restore the stored result into `cpu`. False on a miss, including an
+    // entry stored for a different starting state, leaving `cpu` as it was.
+    bool load(const Key& key, CPU& cpu);
+
+    // Store `cpu`'s state as the result of the run `key` was taken before.
+    // Skipped unless the run halted or used its whole budget without touching
+    // a device. Throws std::runtime_error if the entry cannot be written.
+    void store(const Key& key, const CPU& cpu);
+
+    // load(), or else CPU::run() and store(); returns the instructions retired
+    uint64_t run(CPU& cpu, uint64_t max_instructions = CPU::UNLIMITED);
+
+    const std::string& directory() const { return m_directory; }
+    uint64_t hits() const { return m_hits; }
+    uint64_t misses() const { return m_misses; }
+
+private:
+    std::string m_directory;
+    uint64_t m_hits;
+    uint64_t m_misses;
+
+    std::string entry_path(const Key& key) const;  // Without extension
+};
+
+} // namespace ez_arch
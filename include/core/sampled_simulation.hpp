@@ -0,0 +1,39 @@
+#pragma once
+
+#include "timing_model.hpp"
+#include <cstdint>
+
+namespace ez_arch {
+
+class CPU;
+
+// SMARTS-style systematic sampling. Every period starts with a detailed
+// warm-up, then a measured window; the rest of the period is fast-forwarded
+// with plain CPU::step().
+struct SamplingConfig {
+    TimingConfig timing;
+    uint64_t period = 100000;         // Instructions per sampling unit
+    uint64_t warmup = 2000;           // Detailed, unmeasured instructions
+    uint64_t window = 1000;           // Detailed, measured instructions
+    uint64_t max_instructions = 100000000;
+    bool functional_warming = false;  // Keep caches/predictor warm while fast-forwarding
+    double z_score = 1.96;            // 95% confidence
+};
+
+struct SamplingResult {
+    uint64_t instructions = 0;           // Retired in total
+    uint64_t detailed_instructions = 0;  // Run through the timing model
+    uint64_t samples = 0;
+    double mean_cpi = 0.0;
+    double cpi_stddev = 0.0;
+    double estimated_cycles = 0.0;
+    double cycles_error = 0.0;           // Confidence interval half-width
+    bool halted = false;
+};
+
+class SampledSimulator {
+public:
+    static SamplingResult run(CPU& cpu, const SamplingConfig& config);
+};
+
+} // namespace ez_arch
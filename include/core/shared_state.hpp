@@ -0,0 +1,85 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ez_arch {
+
+// Live view of a running CPU through a POSIX shared-memory segment.
+//
+// The segment starts with a header guarded by a sequence lock: the writer
+// makes the sequence odd, updates registers, control state and any changed
+// pages, then makes it even again. Readers copy what they need and retry if
+// the sequence moved underneath them, so the writer never waits on a reader.
+// Memory is published as fixed page slots, each with the sequence number of
+// its last change, so readers only copy pages that changed since their last
+// sync. Both sides must run on the same host (same byte order and layout).
+
+struct SharedStateLayout;
+
+class SharedStatePublisher {
+public:
+    static constexpr size_t DEFAULT_MAX_PAGES = 4096;  // 16MB of guest memory
+
+    // Creates (or replaces) the segment "/<name>". Throws std::runtime_error.
+    explicit SharedStatePublisher(const std::string& name,
+                                  size_t max_pages = DEFAULT_MAX_PAGES);
+    ~SharedStatePublisher();  // Unmaps and unlinks the segment
+
+    SharedStatePublisher(const SharedStatePublisher&) = delete;
+    SharedStatePublisher& operator=(const SharedStatePublisher&) = delete;
+
+    // Publish the CPU's current state. Only pages written since the last
+    // publish are copied; this starts a new dirty epoch on the CPU's memory.
+    // Lazily mapped image pages are published from the image, not copied in.
+    void publish(CPU& cpu);
+
+    // True once a publish found more resident pages than slots
+    bool overflowed() const;
+    const std::string& name() const { return m_name; }
+
+private:
+    struct PublishedPage {
+        const void* source;   // Identity of the published version: page words
+        uint64_t epoch;       // or image bytes, and the page's dirty stamp
+        uint64_t seen;        // Last publish that found the page resident
+    };
+
+    std::string m_name;
+    size_t m_maxPages;
+    size_t m_mappedSize;
+    SharedStateLayout* m_layout;
+
+    std::unordered_map<address_t, uint32_t> m_slots;  // Page base -> slot
+    std::vector<PublishedPage> m_published;           // Indexed by slot
+    uint64_t m_publishCount;
+};
+
+class SharedStateSubscriber {
+public:
+    // Opens the segment "/<name>" read-only. Throws std::runtime_error if it
+    // is missing or was not created by SharedStatePublisher.
+    explicit SharedStateSubscriber(const std::string& name);
+    ~SharedStateSubscriber();
+
+    SharedStateSubscriber(const SharedStateSubscriber&) = delete;
+    SharedStateSubscriber& operator=(const SharedStateSubscriber&) = delete;
+
+    // Copy the published state into `mirror`: registers, control state and
+    // the pages that changed since the last sync. Returns false if nothing
+    // changed, or if the writer kept the lock busy for every retry.
+    bool sync(CPU& mirror);
+
+private:
+    std::string m_name;
+    size_t m_mappedSize;
+    const SharedStateLayout* m_layout;
+
+    uint32_t m_lastSequence;
+    std::vector<uint64_t> m_pageVersions;  // Version applied per slot
+};
+
+} // namespace ez_arch
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace ez_arch {
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread. head and tail only ever grow; each is written by one side
+// and read by the other, so push and pop are a couple of loads and a release
+// store and never block.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    // Producer only; false if full
+    bool push(const T& item) {
+      size_t tail = m_tail.load(std::memory_order_relaxed);
+      if (tail - m_head.load(std::memory_order_acquire) == Capacity) return false;
+      m_slots[tail % Capacity] = item;
+      m_tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer only; false if empty
+    bool pop(T& item) {
+      size_t head = m_head.load(std::memory_order_relaxed);
+      if (head == m_tail.load(std::memory_order_acquire)) return false;
+      item = m_slots[head % Capacity];
+      m_head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Either side; may be stale by the other side's concurrent operation
+    bool empty() const {
+      return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> m_slots{};
+    alignas(64) std::atomic<size_t> m_head{0};  // Next slot to pop
+    alignas(64) std::atomic<size_t> m_tail{0};  // Next slot to push
+};
+
+} // namespace ez_arch
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ez_arch {
+
+struct StateFileInfo {
+    size_t pages = 0;       // Non-zero pages stored
+    size_t file_bytes = 0;
+    bool compressed = false;
+};
+
+// Versioned CPU state snapshots for the CLI save/loadstate commands.
+//
+// A file is a fixed header (registers, PC, pipeline stage and latches, fault
+// and instruction count) followed by a directory of the non-zero resident
+// pages and their payloads, so it covers the whole address space and costs
+// nothing for memory the program never wrote. Payloads are either raw pages,
+// 4-byte aligned so they install straight from the mmap'd file, or blocks in
+// a small LZ4-style format when that is smaller. Device state is not saved.
+//
+// Values are stored in host byte order; loading a file written on a host of
+// the other byte order is rejected.
+class StateFile {
+public:
+    static constexpr uint32_t VERSION = 1;
+
+    // Throws std::runtime_error if the file cannot be written
+    static StateFileInfo save(const std::string& path, const CPU& cpu, bool compress = true);
+
+    // Reset `cpu` and restore the saved state. Throws std::runtime_error for
+    // unreadable, corrupt or incompatible files, leaving `cpu` reset.
+    static StateFileInfo load(const std::string& path, CPU& cpu);
+};
+
+} // namespace ez_arch
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "cpu.hpp"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
+namespace ez_arch {
+
+// 64-bit hash of a CPU's architectural state: registers, PC, halt and fault
+// flags, and memory contents. Device registers and the instruction count are
+// not part of it.
+//
+// Memory is hashed per page, and the page hashes are summed. Zero words add
+// nothing, so a page of zeros hashes like one never allocated and two runs
+// that end with the same contents match however their pages were touched.
+// update() finds the pages written since the last call through Memory's dirty
+// epochs, rehashes only those and adjusts the sum by their change. Finding
+// them is one pass over the resident pages' dirty stamps, so keeping the hash
+// current costs that pass plus O(pages written) hashing, rather than hashing
+// all of memory. Lazy image pages are hashed from the image and stay lazy.
+class StateHasher {
+public:
+    // Hashes all of memory once
+    explicit StateHasher(CPU& cpu);
+
+    // Pick up pages written since the last call (or construction) and return
+    // the hash of the current state. Starts a new dirty epoch. Memory must
+    // only have changed through writes since then: after restore(), reset()
+    // or loading, make a new hasher.
+    uint64_t update();
+
+    // One-off hash of a state, equal to what a StateHasher would return; for
+    // telling apart the final states of separate runs
+    static uint64_t hash(const CPU& cpu);
+
+private:
+    CPU& m_cpu;
+    uint64_t m_epoch;
+    uint64_t m_memoryHash;
+    std::unordered_map<address_t, uint64_t> m_pageHashes;  // Page base -> hash
+};
+
+// Spots a run that can never end. Execution is deterministic, so the state
+// at each sample determines the state at the next; once a sampled state comes
+// round again, the run cycles through the same states forever. Samples are
+// taken every SAMPLE_INTERVAL taken backward branches, which every loop
+// passes, and compared with Brent's algorithm: one saved state, replaced at
+// power-of-two sample counts, finds a cycle within a few times its length
+// plus the time to enter it. Registers and PC are compared exactly, memory by
+// its StateHasher hash.
+//
+// Device state is not hashed, so the detector starts over whenever a device
+// is busy or was accessed since the last sample: a loop polling a DMA
+// transfer, or counting in a device register, looks the same each time round
+// but ends.
+class LoopDetector {
+public:
+    static constexpr unsigned SAMPLE_INTERVAL = 64;
+
+    explicit LoopDetector(CPU& cpu)
+        : m_cpu(cpu), m_deviceAccesses(cpu.get_memory().device_accesses()) {}
+
+    // Call after every taken backward branch; true once the state repeated
+    bool at_backward_branch() {
+      if (++m_branches < SAMPLE_INTERVAL) return false;
+      m_branches = 0;
+      return sample();
+    }
+
+private:
+    CPU& m_cpu;
+    unsigned m_branches = 0;
+    uint64_t m_deviceAccesses;  // As of the last sample
+    std::optional<StateHasher> m_hasher;  // Built on the first sample
+
+    bool m_saved = false;
+    uint64_t m_savedHash = 0;
+    RegisterFile m_savedRegisters;
+    uint64_t m_power = 1;   // Samples until the saved state is replaced
+    uint64_t m_length = 0;  // Samples since it was saved
+
+    bool sample();
+    void forget();
+};
+
+} // namespace ez_arch
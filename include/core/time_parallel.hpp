@@ -0,0 +1,60 @@
+#pragma once
+
+#include "cpu.hpp"
+#include "timing_model.hpp"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ez_arch {
+
+struct TimeParallelConfig {
+    TimingConfig timing;
+    uint64_t segment_length = 1000000;  // Instructions per segment
+    uint64_t warmup = 10000;            // Timed, unmeasured instructions before each later segment
+    uint64_t max_instructions = 100000000;
+    unsigned threads = 0;               // 0 uses std::thread::hardware_concurrency()
+};
+
+struct TimeParallelResult {
+    TimingStats stats;                  // Summed over segments
+    std::array<uint64_t, 5> stage_busy{};  // Instructions doing work in each ExecutionStage
+    uint64_t instructions = 0;
+    uint64_t segments = 0;
+    uint64_t mispredictions = 0;        // Segments re-executed from a wrong start state
+    bool halted = false;
+
+    // The true state at each later segment's warm-up start, in order. Passed
+    // back as predictions, a repeat of the run (say under another
+    // TimingConfig) needs no functional pass and never mispredicts.
+    std::vector<std::shared_ptr<const CPU::Snapshot>> checkpoints;
+};
+
+// Detailed timing of one long run on several host threads, by speculating on
+// where each segment starts.
+//
+// The run is cut into segments of segment_length instructions. Each segment
+// after the first starts from a predicted state `warmup` instructions before
+// it: from a functional run (CPU::run on a fork), or from the checkpoints of
+// an earlier run. Workers then run segments independently through the
+// stage-accurate path, five step_stage() calls per instruction feeding a
+// TimingModel, after timing the warm-up to fill caches, predictor and
+// pipeline. Counting is exact, but cycles can differ slightly from one
+// sequential pass, as far as the warm-up misses older history.
+//
+// Segments are then validated in order: one whose state after warm-up does
+// not match where the previous segment really ended (compared by StateHasher
+// hash and instruction count) is re-executed from that end, continuing the
+// previous segment's TimingModel. So are segments without a prediction. The
+// CPU is left in the final state, as after a plain run.
+class TimeParallelSimulator {
+public:
+    // Throws std::invalid_argument for a zero segment length, a warm-up
+    // longer than a segment, a bad cache geometry, or a CPU mid-instruction
+    static TimeParallelResult run(CPU& cpu, const TimeParallelConfig& config);
+    static TimeParallelResult run(CPU& cpu, const TimeParallelConfig& config,
+                                  const std::vector<std::shared_ptr<const CPU::Snapshot>>& predictions);
+};
+
+} // namespace ez_arch
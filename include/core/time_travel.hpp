@@ -0,0 +1,133 @@
+#pragma once
+
+#include "breakpoints.hpp"
+#include "cpu.hpp"
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ez_arch {
+
+// Reverse execution for a CPU.
+//
+// Forward execution through this class takes a copy-on-write checkpoint
+// (CPU::snapshot) every `interval` instructions, so any earlier instruction
+// boundary is reached by restoring the nearest checkpoint and replaying at
+// most one interval. Single steps also log an undo entry (the register and
+// memory word the instruction overwrote, plus PC and latches), so stepping
+// straight back after stepping forward needs no replay at all. Steps that
+// touch a device page or run while a device is busy are not undoable and
+// fall back to replay.
+//
+// When the checkpoint list reaches max_checkpoints, every other checkpoint
+// is dropped and the interval doubles, so memory stays bounded on long runs
+// and seeks cost at most one (grown) interval of replay.
+//
+// Positions are instruction counts (CPU::get_instruction_count). Execution is
+// deterministic, so going back and forward again reproduces the same states;
+// call restart() after changing the CPU any other way (loading a program,
+// editing registers or memory).
+class TimeTravel {
+public:
+    static constexpr uint64_t DEFAULT_INTERVAL = 100000;
+    static constexpr size_t DEFAULT_MAX_CHECKPOINTS = 256;
+    static constexpr uint64_t UNLIMITED = std::numeric_limits<uint64_t>::max();
+
+    explicit TimeTravel(CPU& cpu, uint64_t interval = DEFAULT_INTERVAL,
+                        size_t max_checkpoints = DEFAULT_MAX_CHECKPOINTS);
+
+    // Forget all history and start recording from the CPU's current state
+    void restart();
+
+    // Forward execution. step() returns false if the CPU was halted; run()
+    // returns the number of instructions retired. run() also stops once the
+    // PC reaches one of `breakpoints`, after at least one instruction, so
+    // resuming from a breakpoint moves past it, and after an instruction that
+    // hit a memory watch (Memory::watch_hit, which run() clears first). Like
+    // CPU::run it returns early once CPU::request_stop() was called.
+    bool step();
+    // One pipeline stage (CPU::step_stage), recorded like step() so fetches
+    // reach patch_code(). Going back from mid-instruction lands on a boundary.
+    bool step_stage();
+    uint64_t run(uint64_t max_instructions = UNLIMITED,
+                 const Breakpoints* breakpoints = nullptr);
+
+    // Go back `count` instructions; false (and no move) if that is before the
+    // start of the history
+    bool step_back(uint64_t count = 1);
+    // Move to the boundary after `instruction` instructions retired. Forward
+    // seeks execute; false if the program halts first (the CPU stays there).
+    bool seek(uint64_t instruction);
+    // Move to the latest earlier boundary whose state satisfies `stop`; false
+    // (and no move) if none does
+    bool reverse_continue(const std::function<bool(const CPU&)>& stop);
+
+    // Record the position each address is first fetched at, which
+    // patch_code() needs. Forward runs then step one instruction at a time,
+    // as with breakpoints.
+    void set_fetch_tracking(bool enabled);
+    bool fetch_tracking() const { return m_trackFetches; }
+
+    // Write `words` from `addr` on as an edit of the program. Execution before
+    // the first recorded fetch of a changed word cannot depend on it, so
+    // history up to there is kept (its checkpoints get the new words) and the
+    // rest is dropped. The CPU ends up with the edit applied, at its current
+    // position or that first fetch if earlier; running from there re-executes
+    // only what the edit can have changed. Returns the first fetch, or last()
+    // if no changed word was fetched. Needs fetch tracking on for the whole
+    // history; reads of the program as data are not tracked.
+    uint64_t patch_code(address_t addr, const std::vector<word_t>& words);
+
+    uint64_t position() const { return m_cpu.get_instruction_count(); }
+    uint64_t first() const { return m_checkpoints.front().instruction; }
+    uint64_t last() const { return m_last; }  // Furthest position reached
+    uint64_t interval() const { return m_interval; }
+    size_t checkpoint_count() const { return m_checkpoints.size(); }
+    size_t undo_depth() const { return m_undo.size(); }
+
+private:
+    struct Checkpoint {
+        uint64_t instruction;
+        std::shared_ptr<const CPU::Snapshot> snapshot;
+    };
+
+    // Everything one instruction overwrote; it always starts from FETCH
+    struct UndoEntry {
+        uint64_t instruction;
+        address_t pc;
+        word_t current_instruction;
+        PipelineRegisters pipeline;
+        register_id_t reg;       // 0 if none
+        word_t reg_value;
+        bool stored;
+        address_t store_addr;
+        word_t store_value;
+    };
+
+    CPU& m_cpu;
+    uint64_t m_interval;
+    size_t m_maxCheckpoints;
+    std::vector<Checkpoint> m_checkpoints;  // Ascending; never empty
+    std::vector<UndoEntry> m_undo;          // Contiguous, ending at position()
+    uint64_t m_last;
+    bool m_trackFetches;
+    std::unordered_map<address_t, uint64_t> m_firstFetch;  // Address -> position
+
+    void prepare_forward();
+    void after_forward();
+    void checkpoint_if_due();
+    void thin_checkpoints();
+    bool record_undo(UndoEntry& entry) const;
+    void apply_undo(const UndoEntry& entry);
+    void replay_to(uint64_t instruction);
+    void record_fetch() {
+      if (m_trackFetches && m_cpu.get_current_stage() == ExecutionStage::FETCH) {
+        m_firstFetch.emplace(m_cpu.get_registers().get_pc(), position());
+      }
+    }
+};
+
+} // namespace ez_arch
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "branch_predictor.hpp"
+#include "cache_model.hpp"
+#include "trace.hpp"
+#include <array>
+#include <cstdint>
+
+namespace ez_arch {
+
+struct TimingConfig {
+    CacheConfig icache;
+    CacheConfig dcache;
+    PredictorType predictor = PredictorType::TWO_BIT;
+    bool forwarding = true;
+
+    unsigned miss_penalty = 20;    // Cycles per cache miss
+    unsigned branch_penalty = 2;   // Branches resolve in EX, flushing IF and ID
+    unsigned jump_penalty = 1;     // Jump targets are known in ID
+};
+
+struct TimingStats {
+    uint64_t instructions = 0;
+    uint64_t cycles = 0;
+    uint64_t data_stall_cycles = 0;
+    uint64_t branches = 0;
+    uint64_t mispredictions = 0;
+    uint64_t icache_accesses = 0;
+    uint64_t icache_misses = 0;
+    uint64_t dcache_accesses = 0;
+    uint64_t dcache_misses = 0;
+
+    double cpi() const;
+    double icache_miss_rate() const;
+    double dcache_miss_rate() const;
+    double mispredict_rate() const;
+};
+
+// Trace-driven timing model of the classic 5-stage pipeline (IF ID EX MEM WB).
+// Consumers read registers in ID; without forwarding they wait for the
+// producer's WB, with forwarding only a load immediately followed by a user
+// of its result stalls.
+class TimingModel {
+public:
+    static constexpr unsigned PIPELINE_DEPTH = 5;
+
+    explicit TimingModel(const TimingConfig& config);
+
+    void consume(const TraceRecord& record);
+
+    // Update cache and predictor state only, without advancing time or stats.
+    // Used to keep long-lived state warm while fast-forwarding.
+    void warm(const TraceRecord& record);
+
+    // Stats accumulate until reset_stats(); caches and predictor stay warm.
+    const TimingStats& stats() const { return m_stats; }
+    void reset_stats();
+
+    const TimingConfig& config() const { return m_config; }
+
+private:
+    TimingConfig m_config;
+    CacheModel m_icache;
+    CacheModel m_dcache;
+    BranchPredictor m_predictor;
+
+    TimingStats m_stats;
+    bool m_pipelineFilled;
+
+    uint64_t m_cycle;  // Cycle in which the next instruction can enter ID
+    std::array<uint64_t, 32> m_ready;  // First ID cycle each register is readable
+};
+
+} // namespace ez_arch
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "types.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ez_arch {
+
+class CPU;
+
+namespace TraceFlag {
+    constexpr uint8_t LOAD = 0x01;
+    constexpr uint8_t STORE = 0x02;
+    constexpr uint8_t BRANCH = 0x04;
+    constexpr uint8_t TAKEN = 0x08;
+    constexpr uint8_t JUMP = 0x10;
+}
+
+// One retired instruction, as seen by the timing models.
+struct TraceRecord {
+    address_t pc;
+    word_t instruction;
+    address_t mem_addr;     // Effective address of lw/sw, 0 otherwise
+    address_t target;       // Branch/jump target, 0 otherwise
+    register_id_t dest;     // Register written, 0 if none
+    register_id_t src1;     // Registers read, 0 if unused
+    register_id_t src2;
+    uint8_t flags;          // TraceFlag bits
+
+    bool is_load() const { return flags & TraceFlag::LOAD; }
+    bool is_store() const { return flags & TraceFlag::STORE; }
+    bool is_branch() const { return flags & TraceFlag::BRANCH; }
+    bool is_taken() const { return flags & TraceFlag::TAKEN; }
+    bool is_jump() const { return flags & TraceFlag::JUMP; }
+};
+
+enum class AccessKind : uint8_t {
+    FETCH,
+    LOAD,
+    STORE
+};
+
+// One Memory access made by a retired instruction
+struct MemoryAccess {
+    address_t addr;
+    AccessKind kind;
+};
+
+// Expand a trace into its Memory access stream: the fetch of each
+// instruction, followed by its load or store.
+std::vector<MemoryAccess> memory_accesses(const std::vector<TraceRecord>& trace);
+
+// Address traces are stored as a small header followed by raw host-endian
+// MemoryAccess records.
+bool save_access_trace(const std::string& filename, const std::vector<MemoryAccess>& accesses);
+bool load_access_trace(const std::string& filename, std::vector<MemoryAccess>& accesses);
+
+class TraceRecorder {
+public:
+    // Describe the instruction at the CPU's PC without executing it.
+    // Returns false if the CPU is halted or the next word is the halt word.
+    static bool peek(const CPU& cpu, TraceRecord& record);
+
+    // Execute one instruction with CPU::step() and describe it.
+    static bool record_step(CPU& cpu, TraceRecord& record);
+
+    // Run the CPU functionally until halt or max_instructions retire.
+    static std::vector<TraceRecord> record(CPU& cpu, uint64_t max_instructions);
+};
+
+} // namespace ez_arch
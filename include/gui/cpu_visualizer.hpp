@@ -4,15 +4,20 @@
 #include <memory>
 #include <vector>
 
+#include "core/async_run.hpp"
 #include "core/cpu.hpp"
+#include "core/framebuffer.hpp"
+#include "core/time_travel.hpp"
 #include "gui/button.hpp"
 #include "gui/datapath_view.hpp"
+#include "gui/framebuffer_view.hpp"
 #include "gui/instruction_builder_view.hpp"
 #include "gui/instruction_cache.hpp"
 #include "gui/instruction_queue_view.hpp"
 #include "gui/instruction_view.hpp"
 #include "gui/memory_view.hpp"
 #include "gui/register_view.hpp"
+#include "gui/timeline_view.hpp"
 
 namespace ez_arch {
 
@@ -22,6 +27,8 @@ class CPUVisualizer {
 
   void update();
   void draw();
+  // Redraw views after the CPU changed outside the visualizer
+  void refresh() { m_needsUpdate = true; }
 
   // Event handling
   void handleMouseMove(float x, float y);
@@ -52,14 +59,44 @@ class CPUVisualizer {
   std::unique_ptr<DatapathView> m_datapathView;
   std::unique_ptr<InstructionBuilderView> m_builderView;
   std::unique_ptr<InstructionQueueView> m_queueView;
+  std::unique_ptr<FramebufferView> m_framebufferView;
+  std::unique_ptr<TimelineView> m_timelineView;
+
+  // Step, Run and Back go through this so the timeline can scrub history
+  std::unique_ptr<TimeTravel> m_history;
+
+  // Run executes on a worker thread so the window stays responsive. While it
+  // is set, the CPU and history belong to the worker: views are not updated
+  // and anything that would touch the CPU stops the run first.
+  std::unique_ptr<AsyncRun> m_run;
+  uint64_t m_runFirst;  // Timeline range when the run started
+  uint64_t m_runStart;
+  void startRun();
+  void stopRun();
+  void pollRun();
+
+  // Framebuffer mapped into CPU memory; null if it could not be mapped
+  std::shared_ptr<FramebufferDevice> m_framebuffer;
 
   // Control buttons
   std::vector<std::unique_ptr<Button>> m_buttons;
+  Button* m_backButton;  // Laid out with the timeline
 
   // Instruction queue (persistent)
   std::vector<std::string> m_instructionQueue;
   void syncQueueToCache();
 
+  // The queue as last written at QUEUE_BASE by LoadQ or RunQ. Edits to the
+  // queue after that patch memory through the history instead of reloading,
+  // and if RunQ ran it, only the part of the run an edit affects is redone.
+  std::vector<word_t> m_loadedQueue;
+  bool m_queueLoaded;
+  bool m_queueRan;
+  std::vector<word_t> assembleQueue() const;  // Malformed lines skipped
+  std::vector<word_t> queueWords() const;     // Padded over m_loadedQueue
+  void loadQueue();
+  void queueEdited();
+
   // View state
   enum class ActiveView {
     NONE,
@@ -67,7 +104,8 @@ class CPUVisualizer {
     MEMORY,
     INSTRUCTIONS,
     BUILDER,
-    QUEUE
+    QUEUE,
+    FRAMEBUFFER
   };
   ActiveView m_activeView;
 
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "core/framebuffer.hpp"
+#include <vector>
+
+namespace ez_arch {
+
+class FramebufferView {
+public:
+    FramebufferView(FramebufferDevice& framebuffer, sf::Font& font);
+    
+    // Set position of the view on screen
+    void setPosition(float x, float y);
+    
+    // Upload the rows written since the last frame to the texture; safe
+    // while a run is writing the framebuffer
+    void update();
+    
+    // Draw the framebuffer view
+    void draw(sf::RenderWindow& window);
+    
+private:
+    FramebufferDevice& m_framebuffer;
+    sf::Font& m_font;
+    sf::Texture m_texture;
+    std::vector<uint8_t> m_rows;  // Dirty rows copied out for upload
+    float m_x;
+    float m_y;
+    float m_scale;  // Screen pixels per framebuffer pixel
+    
+    // Drawing helpers
+    void drawHeader(sf::RenderWindow& window);
+};
+
+} // namespace ez_arch
@@ -43,5 +43,6 @@ constexpr float BUTTON_HEIGHT = 35.f;
 constexpr float TOP_BAR_HEIGHT = 60.f;
 constexpr float LEFT_SIDEBAR_WIDTH = 60.f;
 constexpr float TOGGLE_BUTTON_SIZE = 50.f;
+constexpr float TIMELINE_HEIGHT = 50.f;
 
 }  // namespace ez_arch
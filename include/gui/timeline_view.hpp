@@ -0,0 +1,56 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <functional>
+
+namespace ez_arch {
+
+// Scrubber over the recorded execution history. The track spans the first
+// to the furthest instruction reached; clicking or dragging along it asks
+// for a seek to the instruction under the mouse.
+class TimelineView {
+public:
+    using SeekCallback = std::function<void(uint64_t instruction)>;
+
+    explicit TimelineView(sf::Font& font);
+
+    void setPosition(float x, float y);
+    void setSize(float width, float height);
+    void setOnSeek(SeekCallback callback);
+
+    // Recorded range and the current instruction
+    void setRange(uint64_t first, uint64_t last, uint64_t current);
+
+    // Event handling
+    void handleMouseMove(float x, float y);
+    void handleMousePress(float x, float y);
+    void handleMouseRelease(float x, float y);
+
+    void draw(sf::RenderWindow& window);
+
+private:
+    sf::Font& m_font;
+    float m_x;
+    float m_y;
+    float m_width;
+    float m_height;
+
+    uint64_t m_first;
+    uint64_t m_last;
+    uint64_t m_current;
+
+    bool m_dragging;
+    uint64_t m_requested;  // Last instruction sent while dragging
+    SeekCallback m_onSeek;
+
+    // Track geometry, inside the label area
+    float trackLeft() const;
+    float trackRight() const;
+    bool contains(float x, float y) const;
+    uint64_t instructionAt(float x) const;
+    float xFor(uint64_t instruction) const;
+    void seekTo(float x);
+};
+
+} // namespace ez_arch
@@ -31,6 +31,14 @@ namespace ez_arch {
       cmd.type = CommandType::STEP_STAGE;
     } else if (command == "run" || command == "r") {
       cmd.type = CommandType::RUN;
+    } else if (command == "continue" || command == "c") {
+      cmd.type = CommandType::CONTINUE;
+    } else if (command == "rcontinue" || command == "rc") {
+      cmd.type = CommandType::REVERSE_CONTINUE;
+    } else if (command == "back") {
+      cmd.type = CommandType::BACK;
+    } else if (command == "seek") {
+      cmd.type = CommandType::SEEK;
     } else if (command == "registers" || command == "regs") {
       cmd.type = CommandType::REGISTERS;
     } else if (command == "register" || command == "reg") {
@@ -45,10 +53,34 @@ namespace ez_arch {
       cmd.type = CommandType::ASSEMBLE;
     } else if (command == "watch" || command == "w") {
       cmd.type = CommandType::WATCH;
+    } else if (command == "break" || command == "b") {
+      cmd.type = CommandType::BREAK;
+    } else if (command == "delete") {
+      cmd.type = CommandType::DELETE;
     } else if (command == "save") {
       cmd.type = CommandType::SAVE;
     } else if (command == "loadstate") {
       cmd.type = CommandType::LOAD_STATE;
+    } else if (command == "sweep") {
+      cmd.type = CommandType::SWEEP;
+    } else if (command == "sample") {
+      cmd.type = CommandType::SAMPLE;
+    } else if (command == "ptime") {
+      cmd.type = CommandType::TIME_PARALLEL;
+    } else if (command == "verify") {
+      cmd.type = CommandType::VERIFY;
+    } else if (command == "trace") {
+      cmd.type = CommandType::TRACE;
+    } else if (command == "cachesim") {
+      cmd.type = CommandType::CACHE_SIM;
+    } else if (command == "share") {
+      cmd.type = CommandType::SHARE;
+    } else if (command == "hash") {
+      cmd.type = CommandType::HASH;
+    } else if (command == "runcache") {
+      cmd.type = CommandType::RUN_CACHE;
+    } else if (command == "loopcheck") {
+      cmd.type = CommandType::LOOP_CHECK;
     } else if (command == "reset") {
       cmd.type = CommandType::RESET;
     } else if (command == "quit" || command == "exit" || command == "q") {
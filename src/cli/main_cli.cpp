@@ -1,33 +1,106 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
+#include <sstream>
 #include <string>
 
 #include "cli/command_parser.hpp"
 #include "cli/input_handler.hpp"
 #include "cli/output_formatter.hpp"
+#include "core/breakpoints.hpp"
 #include "core/cpu.hpp"
 #include "core/decoder.hpp"
+#include "core/design_sweep.hpp"
+#include "core/dma.hpp"
+#include "core/elf_loader.hpp"
+#include "core/lockstep_verifier.hpp"
+#include "core/program_loader.hpp"
+#include "core/run_cache.hpp"
+#include "core/parallel_cache_sim.hpp"
+#include "core/sampled_simulation.hpp"
+#include "core/shared_state.hpp"
+#include "core/state_file.hpp"
+#include "core/state_hash.hpp"
+#include "core/time_parallel.hpp"
+#include "core/time_travel.hpp"
+#include "core/trace.hpp"
 
 using namespace ez_arch;
 
 struct WatchExpression {
   std::string expr;
   enum Type { REGISTER, MEMORY } type;
-  uint32_t value;
+  uint32_t value;              // Register number or start address
+  uint32_t length = 4;         // MEMORY: bytes watched
+  bool on_read = false;        // MEMORY: reads stop a run too
+  std::vector<uint8_t> last;   // MEMORY: contents when the run started
 };
 
+// Why a run or continue stopped
+enum class StopReason { HALTED, BREAKPOINT, WATCH, LIMIT, INTERRUPTED };
+
 std::vector<WatchExpression> watches;
+SymbolTable symbols;  // From the last ELF load
+Breakpoints breakpoints;
+
+// Longest memory watch; its bytes are read and compared at every stop
+constexpr uint32_t MAX_WATCH_BYTES = Memory::PAGE_SIZE;
+
+// Instructions between state publishes while sharing a run
+constexpr uint64_t SHARE_PUBLISH_INTERVAL = 100000;
+// Instructions between looks at the clock during a run, and how often a long
+// run reports its progress
+constexpr uint64_t PROGRESS_CHECK_INTERVAL = 4000000;
+constexpr std::chrono::seconds PROGRESS_INTERVAL{2};
+
+// The CPU a Ctrl-C stops while a run is in progress. The handler may only
+// touch lock-free atomics: this pointer and the CPU's stop flag.
+std::atomic<CPU*> interrupt_target{nullptr};
+static_assert(std::atomic<CPU*>::is_always_lock_free &&
+                  std::atomic<bool>::is_always_lock_free,
+              "Ctrl-C handling needs lock-free atomics");
+
+void handle_interrupt(int) {
+  CPU* target = interrupt_target.load(std::memory_order_relaxed);
+  if (target) target->request_stop();
+}
 
 void print_help();
 std::vector<word_t> load_hex_file(const std::string& filename);
+void load_elf_file(CPU& cpu, const std::string& filename);
+void load_binary_file(CPU& cpu, const std::string& filename);
 void print_watches(const CPU& cpu);
+address_t resolve_address(const std::string& text);
+StopReason run_until_stop(CPU& cpu, TimeTravel& history, SharedStatePublisher* publisher,
+                          uint64_t max_instructions);
+StopReason run_chunks(CPU& cpu, TimeTravel& history, SharedStatePublisher* publisher,
+                      uint64_t max_instructions);
+std::vector<uint8_t> read_watched(const CPU& cpu, const WatchExpression& watch);
+std::string format_bytes(const std::vector<uint8_t>& bytes);
+void print_stop(const CPU& cpu, StopReason reason);
+bool parse_sweep_args(const std::vector<std::string>& args, SweepGrid& grid,
+                      uint64_t& max_instructions, unsigned& threads);
+void run_sweep(CPU& cpu, const std::vector<std::string>& args);
+void run_cache_sim(const std::vector<std::string>& args);
+void run_verify(CPU& cpu, const std::vector<std::string>& args);
+void publish_state(SharedStatePublisher& publisher, CPU& cpu);
 
 int main() {
   CPU cpu;
+  cpu.get_memory().map_device(DmaDevice::DEFAULT_BASE, Memory::PAGE_SIZE,
+                              std::make_shared<DmaDevice>());
+  cpu.set_loop_detection(true);  // Stuck programs halt instead of hanging the CLI
+  TimeTravel history(cpu);  // Forward execution goes through this so back/seek work
   bool running = true;
   InputHandler input_handler;
+  std::unique_ptr<SharedStatePublisher> publisher;
+  std::unique_ptr<RunCache> run_cache;
 
   // Load command history from previous sessions
   input_handler.load_history(".ez_arch_history");
@@ -59,13 +132,19 @@ int main() {
       case CommandType::LOAD:
         if (cmd.args.empty()) {
           std::cout << "Usage: load <filename>\n";
+        } else if (ElfLoader::is_elf(cmd.args[0])) {
+          load_elf_file(cpu, cmd.args[0]);
+        } else if (ProgramLoader::is_binary_image(cmd.args[0])) {
+          load_binary_file(cpu, cmd.args[0]);
         } else {
           std::vector<word_t> program = load_hex_file(cmd.args[0]);
           if (!program.empty()) {
             cpu.load_program(program);
+            symbols = SymbolTable();
             std::cout << "Loaded " << program.size() << " instructions\n";
           }
         }
+        history.restart();
         break;
 
       case CommandType::STEP: {
@@ -79,10 +158,10 @@ int main() {
         }
 
         for (int i = 0; i < count && !cpu.is_halted(); ++i) {
-          cpu.step();
+          history.step();
         }
 
-        OutputFormatter::print_cpu_state(cpu);
+        OutputFormatter::print_cpu_state(cpu, &symbols);
         if (!watches.empty()) {
           print_watches(cpu);
         }
@@ -90,21 +169,111 @@ int main() {
       }
 
       case CommandType::STEP_STAGE:
-        cpu.step_stage();
-        OutputFormatter::print_cpu_state(cpu);
+        history.step_stage();
+        OutputFormatter::print_cpu_state(cpu, &symbols);
         if (!watches.empty()) {
           print_watches(cpu);
         }
         break;
 
       case CommandType::RUN:
-        cpu.run();
-        std::cout << "Execution halted\n";
-        OutputFormatter::print_cpu_state(cpu);
+      case CommandType::CONTINUE: {
+        uint64_t limit = TimeTravel::UNLIMITED;
+        if (!cmd.args.empty()) {
+          try {
+            limit = std::stoull(cmd.args[0]);
+          } catch (const std::exception& e) {
+            std::cerr << "Invalid instruction count.\n";
+            break;
+          }
+        }
+
+        // Plain runs go through the result cache, if one is set
+        std::optional<RunCache::Key> key;
+        if (run_cache && breakpoints.empty() && cpu.get_memory().watches().empty() && !publisher) {
+          key = run_cache->key(cpu, limit);
+        }
+        if (key && run_cache->load(*key, cpu)) {
+          history.restart();
+          std::cout << "Cached result of " << cpu.get_instruction_count() - key->start_instruction
+                    << " instructions\n";
+          print_stop(cpu, cpu.is_halted() ? StopReason::HALTED : StopReason::LIMIT);
+          break;
+        }
+
+        print_stop(cpu, run_until_stop(cpu, history, publisher.get(), limit));
+        if (key) {
+          try {
+            run_cache->store(*key, cpu);
+          } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
+          }
+        }
+        break;
+      }
+
+      case CommandType::REVERSE_CONTINUE:
+        if (breakpoints.empty()) {
+          std::cout << "No breakpoints set\n";
+          break;
+        }
+        if (!history.reverse_continue([](const CPU& c) {
+              return breakpoints.contains(c.get_registers().get_pc());
+            })) {
+          std::cout << "No earlier breakpoint hit since instruction " << history.first() << '\n';
+          break;
+        }
+        print_stop(cpu, StopReason::BREAKPOINT);
+        break;
+
+      case CommandType::BACK: {
+        uint64_t count = 1;
+        if (!cmd.args.empty()) {
+          try {
+            count = std::stoull(cmd.args[0]);
+          } catch (const std::exception& e) {
+            std::cerr << "Invalid step count.\n";
+            break;
+          }
+        }
+
+        if (!history.step_back(count)) {
+          std::cout << "History starts at instruction " << history.first() << '\n';
+          break;
+        }
+        OutputFormatter::print_cpu_state(cpu, &symbols);
+        if (!watches.empty()) {
+          print_watches(cpu);
+        }
+        break;
+      }
+
+      case CommandType::SEEK: {
+        if (cmd.args.empty()) {
+          std::cout << "Usage: seek <instruction>\n";
+          break;
+        }
+        uint64_t target = 0;
+        try {
+          target = std::stoull(cmd.args[0]);
+        } catch (const std::exception& e) {
+          std::cerr << "Invalid instruction number.\n";
+          break;
+        }
+
+        if (target < history.first()) {
+          std::cout << "History starts at instruction " << history.first() << '\n';
+          break;
+        }
+        if (!history.seek(target)) {
+          std::cout << "Execution halted at instruction " << history.position() << '\n';
+        }
+        OutputFormatter::print_cpu_state(cpu, &symbols);
         if (!watches.empty()) {
           print_watches(cpu);
         }
         break;
+      }
 
       case CommandType::REGISTERS:
         OutputFormatter::print_registers(cpu.get_registers());
@@ -215,108 +384,285 @@ int main() {
               std::cerr << "Invalid register format\n";
             }
           } else if (expr[0] == '0' && expr[1] == 'x') {
-            // Memory watch: 0x1000, etc.
+            // Memory watch: 0x1000 [bytes] [read]; runs stop when it changes
             try {
               watch.type = WatchExpression::MEMORY;
               watch.value = std::stoul(expr, nullptr, 16);
+              for (size_t i = 1; i < cmd.args.size(); ++i) {
+                if (cmd.args[i] == "read") {
+                  watch.on_read = true;
+                } else {
+                  unsigned long length = std::stoul(cmd.args[i], nullptr, 0);
+                  if (length > MAX_WATCH_BYTES) {
+                    throw std::invalid_argument("Watch length must be at most " +
+                                                std::to_string(MAX_WATCH_BYTES) + " bytes");
+                  }
+                  watch.length = static_cast<uint32_t>(length);
+                }
+              }
+              cpu.get_memory().add_watch(watch.value, watch.length, watch.on_read);
+              watch.last = read_watched(cpu, watch);
               watches.push_back(watch);
-              std::cout << "Added watch: " << expr << '\n';
+              std::cout << "Added watch: " << expr << " (" << watch.length << " bytes, stops on "
+                        << (watch.on_read ? "read or change" : "change") << ")\n";
+            } catch (const std::invalid_argument& e) {
+              std::cerr << "Error: " << e.what() << '\n';
             } catch (const std::exception& e) {
               std::cerr << "Invalid address format\n";
             }
+          } else if (expr == "clear") {
+            cpu.get_memory().clear_watches();
+            watches.clear();
+            std::cout << "All watches removed\n";
           } else {
-            std::cerr << "Watch format: $<reg_num> or 0x<address>\n";
+            std::cerr << "Watch format: $<reg_num> or 0x<address> [bytes] [read]\n";
           }
         }
         break;
       }
 
-      case CommandType::SAVE: {
+      case CommandType::BREAK:
+        if (cmd.args.empty()) {
+          if (breakpoints.empty()) std::cout << "No breakpoints set\n";
+          for (address_t addr : breakpoints.addresses()) {
+            std::string name = symbols.describe(addr);
+            std::cout << "  0x" << std::hex << std::setw(8) << std::setfill('0') << addr
+                      << std::dec << (name.empty() ? "" : " <" + name + ">") << '\n';
+          }
+          break;
+        }
+        try {
+          address_t addr = resolve_address(cmd.args[0]);
+          if (breakpoints.add(addr)) {
+            std::cout << "Breakpoint set at 0x" << std::hex << std::setw(8) << std::setfill('0')
+                      << addr << std::dec << '\n';
+          } else {
+            std::cout << "Breakpoint already set\n";
+          }
+        } catch (const std::exception& e) {
+          std::cerr << "Error: " << e.what() << '\n';
+        }
+        break;
+
+      case CommandType::DELETE:
         if (cmd.args.empty()) {
-          std::cout << "Usage: save <filename>\n";
+          breakpoints.clear();
+          std::cout << "All breakpoints deleted\n";
+          break;
+        }
+        try {
+          if (!breakpoints.remove(resolve_address(cmd.args[0]))) {
+            std::cout << "No breakpoint at " << cmd.args[0] << '\n';
+          }
+        } catch (const std::exception& e) {
+          std::cerr << "Error: " << e.what() << '\n';
+        }
+        break;
+
+      case CommandType::SAVE:
+        if (cmd.args.empty()) {
+          std::cout << "Usage: save <filename> [raw]\n";
         } else {
-          std::ofstream outfile(cmd.args[0], std::ios::binary);
-          if (!outfile) {
-            std::cerr << "Error: Could not open file for writing\n";
-            break;
+          try {
+            bool compress = !(cmd.args.size() > 1 && cmd.args[1] == "raw");
+            StateFileInfo info = StateFile::save(cmd.args[0], cpu, compress);
+            std::cout << "CPU state saved to " << cmd.args[0] << " (" << info.pages
+                      << " pages, " << info.file_bytes << " bytes)\n";
+          } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
           }
+        }
+        break;
 
-          // Save registers (32 registers)
-          for (register_id_t i = 0; i < 32; ++i) {
-            word_t value = cpu.get_registers().read(i);
-            outfile.write(reinterpret_cast<const char*>(&value), sizeof(value));
+      case CommandType::LOAD_STATE:
+        if (cmd.args.empty()) {
+          std::cout << "Usage: loadstate <filename>\n";
+        } else {
+          try {
+            StateFileInfo info = StateFile::load(cmd.args[0], cpu);
+            symbols = SymbolTable();
+            history.restart();
+            std::cout << "CPU state loaded from " << cmd.args[0] << " (" << info.pages
+                      << " pages)\n";
+          } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
           }
+        }
+        break;
+
+      case CommandType::SWEEP:
+        if (cmd.args.empty()) {
+          std::cout << "Usage: sweep <file.csv|file.json> [cache=<bytes,...>] "
+                       "[assoc=<n,...>] [bp=<predictor,...>] [fwd=on,off] "
+                       "[line=<bytes>] [max=<instructions>] [threads=<n>]\n";
+        } else {
+          run_sweep(cpu, cmd.args);
+        }
+        break;
 
-          // Save PC
-          word_t pc = cpu.get_registers().get_pc();
-          outfile.write(reinterpret_cast<const char*>(&pc), sizeof(pc));
+      case CommandType::SAMPLE: {
+        SamplingConfig config;
+        try {
+          if (cmd.args.size() > 0) config.period = std::stoull(cmd.args[0]);
+          if (cmd.args.size() > 1) config.warmup = std::stoull(cmd.args[1]);
+          if (cmd.args.size() > 2) config.window = std::stoull(cmd.args[2]);
+        } catch (const std::exception& e) {
+          std::cerr << "Usage: sample [period] [warmup] [window]\n";
+          break;
+        }
 
-          // Save memory (iterate through memory and save non-zero words)
-          // Simple approach: save first 64KB (0x0 to 0x10000)
-          for (address_t addr = 0; addr < 0x10000; addr += 4) {
-            try {
-              word_t value = cpu.get_memory().read_word(addr);
-              outfile.write(reinterpret_cast<const char*>(&addr), sizeof(addr));
-              outfile.write(reinterpret_cast<const char*>(&value),
-                            sizeof(value));
-            } catch (...) {
-              // Skip unreadable addresses
-            }
+        // Sample a copy so the interactive CPU is left untouched
+        CPU sample_cpu = cpu.fork();
+        try {
+          SamplingResult result = SampledSimulator::run(sample_cpu, config);
+          std::cout << "Instructions:  " << result.instructions
+                    << (result.halted ? "" : " (budget reached before halt)") << '\n'
+                    << "Detailed:      " << result.detailed_instructions << " in "
+                    << result.samples << " samples\n";
+          if (result.samples > 0) {
+            std::cout << "CPI:           " << result.mean_cpi << " (stddev "
+                      << result.cpi_stddev << ")\n"
+                      << "Cycles:        " << std::fixed << std::setprecision(0)
+                      << result.estimated_cycles << " +/- " << result.cycles_error
+                      << " (95% confidence)\n"
+                      << std::defaultfloat << std::setprecision(6);
+          } else {
+            std::cout << "Program ended during warm-up; try a smaller warmup\n";
           }
+        } catch (const std::exception& e) {
+          std::cerr << "Error: " << e.what() << '\n';
+        }
+        break;
+      }
 
-          std::cout << "CPU state saved to " << cmd.args[0] << '\n';
+      case CommandType::TIME_PARALLEL: {
+        TimeParallelConfig config;
+        try {
+          if (cmd.args.size() > 0) config.segment_length = std::stoull(cmd.args[0]);
+          if (cmd.args.size() > 1) config.warmup = std::stoull(cmd.args[1]);
+          if (cmd.args.size() > 2) config.threads = static_cast<unsigned>(std::stoul(cmd.args[2]));
+        } catch (const std::exception& e) {
+          std::cerr << "Usage: ptime [segment_length] [warmup] [threads]\n";
+          break;
+        }
+
+        // Time a copy so the interactive CPU is left untouched
+        CPU timed_cpu = cpu.fork();
+        try {
+          TimeParallelResult result = TimeParallelSimulator::run(timed_cpu, config);
+          const std::array<uint64_t, 5>& busy = result.stage_busy;
+          std::cout << "Instructions:  " << result.instructions
+                    << (result.halted ? "" : " (budget reached before halt)") << '\n'
+                    << "Segments:      " << result.segments << " (" << result.mispredictions
+                    << " re-executed after a wrong prediction)\n"
+                    << "Cycles:        " << result.stats.cycles << " (CPI "
+                    << result.stats.cpi() << ")\n"
+                    << "Stage work:    IF " << busy[0] << ", ID " << busy[1] << ", EX "
+                    << busy[2] << ", MEM " << busy[3] << ", WB " << busy[4] << '\n';
+        } catch (const std::exception& e) {
+          std::cerr << "Error: " << e.what() << '\n';
         }
         break;
       }
 
-      case CommandType::LOAD_STATE: {
+      case CommandType::VERIFY:
+        run_verify(cpu, cmd.args);
+        break;
+
+      case CommandType::TRACE: {
         if (cmd.args.empty()) {
-          std::cout << "Usage: loadstate <filename>\n";
+          std::cout << "Usage: trace <file> [max_instructions]\n";
+          break;
+        }
+
+        uint64_t max_instructions = 10'000'000;
+        try {
+          if (cmd.args.size() > 1) max_instructions = std::stoull(cmd.args[1]);
+        } catch (const std::exception& e) {
+          std::cerr << "Invalid instruction count.\n";
+          break;
+        }
+
+        // Record from a copy so the interactive CPU is left untouched
+        CPU trace_cpu = cpu.fork();
+        std::vector<MemoryAccess> accesses =
+            memory_accesses(TraceRecorder::record(trace_cpu, max_instructions));
+        if (save_access_trace(cmd.args[0], accesses)) {
+          std::cout << "Wrote " << accesses.size() << " memory accesses to "
+                    << cmd.args[0] << '\n';
         } else {
-          std::ifstream infile(cmd.args[0], std::ios::binary);
-          if (!infile) {
-            std::cerr << "Error: Could not open file for reading\n";
-            break;
-          }
+          std::cerr << "Error: Could not write trace file\n";
+        }
+        break;
+      }
 
-          cpu.reset();
+      case CommandType::CACHE_SIM:
+        if (cmd.args.empty()) {
+          std::cout << "Usage: cachesim <trace_file> [size=<bytes>] [assoc=<n>] "
+                       "[line=<bytes>] [threads=<n>]\n";
+        } else {
+          run_cache_sim(cmd.args);
+        }
+        break;
 
-          // Load registers
-          for (register_id_t i = 0; i < 32; ++i) {
-            word_t value;
-            infile.read(reinterpret_cast<char*>(&value), sizeof(value));
-            if (i != 0) {  // Don't write to $0
-              cpu.get_registers().write(i, value);
-            }
+      case CommandType::SHARE:
+        if (cmd.args.empty()) {
+          std::cout << "Usage: share <name> | share off\n";
+        } else if (cmd.args[0] == "off") {
+          publisher.reset();
+          std::cout << "Stopped sharing\n";
+        } else {
+          try {
+            // Room for every page loaded so far, lazy image pages included,
+            // and as many again for what the program writes
+            const Memory& memory = cpu.get_memory();
+            size_t pages = std::max(SharedStatePublisher::DEFAULT_MAX_PAGES,
+                                    2 * (memory.resident_pages() + memory.lazy_pages()));
+            publisher.reset();
+            publisher = std::make_unique<SharedStatePublisher>(cmd.args[0], pages);
+            std::cout << "Sharing state as " << publisher->name()
+                      << "; attach with: ez_architecture_gui --attach " << cmd.args[0] << '\n';
+          } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
           }
+        }
+        break;
 
-          // Load PC
-          word_t pc;
-          infile.read(reinterpret_cast<char*>(&pc), sizeof(pc));
-          cpu.get_registers().set_pc(pc);
-
-          // Load memory
-          while (infile) {
-            address_t addr;
-            word_t value;
-            infile.read(reinterpret_cast<char*>(&addr), sizeof(addr));
-            if (!infile) break;
-            infile.read(reinterpret_cast<char*>(&value), sizeof(value));
-            if (!infile) break;
-            try {
-              cpu.get_memory().write_word(addr, value);
-            } catch (...) {
-              // Skip unwriteable addresses
-            }
+      case CommandType::HASH:
+        std::cout << "State hash: 0x" << std::hex << std::setw(16) << std::setfill('0')
+                  << StateHasher::hash(cpu) << std::dec << std::setfill(' ') << '\n';
+        break;
+
+      case CommandType::RUN_CACHE:
+        if (cmd.args.empty()) {
+          std::cout << "Usage: runcache <directory> | runcache off\n";
+        } else if (cmd.args[0] == "off") {
+          run_cache.reset();
+          std::cout << "Run cache off\n";
+        } else {
+          try {
+            run_cache = std::make_unique<RunCache>(cmd.args[0]);
+            std::cout << "Caching run results in " << run_cache->directory() << '\n';
+          } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << '\n';
           }
+        }
+        break;
 
-          std::cout << "CPU state loaded from " << cmd.args[0] << '\n';
+      case CommandType::LOOP_CHECK:
+        if (!cmd.args.empty() && (cmd.args[0] == "on" || cmd.args[0] == "off")) {
+          cpu.set_loop_detection(cmd.args[0] == "on");
+        } else if (!cmd.args.empty()) {
+          std::cout << "Usage: loopcheck [on|off]\n";
+          break;
         }
+        std::cout << "Infinite loop detection is " << (cpu.loop_detection() ? "on" : "off") << '\n';
         break;
-      }
 
       case CommandType::RESET:
         cpu.reset();
+        symbols = SymbolTable();
+        history.restart();
         std::cout << "CPU reset\n";
         break;
 
@@ -332,20 +678,38 @@ int main() {
       default:
         break;
     }
+
+    if (publisher) {
+      publish_state(*publisher, cpu);
+    }
   }
 
   return 0;
 }
 
+// Publish, warning the first time memory no longer fits the segment
+void publish_state(SharedStatePublisher& publisher, CPU& cpu) {
+  bool overflowed = publisher.overflowed();
+  publisher.publish(cpu);
+  if (!overflowed && publisher.overflowed()) {
+    std::cerr << "Warning: memory outgrew the shared segment; attached viewers show the "
+                 "pages that did not fit as zeros. Run 'share' again to resize it.\n";
+  }
+}
+
 void print_help() {
   std::cout
       << "Available commands:\n"
       << "  help                  - Show this help\n"
-      << "  load <file>           - Load program from file\n"
+      << "  load <file>           - Load hex program, .bin image or MIPS ELF executable\n"
       << "  step                  - Execute one instruction\n"
       << "  step <n>              - Execute n instructions\n"
       << "  stage                 - Execute by stage\n"
-      << "  run                   - Run until halt\n"
+      << "  run [max]             - Run until halt, or at most max instructions\n"
+      << "  continue [max]        - Run until a breakpoint or halt (Ctrl-C stops either)\n"
+      << "  rcontinue             - Run backwards to the previous breakpoint\n"
+      << "  back [n]              - Step back n instructions (default 1)\n"
+      << "  seek <n>              - Go to the state after n instructions\n"
       << "  registers             - Display all registers\n"
       << "  reg <num>             - Display specific register\n"
       << "  memory                - Display memory at address\n"
@@ -353,35 +717,183 @@ void print_help() {
       << "  pc                    - Display program counter\n"
       << "  disasm [addr]         - Disassemble instruction (default: at PC)\n"
       << "  asm <instruction>     - Assemble instruction to machine code\n"
-      << "  watch <expr>          - Add watch expression ($reg or 0xaddr)\n"
-      << "  save <file>           - Save CPU state to file\n"
+      << "  watch $reg            - Show a register after each command\n"
+      << "  watch 0xaddr [n] [read] - Stop runs when n <= 4096 bytes change (or are read)\n"
+      << "  watch clear           - Remove all watches\n"
+      << "  break [addr|symbol]   - Set a breakpoint, or list them\n"
+      << "  delete [addr|symbol]  - Delete a breakpoint, or all of them\n"
+      << "  save <file> [raw]     - Save CPU state (compressed unless raw)\n"
       << "  loadstate <file>      - Load CPU state from file\n"
+      << "  sweep <file> [axes]   - Sweep cache/predictor/forwarding configs\n"
+      << "  sample [p] [wu] [w]   - Estimate cycles by sampled timing\n"
+      << "  ptime [seg] [wu] [t]  - Time the whole run in segments across threads\n"
+      << "  verify [instr|block|n] [engine] [max] - Check an engine against step()\n"
+      << "  trace <file> [max]    - Record memory access trace to file\n"
+      << "  cachesim <file> [cfg] - Simulate a cache over a trace file\n"
+      << "  share <name> | off    - Publish live state for the GUI to attach\n"
+      << "  hash                  - Print a hash of registers, PC and memory\n"
+      << "  runcache <dir> | off  - Reuse stored results of runs repeated from the same state\n"
+      << "  loopcheck [on|off]    - Halt runs stuck in an endless loop (default on)\n"
       << "  reset                 - Reset CPU state\n"
       << "  quit                  - Exit simulator\n";
 }
 
 std::vector<word_t> load_hex_file(const std::string& filename) {
-  std::vector<word_t> program;
-  std::ifstream file(filename);
+  HexProgram program;
+  try {
+    program = ProgramLoader::read_hex_file(filename);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n\n";
+    return {};
+  }
 
-  if (!file.is_open()) {
-    std::cerr << "Error: Could not open file '" << filename << "'\n\n";
-    return program;
+  for (const std::string& line : program.bad_lines) {
+    std::cerr << "Error parsing line: " << line << '\n';
   }
+  return std::move(program.words);
+}
 
-  std::string line;
-  while (std::getline(file, line)) {
-    if (line.empty() || line[0] == '#') continue;
+void load_binary_file(CPU& cpu, const std::string& filename) {
+  try {
+    size_t bytes = ProgramLoader::load_binary_file(filename, cpu);
+    symbols = SymbolTable();
+    std::cout << "Loaded " << bytes << " byte image\n";
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n\n";
+  }
+}
 
-    try {
-      word_t instruction = std::stoul(line, nullptr, 16);
-      program.push_back(instruction);
-    } catch (const std::exception& e) {
-      std::cerr << "Error parsing line: " << line << '\n';
+void load_elf_file(CPU& cpu, const std::string& filename) {
+  try {
+    ElfProgram program = ElfLoader::load(filename, cpu);
+    symbols = std::move(program.symbols);
+    std::cout << "Loaded " << program.segments << " segments (" << program.file_bytes
+              << " bytes, mapped on demand), " << symbols.size() << " symbols\n"
+              << "Entry: 0x" << std::hex << std::setw(8) << std::setfill('0')
+              << program.entry << std::dec << '\n';
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n\n";
+  }
+}
+
+address_t resolve_address(const std::string& text) {
+  if (const Symbol* symbol = symbols.lookup(text)) return symbol->address;
+  size_t used = 0;
+  unsigned long value = std::stoul(text, &used, 16);
+  if (used != text.size() || value > 0xFFFFFFFFul) {
+    throw std::invalid_argument("Not an address or symbol: " + text);
+  }
+  return static_cast<address_t>(value);
+}
+
+StopReason run_until_stop(CPU& cpu, TimeTravel& history, SharedStatePublisher* publisher,
+                          uint64_t max_instructions) {
+  for (WatchExpression& watch : watches) {
+    if (watch.type == WatchExpression::MEMORY) watch.last = read_watched(cpu, watch);
+  }
+
+  // Ctrl-C stops the run instead of the simulator
+  cpu.clear_stop();
+  interrupt_target = &cpu;
+  auto previous_handler = std::signal(SIGINT, handle_interrupt);
+  StopReason reason = run_chunks(cpu, history, publisher, max_instructions);
+  std::signal(SIGINT, previous_handler);
+  interrupt_target = nullptr;
+  cpu.clear_stop();
+  return reason;
+}
+
+StopReason run_chunks(CPU& cpu, TimeTravel& history, SharedStatePublisher* publisher,
+                      uint64_t max_instructions) {
+  using Clock = std::chrono::steady_clock;
+  Clock::time_point started = Clock::now();
+  Clock::time_point reported = started;
+  Memory& memory = cpu.get_memory();
+
+  // Run in chunks to look at the clock; while sharing, publish after each one
+  // so an attached GUI can follow the run
+  uint64_t chunk = publisher ? SHARE_PUBLISH_INTERVAL : PROGRESS_CHECK_INTERVAL;
+  uint64_t remaining = max_instructions;
+  while (!cpu.is_halted()) {
+    if (remaining == 0) return StopReason::LIMIT;
+    remaining -= history.run(std::min(chunk, remaining), &breakpoints);
+    if (publisher) publish_state(*publisher, cpu);
+    if (cpu.stop_requested()) return StopReason::INTERRUPTED;
+    if (!cpu.is_halted() && breakpoints.contains(cpu.get_registers().get_pc())) {
+      return StopReason::BREAKPOINT;
     }
+
+    Clock::time_point now = Clock::now();
+    if (now - reported >= PROGRESS_INTERVAL) {
+      reported = now;
+      uint64_t done = max_instructions - remaining;
+      double seconds = std::chrono::duration<double>(now - started).count();
+      std::cout << "  " << done << " instructions, " << std::fixed << std::setprecision(1)
+                << static_cast<double>(done) / seconds / 1e6 << " MIPS, PC 0x" << std::hex
+                << std::setw(8) << std::setfill('0') << cpu.get_registers().get_pc()
+                << std::dec << std::setfill(' ') << std::defaultfloat << std::endl;
+    }
+    if (!memory.watch_hit()) continue;
+
+    // A write that leaves every watched value as it was does not stop the run
+    WatchHit hit = *memory.watch_hit();
+    bool changed = false;
+    for (WatchExpression& watch : watches) {
+      if (watch.type != WatchExpression::MEMORY) continue;
+      std::vector<uint8_t> now = read_watched(cpu, watch);
+      if (now == watch.last) continue;
+      std::cout << "Watch " << watch.expr << ": " << format_bytes(watch.last) << " -> "
+                << format_bytes(now) << '\n';
+      watch.last = std::move(now);
+      changed = true;
+    }
+    if (!hit.write) {
+      std::cout << "Watched read at 0x" << std::hex << std::setw(8) << std::setfill('0')
+                << hit.addr << std::dec << '\n';
+    }
+    if (changed || !hit.write) return StopReason::WATCH;
+  }
+  return StopReason::HALTED;
+}
+
+std::vector<uint8_t> read_watched(const CPU& cpu, const WatchExpression& watch) {
+  std::vector<uint8_t> bytes(watch.length);
+  for (uint32_t i = 0; i < watch.length; ++i) {
+    bytes[i] = cpu.get_memory().read_byte(watch.value + i);
   }
+  return bytes;
+}
+
+std::string format_bytes(const std::vector<uint8_t>& bytes) {
+  std::ostringstream ss;
+  ss << "0x" << std::hex << std::setfill('0');
+  for (size_t i = 0; i < bytes.size() && i < 16; ++i) {
+    ss << std::setw(2) << static_cast<unsigned>(bytes[i]);
+  }
+  if (bytes.size() > 16) ss << "...";
+  return ss.str();
+}
 
-  return program;
+void print_stop(const CPU& cpu, StopReason reason) {
+  address_t pc = cpu.get_registers().get_pc();
+  if (reason == StopReason::LIMIT) {
+    std::cout << "Instruction limit reached at instruction " << cpu.get_instruction_count() << '\n';
+  } else if (reason == StopReason::INTERRUPTED) {
+    std::cout << "Interrupted at instruction " << cpu.get_instruction_count() << '\n';
+  } else if (reason == StopReason::BREAKPOINT) {
+    std::string name = symbols.describe(pc);
+    std::cout << "Breakpoint at 0x" << std::hex << std::setw(8) << std::setfill('0') << pc
+              << std::dec << (name.empty() ? "" : " <" + name + ">") << '\n';
+  } else if (reason == StopReason::HALTED && cpu.loop_detected()) {
+    std::cout << "Infinite loop detected: the same state repeats at PC 0x" << std::hex
+              << std::setw(8) << std::setfill('0') << pc << std::dec << '\n';
+  } else if (reason == StopReason::HALTED) {
+    std::cout << "Execution halted\n";
+  }
+  OutputFormatter::print_cpu_state(cpu, &symbols);
+  if (!watches.empty()) {
+    print_watches(cpu);
+  }
 }
 
 void print_watches(const CPU& cpu) {
@@ -395,10 +907,12 @@ void print_watches(const CPU& cpu) {
         std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0')
                   << value << std::dec << " (" << static_cast<int32_t>(value)
                   << ")";
-      } else {  // MEMORY
+      } else if (watch.length == 4) {  // MEMORY
         word_t value = cpu.get_memory().read_word(watch.value);
         std::cout << "0x" << std::hex << std::setw(8) << std::setfill('0')
                   << value << std::dec;
+      } else {
+        std::cout << format_bytes(read_watched(cpu, watch));
       }
     } catch (const std::exception& e) {
       std::cout << "<error: " << e.what() << ">";
@@ -408,3 +922,218 @@ void print_watches(const CPU& cpu) {
   }
   std::cout << '\n';
 }
+
+bool parse_sweep_args(const std::vector<std::string>& args, SweepGrid& grid,
+                      uint64_t& max_instructions, unsigned& threads) {
+  // args[0] is the output file; the rest are key=value[,value...] axes
+  for (size_t i = 1; i < args.size(); ++i) {
+    size_t eq = args[i].find('=');
+    if (eq == std::string::npos) {
+      std::cerr << "Expected key=value, got: " << args[i] << '\n';
+      return false;
+    }
+
+    std::string key = args[i].substr(0, eq);
+    std::vector<std::string> values;
+    std::istringstream value_stream(args[i].substr(eq + 1));
+    std::string value;
+    while (std::getline(value_stream, value, ',')) {
+      if (!value.empty()) values.push_back(value);
+    }
+
+    try {
+      if (key == "cache") {
+        grid.cache_sizes.clear();
+        for (const auto& v : values) grid.cache_sizes.push_back(std::stoul(v));
+      } else if (key == "assoc") {
+        grid.associativities.clear();
+        for (const auto& v : values) grid.associativities.push_back(std::stoul(v));
+      } else if (key == "bp") {
+        grid.predictors.clear();
+        for (const auto& v : values) {
+          auto type = parsePredictorType(v);
+          if (!type) {
+            std::cerr << "Unknown predictor: " << v
+                      << " (not-taken, btfn, 1bit, 2bit)\n";
+            return false;
+          }
+          grid.predictors.push_back(*type);
+        }
+      } else if (key == "fwd") {
+        grid.forwarding.clear();
+        for (const auto& v : values) {
+          if (v != "on" && v != "off") {
+            std::cerr << "Unknown forwarding setting: " << v << " (on, off)\n";
+            return false;
+          }
+          grid.forwarding.push_back(v == "on");
+        }
+      } else if (key == "line" && !values.empty()) {
+        grid.line_bytes = std::stoul(values[0]);
+      } else if (key == "max" && !values.empty()) {
+        max_instructions = std::stoull(values[0]);
+      } else if (key == "threads" && !values.empty()) {
+        threads = std::stoul(values[0]);
+      } else {
+        std::cerr << "Unknown sweep axis: " << key << '\n';
+        return false;
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Invalid value in: " << args[i] << '\n';
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void run_sweep(CPU& cpu, const std::vector<std::string>& args) {
+  SweepGrid grid;
+  uint64_t max_instructions = 10'000'000;
+  unsigned threads = 0;
+
+  if (!parse_sweep_args(args, grid, max_instructions, threads)) return;
+
+  std::vector<TimingConfig> configs = DesignSweep::make_configs(grid);
+  if (configs.empty()) {
+    std::cerr << "Sweep grid produced no valid configurations\n";
+    return;
+  }
+
+  // Record from a copy so the interactive CPU is left untouched
+  CPU trace_cpu = cpu.fork();
+  std::vector<TraceRecord> trace = TraceRecorder::record(trace_cpu, max_instructions);
+  if (!trace_cpu.is_halted()) {
+    std::cout << "Warning: trace stopped at " << max_instructions
+              << " instructions before halt\n";
+  }
+
+  std::vector<SweepResult> results;
+  try {
+    results = DesignSweep::run(trace, configs, threads);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return;
+  }
+
+  const std::string& filename = args[0];
+  std::ofstream outfile(filename);
+  if (!outfile) {
+    std::cerr << "Error: Could not open file for writing\n";
+    return;
+  }
+
+  bool json = filename.size() >= 5 &&
+              filename.compare(filename.size() - 5, 5, ".json") == 0;
+  if (json) {
+    DesignSweep::write_json(outfile, results);
+  } else {
+    DesignSweep::write_csv(outfile, results);
+  }
+
+  std::cout << "Swept " << results.size() << " configurations over "
+            << trace.size() << " instructions, results in " << filename << '\n';
+}
+
+void run_cache_sim(const std::vector<std::string>& args) {
+  CacheConfig config;
+  config.size_bytes = 256 * 1024;
+  config.line_bytes = 64;
+  config.associativity = 8;
+  unsigned threads = 0;
+
+  for (size_t i = 1; i < args.size(); ++i) {
+    size_t eq = args[i].find('=');
+    try {
+      if (eq == std::string::npos) throw std::invalid_argument(args[i]);
+      std::string key = args[i].substr(0, eq);
+      unsigned long value = std::stoul(args[i].substr(eq + 1));
+      if (key == "size") {
+        config.size_bytes = value;
+      } else if (key == "assoc") {
+        config.associativity = value;
+      } else if (key == "line") {
+        config.line_bytes = value;
+      } else if (key == "threads") {
+        threads = value;
+      } else {
+        throw std::invalid_argument(key);
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Invalid cache option: " << args[i] << '\n';
+      return;
+    }
+  }
+
+  std::vector<MemoryAccess> accesses;
+  if (!load_access_trace(args[0], accesses)) {
+    std::cerr << "Error: Could not read trace file '" << args[0] << "'\n";
+    return;
+  }
+
+  try {
+    CacheSimStats stats = ParallelCacheSim::run(accesses, config, threads);
+    std::cout << "Accesses:   " << stats.accesses << '\n'
+              << "Misses:     " << stats.misses << " (fetch " << stats.fetch_misses
+              << ", load " << stats.load_misses << ", store " << stats.store_misses
+              << ")\n"
+              << "Miss rate:  " << stats.miss_rate() << '\n';
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << '\n';
+  }
+}
+
+void run_verify(CPU& cpu, const std::vector<std::string>& args) {
+  const char* usage = "Usage: verify [instr|block|<interval>] [stage|run|step] [max_instructions]\n";
+  VerifyConfig config;
+  config.max_instructions = 10'000'000;
+  std::unique_ptr<ExecutionEngine> engine;
+  try {
+    if (args.size() > 0 && args[0] == "instr") {
+      config.granularity = VerifyGranularity::INSTRUCTION;
+    } else if (args.size() > 0 && args[0] != "block") {
+      config.granularity = VerifyGranularity::INTERVAL;
+      config.interval = std::stoull(args[0]);
+    }
+    if (args.size() > 2) config.max_instructions = std::stoull(args[2]);
+  } catch (const std::exception& e) {
+    std::cerr << usage;
+    return;
+  }
+
+  try {
+    engine = ExecutionEngine::create(args.size() > 1 ? args[1] : "stage");
+  } catch (const std::invalid_argument& e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return;
+  }
+
+  // Verify a copy so the interactive CPU is left untouched
+  CPU verify_cpu = cpu.fork();
+  VerifyResult result;
+  try {
+    result = LockstepVerifier::run(verify_cpu, *engine, config);
+  } catch (const std::exception& e) {
+    std::cerr << "Error: " << e.what() << '\n';
+    return;
+  }
+
+  if (!result.divergence) {
+    std::cout << "Verified " << result.instructions << " instructions of the " << engine->name()
+              << " engine against step() in " << result.comparisons << " comparisons"
+              << (result.halted ? "" : " (budget reached before halt)") << '\n';
+    return;
+  }
+
+  const Divergence& divergence = *result.divergence;
+  std::cout << "Divergence at instruction " << divergence.instruction << ": 0x" << std::hex
+            << std::setw(8) << std::setfill('0') << divergence.pc << "  "
+            << Decoder::decode(divergence.word) << '\n';
+  for (const StateDifference& difference : divergence.differences) {
+    std::cout << "  " << std::setfill(' ') << std::setw(12) << std::left << difference.location
+              << std::right << " expected 0x" << std::setfill('0') << std::setw(8)
+              << difference.expected << ", " << engine->name() << " gave 0x" << std::setw(8)
+              << difference.actual << '\n';
+  }
+  std::cout << std::dec << std::setfill(' ');
+}
@@ -58,15 +58,23 @@ namespace ez_arch {
               << std::string(50, '-') << '\n';
   }
 
-  void OutputFormatter::print_cpu_state(const CPU& cpu) {
+  void OutputFormatter::print_cpu_state(const CPU& cpu, const SymbolTable* symbols) {
     const RegisterFile& regs = cpu.get_registers();
 
     std::cout << "\n--- CPU STATE ---\n"
               << "PC: 0x" << std::hex << std::setw(8) << std::setfill('0')
-              << regs.get_pc() << std::dec << '\n'
+              << regs.get_pc() << std::dec;
+    if (symbols) {
+      std::string name = symbols->describe(regs.get_pc());
+      if (!name.empty()) std::cout << " <" << name << '>';
+    }
+    std::cout << '\n'
               << stageToString(cpu.get_current_stage()) << '\n'
-              << "Halted: " << (cpu.is_halted() ? "Yes" : "No") << '\n'
-              << std::string(17, '-') << '\n';
+              << "Halted: " << (cpu.is_halted() ? "Yes" : "No") << '\n';
+    if (cpu.is_faulted()) {
+      std::cout << "Fault: " << cpu.get_fault()->what() << '\n';
+    }
+    std::cout << std::string(17, '-') << '\n';
   }
 
 } // namespace ez_arch
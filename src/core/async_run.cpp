@@ -0,0 +1,66 @@
+#include "core/async_run.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ez_arch {
+
+AsyncRun::AsyncRun(CPU& cpu, Runner runner, uint64_t max_instructions, uint64_t notify_interval)
+    : m_cpu(cpu), m_runner(std::move(runner)), m_maxInstructions(max_instructions),
+      m_notifyInterval(notify_interval), m_instructions(0), m_pc(cpu.get_registers().get_pc()),
+      m_finished(false), m_cancelled(false) {
+  if (notify_interval == 0) {
+    throw std::invalid_argument("Notification interval must be non-zero");
+  }
+  m_cpu.clear_stop();
+  m_worker = std::thread(&AsyncRun::work, this);
+}
+
+AsyncRun::~AsyncRun() {
+  cancel();
+  wait();
+}
+
+void AsyncRun::cancel() {
+  if (finished()) return;
+  m_cancelled.store(true, std::memory_order_relaxed);
+  m_cpu.request_stop();
+}
+
+void AsyncRun::wait() {
+  if (!m_worker.joinable()) return;
+  m_worker.join();
+  m_cpu.clear_stop();  // A cancel that raced the end of the run
+}
+
+void AsyncRun::work() {
+  uint64_t done = 0;
+  std::exception_ptr error;
+  try {
+    while (!m_cpu.is_halted() && done < m_maxInstructions) {
+      uint64_t chunk = std::min(m_notifyInterval, m_maxInstructions - done);
+      uint64_t ran = m_runner(chunk);
+      done += ran;
+      m_instructions.store(done, std::memory_order_relaxed);
+      m_pc.store(m_cpu.get_registers().get_pc(), std::memory_order_relaxed);
+      if (ran < chunk) break;
+
+      // Coalesce: skip this one while the consumer has not taken the last
+      if (m_notifications.empty()) {
+        m_notifications.push({done, m_cpu.get_registers().get_pc(), false, nullptr});
+      }
+    }
+  } catch (...) {
+    // Escaping the thread would terminate the process
+    error = std::current_exception();
+  }
+
+  m_notifications.push({done, m_cpu.get_registers().get_pc(), true, error});
+  m_finished.store(true, std::memory_order_release);
+}
+
+std::unique_ptr<AsyncRun> CPU::run_async(uint64_t max_instructions, uint64_t notify_interval) {
+  return std::make_unique<AsyncRun>(
+      *this, [this](uint64_t count) { return run(count); }, max_instructions, notify_interval);
+}
+
+} // namespace ez_arch
@@ -0,0 +1,65 @@
+#include "core/branch_predictor.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ez_arch {
+
+std::optional<PredictorType> parsePredictorType(std::string_view name) {
+  if (name == "not-taken" || name == "static") return PredictorType::NOT_TAKEN;
+  if (name == "btfn") return PredictorType::BTFN;
+  if (name == "1bit") return PredictorType::ONE_BIT;
+  if (name == "2bit") return PredictorType::TWO_BIT;
+  return std::nullopt;
+}
+
+BranchPredictor::BranchPredictor(PredictorType type, size_t table_entries)
+    : m_type(type), m_table(table_entries, 0), m_branches(0), m_mispredictions(0) {
+  if (table_entries == 0 || (table_entries & (table_entries - 1)) != 0) {
+    throw std::invalid_argument("Predictor table size must be a power of two");
+  }
+  reset();
+}
+
+bool BranchPredictor::predict(address_t pc, address_t target) const {
+  switch (m_type) {
+    case PredictorType::NOT_TAKEN:
+      return false;
+    case PredictorType::BTFN:
+      return target <= pc;
+    case PredictorType::ONE_BIT:
+      return m_table[index(pc)] != 0;
+    case PredictorType::TWO_BIT:
+      return m_table[index(pc)] >= 2;
+  }
+  return false;
+}
+
+void BranchPredictor::update(address_t pc, bool taken) {
+  uint8_t& entry = m_table[index(pc)];
+
+  if (m_type == PredictorType::ONE_BIT) {
+    entry = taken ? 1 : 0;
+  } else if (m_type == PredictorType::TWO_BIT) {
+    if (taken && entry < 3) ++entry;
+    if (!taken && entry > 0) --entry;
+  }
+}
+
+bool BranchPredictor::resolve(address_t pc, address_t target, bool taken) {
+  bool correct = (predict(pc, target) == taken);
+  update(pc, taken);
+
+  ++m_branches;
+  if (!correct) ++m_mispredictions;
+
+  return correct;
+}
+
+void BranchPredictor::reset() {
+  // 2-bit counters start weakly not-taken
+  std::fill(m_table.begin(), m_table.end(), m_type == PredictorType::TWO_BIT ? 1 : 0);
+  m_branches = 0;
+  m_mispredictions = 0;
+}
+
+} // namespace ez_arch
@@ -0,0 +1,44 @@
+#include "core/breakpoints.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ez_arch {
+
+bool Breakpoints::add(address_t addr) {
+  if (addr & 0x3) {
+    throw std::invalid_argument("Breakpoint addresses must be word aligned");
+  }
+  if (contains(addr)) return false;
+
+  std::unique_ptr<Table>& table = m_directory[addr >> DIRECTORY_SHIFT];
+  if (!table) table = std::make_unique<Table>();
+  std::unique_ptr<PageBits>& page = table->pages[(addr >> PAGE_SHIFT) & INDEX_MASK];
+  if (!page) page = std::make_unique<PageBits>();
+  size_t word = (addr >> 2) & INDEX_MASK;
+  (*page)[word >> 6] |= uint64_t{1} << (word & 63);
+
+  m_addresses.insert(std::lower_bound(m_addresses.begin(), m_addresses.end(), addr), addr);
+  return true;
+}
+
+bool Breakpoints::remove(address_t addr) {
+  if (!contains(addr)) return false;
+
+  std::unique_ptr<Table>& table = m_directory[addr >> DIRECTORY_SHIFT];
+  std::unique_ptr<PageBits>& page = table->pages[(addr >> PAGE_SHIFT) & INDEX_MASK];
+  size_t word = (addr >> 2) & INDEX_MASK;
+  (*page)[word >> 6] &= ~(uint64_t{1} << (word & 63));
+  if (std::all_of(page->begin(), page->end(), [](uint64_t bits) { return bits == 0; })) {
+    page.reset();
+  }
+
+  m_addresses.erase(std::lower_bound(m_addresses.begin(), m_addresses.end(), addr));
+  return true;
+}
+
+void Breakpoints::clear() {
+  for (std::unique_ptr<Table>& table : m_directory) table.reset();
+  m_addresses.clear();
+}
+
+} // namespace ez_arch
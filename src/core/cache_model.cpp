@@ -0,0 +1,73 @@
+#include "core/cache_model.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ez_arch {
+
+namespace {
+
+bool is_power_of_two(size_t value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+unsigned log2_exact(size_t value) {
+  unsigned shift = 0;
+  while ((size_t{1} << shift) < value) ++shift;
+  return shift;
+}
+
+} // namespace
+
+CacheModel::CacheModel(const CacheConfig& config)
+    : m_config(config), m_numSets(0), m_lineShift(0), m_hits(0), m_misses(0) {
+  if (!is_power_of_two(config.line_bytes) || config.line_bytes < 4) {
+    throw std::invalid_argument("Cache line size must be a power of two >= 4");
+  }
+  if (config.associativity == 0 ||
+      config.size_bytes % (config.line_bytes * config.associativity) != 0) {
+    throw std::invalid_argument("Cache size must be a multiple of line size * associativity");
+  }
+
+  m_numSets = config.size_bytes / (config.line_bytes * config.associativity);
+  if (!is_power_of_two(m_numSets)) {
+    throw std::invalid_argument("Cache set count must be a power of two");
+  }
+
+  m_lineShift = log2_exact(config.line_bytes);
+  m_tags.assign(m_numSets * config.associativity, INVALID_TAG);
+}
+
+bool CacheModel::access(address_t addr) {
+  uint64_t tag = addr >> m_lineShift;  // Line address doubles as the tag
+  auto set_begin = m_tags.begin() + set_index(addr) * m_config.associativity;
+  auto set_end = set_begin + m_config.associativity;
+
+  auto way = std::find(set_begin, set_end, tag);
+  bool hit = (way != set_end);
+
+  if (hit) {
+    ++m_hits;
+  } else {
+    ++m_misses;
+    way = set_end - 1;  // Evict the least recently used way
+  }
+
+  // Move the accessed line to the MRU position
+  std::rotate(set_begin, way, way + 1);
+  *set_begin = tag;
+
+  return hit;
+}
+
+void CacheModel::reset() {
+  std::fill(m_tags.begin(), m_tags.end(), INVALID_TAG);
+  m_hits = 0;
+  m_misses = 0;
+}
+
+double CacheModel::miss_rate() const {
+  uint64_t total = accesses();
+  return total ? static_cast<double>(m_misses) / static_cast<double>(total) : 0.0;
+}
+
+} // namespace ez_arch
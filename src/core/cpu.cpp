@@ -1,12 +1,29 @@
 #include "core/cpu.hpp"
 #include "core/alu.hpp"
+#include "core/state_hash.hpp"
+#include <algorithm>
 #include <string>
 #include <string_view>
 #include <iostream>
 
 namespace ez_arch {
 
-CPU::CPU() : m_currentInstruction(0), m_currentStage(ExecutionStage::FETCH), m_halted(false) {
+struct CPU::Snapshot {
+  RegisterFile registers;
+  // Never written, so forking it only reads; mutable because fork() is non-const
+  mutable Memory memory;
+  Instruction instruction;
+  ExecutionStage stage;
+  bool halted;
+  std::optional<MemoryFault> fault;
+  uint64_t instruction_count;
+  PipelineRegisters pipeline;
+  bool loop_detected;
+};
+
+CPU::CPU()
+    : m_currentInstruction(0), m_currentStage(ExecutionStage::FETCH), m_halted(false),
+      m_instructionCount(0), m_detectLoops(false), m_loopDetected(false), m_baselineEpoch(0) {
   m_pipeline.clear();
 }
 
@@ -14,10 +31,30 @@ void CPU::clear_pipeline() {
   m_pipeline.clear();
 }
 
+void CPU::raise_fault(const MemoryFault& fault) {
+  // Abandon the instruction so PC still points at it
+  m_fault = fault;
+  m_halted = true;
+  m_currentStage = ExecutionStage::FETCH;
+  clear_pipeline();
+}
+
 void CPU::load_program(const std::vector<word_t>& program) {
   m_memory.load_program(program, 0);
   m_registers.set_pc(0);
   m_halted = false;
+  m_fault.reset();
+  m_loopDetected = false;
+  restart_loop_detection();
+}
+
+void CPU::load_image(const uint8_t* data, size_t size) {
+  m_memory.load_image(data, size, 0);
+  m_registers.set_pc(0);
+  m_halted = false;
+  m_fault.reset();
+  m_loopDetected = false;
+  restart_loop_detection();
 }
 
 void CPU::step() {
@@ -28,24 +65,44 @@ void CPU::step() {
     step_stage();
   }
 
-  fetch();
-  
-  // Check halt condition after fetch
-  if (m_currentInstruction.get_raw() == 0) {
-    m_halted = true;
-    return;
+  try {
+    fetch();
+
+    // Check halt condition after fetch
+    if (m_currentInstruction.get_raw() == 0) {
+      m_halted = true;
+      return;
+    }
+
+    decode();
+    execute();
+    m_memoryaccess();
+    write_back();
+  } catch (const MemoryFault& fault) {
+    raise_fault(fault);
   }
-  
-  decode();
-  execute();
-  m_memoryaccess();
-  write_back();
 }
 
-void CPU::run() {
-  while(!m_halted) {
+uint64_t CPU::run(uint64_t max_instructions) {
+  if (stop_requested()) return 0;
+  if (m_detectLoops && !m_loops.detector) m_loops.detector = std::make_shared<LoopDetector>(*this);
+  LoopDetector* loops = m_detectLoops ? m_loops.detector.get() : nullptr;
+
+  uint64_t start = m_instructionCount;
+  uint64_t end = start + std::min(max_instructions, UNLIMITED - start);
+  while (!m_halted && m_instructionCount < end) {
+    address_t pc = m_registers.get_pc();
     step();
+    address_t next = m_registers.get_pc();
+    if (next == pc + 4) continue;
+
+    if (stop_requested()) break;
+    if (loops && next <= pc && !m_halted && loops->at_backward_branch()) {
+      m_loopDetected = true;
+      m_halted = true;
+    }
   }
+  return m_instructionCount - start;
 }
 
 void CPU::reset() {
@@ -53,35 +110,118 @@ void CPU::reset() {
   m_memory.reset();
   m_currentStage = ExecutionStage::FETCH;
   m_halted = false;
+  m_fault.reset();
+  m_instructionCount = 0;
+  m_loopDetected = false;
+  restart_loop_detection();
+  m_baseline.reset();
   clear_pipeline();
 }
 
+std::shared_ptr<const CPU::Snapshot> CPU::snapshot() {
+  return std::make_shared<const Snapshot>(Snapshot{
+      m_registers, m_memory.fork(), m_currentInstruction, m_currentStage, m_halted, m_fault,
+      m_instructionCount, m_pipeline, m_loopDetected});
+}
+
+void CPU::restore(const Snapshot& snapshot) {
+  // Watches are debugger settings, not machine state: keep the current ones
+  Memory memory = snapshot.memory.fork();
+  memory.copy_watches(m_memory);
+  m_memory = std::move(memory);
+  m_registers = snapshot.registers;
+  m_currentInstruction = snapshot.instruction;
+  m_currentStage = snapshot.stage;
+  m_halted = snapshot.halted;
+  m_fault = snapshot.fault;
+  m_instructionCount = snapshot.instruction_count;
+  m_pipeline = snapshot.pipeline;
+  m_loopDetected = snapshot.loop_detected;
+  restart_loop_detection();
+  m_baseline.reset();
+}
+
+CPU CPU::fork() {
+  CPU child;
+  child.m_memory = m_memory.fork();
+  child.m_registers = m_registers;
+  child.m_currentInstruction = m_currentInstruction;
+  child.m_currentStage = m_currentStage;
+  child.m_halted = m_halted;
+  child.m_fault = m_fault;
+  child.m_instructionCount = m_instructionCount;
+  child.m_pipeline = m_pipeline;
+  child.m_detectLoops = m_detectLoops;
+  child.m_loopDetected = m_loopDetected;
+  child.m_baseline = m_baseline;
+  child.m_baselineEpoch = m_baselineEpoch;
+  return child;
+}
+
+void CPU::set_control_state(ExecutionStage stage, bool halted, uint64_t instruction_count,
+                            word_t current_instruction, const PipelineRegisters& pipeline,
+                            const std::optional<MemoryFault>& fault, bool loop_detected) {
+  m_currentStage = stage;
+  m_halted = halted;
+  m_instructionCount = instruction_count;
+  m_currentInstruction = Instruction(current_instruction);
+  m_pipeline = pipeline;
+  m_fault = fault;
+  m_loopDetected = loop_detected;
+  restart_loop_detection();
+}
+
+void CPU::save_baseline() {
+  m_baseline = snapshot();
+  m_baselineEpoch = m_memory.begin_epoch();
+}
+
+bool CPU::restore_baseline() {
+  if (!m_baseline) return false;
+
+  m_baselineEpoch = m_memory.restore_since(m_baseline->memory, m_baselineEpoch);
+  m_registers = m_baseline->registers;
+  m_currentInstruction = m_baseline->instruction;
+  m_currentStage = m_baseline->stage;
+  m_halted = m_baseline->halted;
+  m_fault = m_baseline->fault;
+  m_instructionCount = m_baseline->instruction_count;
+  m_pipeline = m_baseline->pipeline;
+  m_loopDetected = m_baseline->loop_detected;
+  restart_loop_detection();
+  return true;
+}
+
 void CPU::step_stage() {
   if (m_halted) return;
 
   if (m_stageCallback) m_stageCallback(m_currentStage);
 
-  switch (m_currentStage) {
-    case ExecutionStage::FETCH:
-      fetch();
-      m_currentStage = ExecutionStage::DECODE;
-      break;
-    case ExecutionStage::DECODE:
-      decode();
-      m_currentStage = ExecutionStage::EXECUTE;
-      break;
-    case ExecutionStage::EXECUTE:
-      execute();
-      m_currentStage = ExecutionStage::MEMORY_ACCESS;
-      break;
-    case ExecutionStage::MEMORY_ACCESS:
-      m_memoryaccess();
-      m_currentStage = ExecutionStage::WRITE_BACK;
-      break;
-    case ExecutionStage::WRITE_BACK:
-      write_back();
-      m_currentStage = ExecutionStage::FETCH;
-      break;
+  try {
+    switch (m_currentStage) {
+      case ExecutionStage::FETCH:
+        fetch();
+        m_currentStage = ExecutionStage::DECODE;
+        break;
+      case ExecutionStage::DECODE:
+        decode();
+        m_currentStage = ExecutionStage::EXECUTE;
+        break;
+      case ExecutionStage::EXECUTE:
+        execute();
+        m_currentStage = ExecutionStage::MEMORY_ACCESS;
+        break;
+      case ExecutionStage::MEMORY_ACCESS:
+        m_memoryaccess();
+        m_currentStage = ExecutionStage::WRITE_BACK;
+        break;
+      case ExecutionStage::WRITE_BACK:
+        write_back();
+        m_currentStage = ExecutionStage::FETCH;
+        break;
+    }
+  } catch (const MemoryFault& fault) {
+    raise_fault(fault);
   }
 }
 
@@ -273,5 +413,8 @@ void CPU::write_back() {
   m_registers.increment_pc();
 
   m_pipeline.clear();
+
+  ++m_instructionCount;
+  if (m_memory.has_clocked_devices()) m_memory.tick_devices(m_instructionCount);
 }
 } // namespace ez_arch
@@ -0,0 +1,126 @@
+#include "core/design_sweep.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace ez_arch {
+
+std::vector<TimingConfig> DesignSweep::make_configs(const SweepGrid& grid) {
+  std::vector<TimingConfig> configs;
+
+  for (size_t size : grid.cache_sizes) {
+    for (size_t assoc : grid.associativities) {
+      // Skip geometries CacheModel cannot build
+      size_t set_bytes = grid.line_bytes * assoc;
+      if (assoc == 0 || set_bytes == 0 || size % set_bytes != 0) continue;
+      size_t sets = size / set_bytes;
+      if ((sets & (sets - 1)) != 0) continue;
+
+      for (PredictorType predictor : grid.predictors) {
+        for (bool forwarding : grid.forwarding) {
+          TimingConfig config;
+          config.icache = {size, grid.line_bytes, assoc};
+          config.dcache = {size, grid.line_bytes, assoc};
+          config.predictor = predictor;
+          config.forwarding = forwarding;
+          configs.push_back(config);
+        }
+      }
+    }
+  }
+
+  return configs;
+}
+
+std::vector<SweepResult> DesignSweep::run(const std::vector<TraceRecord>& trace,
+                                          const std::vector<TimingConfig>& configs,
+                                          unsigned threads) {
+  std::vector<SweepResult> results(configs.size());
+
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(std::min<size_t>(threads, configs.size()));
+
+  std::atomic<size_t> next_config{0};
+  std::exception_ptr failure;
+  std::mutex failure_mutex;
+
+  // Each worker claims whole configurations; the trace is shared read-only
+  auto worker = [&]() {
+    for (size_t i = next_config++; i < configs.size(); i = next_config++) {
+      try {
+        TimingModel model(configs[i]);
+        for (const TraceRecord& record : trace) {
+          model.consume(record);
+        }
+        results[i] = {configs[i], model.stats()};
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(failure_mutex);
+        if (!failure) failure = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+
+  if (failure) std::rethrow_exception(failure);
+
+  return results;
+}
+
+void DesignSweep::write_csv(std::ostream& out, const std::vector<SweepResult>& results) {
+  out << "cache_bytes,line_bytes,associativity,predictor,forwarding,"
+      << "instructions,cycles,cpi,data_stall_cycles,branch_mispredict_rate,"
+      << "icache_miss_rate,dcache_miss_rate\n";
+
+  for (const SweepResult& result : results) {
+    const TimingConfig& config = result.config;
+    const TimingStats& stats = result.stats;
+    out << config.dcache.size_bytes << ','
+        << config.dcache.line_bytes << ','
+        << config.dcache.associativity << ','
+        << predictorTypeToString(config.predictor) << ','
+        << (config.forwarding ? "on" : "off") << ','
+        << stats.instructions << ','
+        << stats.cycles << ','
+        << stats.cpi() << ','
+        << stats.data_stall_cycles << ','
+        << stats.mispredict_rate() << ','
+        << stats.icache_miss_rate() << ','
+        << stats.dcache_miss_rate() << '\n';
+  }
+}
+
+void DesignSweep::write_json(std::ostream& out, const std::vector<SweepResult>& results) {
+  out << "[\n";
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const TimingConfig& config = results[i].config;
+    const TimingStats& stats = results[i].stats;
+    out << "  {\"cache_bytes\": " << config.dcache.size_bytes
+        << ", \"line_bytes\": " << config.dcache.line_bytes
+        << ", \"associativity\": " << config.dcache.associativity
+        << ", \"predictor\": \"" << predictorTypeToString(config.predictor) << '"'
+        << ", \"forwarding\": " << (config.forwarding ? "true" : "false")
+        << ", \"instructions\": " << stats.instructions
+        << ", \"cycles\": " << stats.cycles
+        << ", \"cpi\": " << stats.cpi()
+        << ", \"data_stall_cycles\": " << stats.data_stall_cycles
+        << ", \"branch_mispredict_rate\": " << stats.mispredict_rate()
+        << ", \"icache_miss_rate\": " << stats.icache_miss_rate()
+        << ", \"dcache_miss_rate\": " << stats.dcache_miss_rate() << '}'
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+
+  out << "]\n";
+}
+
+} // namespace ez_arch
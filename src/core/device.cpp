@@ -0,0 +1,18 @@
+#include "core/device.hpp"
+
+namespace ez_arch {
+
+uint8_t Device::read_byte(address_t offset) {
+  unsigned shift = (3 - (offset & 0x3)) * 8;
+  return (read_word(offset & ~address_t{3}) >> shift) & 0xFF;
+}
+
+void Device::write_byte(address_t offset, uint8_t value) {
+  address_t aligned = offset & ~address_t{3};
+  unsigned shift = (3 - (offset & 0x3)) * 8;
+  word_t word = read_word(aligned);
+  word = (word & ~(word_t{0xFF} << shift)) | (static_cast<word_t>(value) << shift);
+  write_word(aligned, word);
+}
+
+} // namespace ez_arch
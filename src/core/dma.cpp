@@ -0,0 +1,84 @@
+#include "core/dma.hpp"
+#include "core/memory.hpp"
+
+namespace ez_arch {
+
+DmaDevice::DmaDevice(const DmaConfig& config) : m_config(config) {
+  if (m_config.bytes_per_cycle == 0) m_config.bytes_per_cycle = 1;
+  reset();
+}
+
+std::shared_ptr<Device> DmaDevice::clone() const {
+  return std::make_shared<DmaDevice>(*this);
+}
+
+void DmaDevice::reset() {
+  m_src = m_dst = m_len = 0;
+  m_status = 0;
+  m_activeSrc = m_activeDst = m_activeLen = 0;
+  m_doneAt = 0;
+  m_now = 0;
+  m_transfers = 0;
+  m_bytesRead = 0;
+  m_bytesWritten = 0;
+  m_busyCycles = 0;
+}
+
+word_t DmaDevice::read_word(address_t offset) {
+  uint64_t traffic = m_bytesRead + m_bytesWritten;
+  switch (offset) {
+    case SRC: return m_src;
+    case DST: return m_dst;
+    case LEN: return m_len;
+    case STATUS: return m_status;
+    case TRAFFIC_LO: return static_cast<word_t>(traffic);
+    case TRAFFIC_HI: return static_cast<word_t>(traffic >> 32);
+    default: return 0;
+  }
+}
+
+void DmaDevice::write_word(address_t offset, word_t value) {
+  switch (offset) {
+    case SRC: m_src = value; break;
+    case DST: m_dst = value; break;
+    case LEN: m_len = value; break;
+    case CONTROL:
+      if (value & ACK) m_status &= ~(DONE | ERROR);
+      if (value & START) start();
+      break;
+    default: break;  // Read-only or unused
+  }
+}
+
+void DmaDevice::start() {
+  if (m_status & BUSY) return;  // One transfer at a time
+
+  m_activeSrc = m_src;
+  m_activeDst = m_dst;
+  m_activeLen = m_len;
+
+  uint64_t duration = m_config.setup_cycles +
+                      (m_activeLen + m_config.bytes_per_cycle - 1) / m_config.bytes_per_cycle;
+  m_doneAt = m_now + duration;
+  m_busyCycles += duration;
+  m_status = (m_status & ~(DONE | ERROR)) | BUSY;
+}
+
+void DmaDevice::tick(Memory& memory, uint64_t cycle) {
+  m_now = cycle;
+  if (!(m_status & BUSY) || cycle < m_doneAt) return;
+
+  // The data lands at the end of the transfer window
+  m_status &= ~BUSY;
+  try {
+    memory.copy_block(m_activeDst, m_activeSrc, m_activeLen);
+    m_bytesRead += m_activeLen;
+    m_bytesWritten += m_activeLen;
+    ++m_transfers;
+    m_status |= DONE;
+  } catch (const MemoryFault&) {
+    m_status |= ERROR;
+  }
+}
+
+} // namespace ez_arch
@@ -0,0 +1,181 @@
+#include "core/elf_loader.hpp"
+#include "core/mapped_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace ez_arch {
+
+namespace {
+
+constexpr uint8_t ELF_MAGIC[4] = {0x7F, 'E', 'L', 'F'};
+constexpr uint8_t ELFCLASS32 = 1;
+constexpr uint8_t ELFDATA2MSB = 2;
+constexpr uint16_t EM_MIPS = 8;
+constexpr uint32_t PT_LOAD = 1;
+constexpr uint32_t SHT_SYMTAB = 2;
+constexpr uint8_t STT_OBJECT = 1;
+constexpr uint8_t STT_FUNC = 2;
+
+constexpr size_t EHDR_SIZE = 52;
+constexpr size_t PHDR_SIZE = 32;
+constexpr size_t SHDR_SIZE = 40;
+constexpr size_t SYM_SIZE = 16;
+
+uint16_t be16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+
+uint32_t be32(const uint8_t* p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | p[3];
+}
+
+bool in_file(uint64_t offset, uint64_t length, size_t file_size) {
+  return offset <= file_size && length <= file_size - offset;
+}
+
+std::vector<Symbol> read_symbols(const uint8_t* file, size_t file_size, uint32_t shoff,
+                                 uint16_t shentsize, uint16_t shnum) {
+  std::vector<Symbol> symbols;
+  if (shoff == 0 || shentsize < SHDR_SIZE || !in_file(shoff, uint64_t{shentsize} * shnum, file_size)) {
+    return symbols;
+  }
+
+  for (uint16_t i = 0; i < shnum; ++i) {
+    const uint8_t* sh = file + shoff + size_t{i} * shentsize;
+    if (be32(sh + 4) != SHT_SYMTAB) continue;
+
+    uint32_t offset = be32(sh + 16);
+    uint32_t size = be32(sh + 20);
+    uint32_t link = be32(sh + 24);
+    if (link >= shnum || !in_file(offset, size, file_size)) continue;
+
+    const uint8_t* strtab_header = file + shoff + size_t{link} * shentsize;
+    uint32_t str_offset = be32(strtab_header + 16);
+    uint32_t str_size = be32(strtab_header + 20);
+    if (!in_file(str_offset, str_size, file_size)) continue;
+    const char* strings = reinterpret_cast<const char*>(file + str_offset);
+
+    for (uint32_t at = 0; at + SYM_SIZE <= size; at += SYM_SIZE) {
+      const uint8_t* sym = file + offset + at;
+      uint32_t name = be32(sym);
+      uint8_t type = sym[12] & 0xF;
+      uint16_t section = be16(sym + 14);
+      if ((type != STT_FUNC && type != STT_OBJECT) || section == 0 || name >= str_size) continue;
+
+      const char* end = std::find(strings + name, strings + str_size, '\0');
+      symbols.push_back({std::string(strings + name, end), be32(sym + 4), be32(sym + 8)});
+    }
+  }
+  return symbols;
+}
+
+} // namespace
+
+SymbolTable::SymbolTable(std::vector<Symbol> symbols) : m_symbols(std::move(symbols)) {
+  std::stable_sort(m_symbols.begin(), m_symbols.end(),
+                   [](const Symbol& a, const Symbol& b) { return a.address < b.address; });
+}
+
+const Symbol* SymbolTable::find(address_t addr) const {
+  auto next = std::upper_bound(m_symbols.begin(), m_symbols.end(), addr,
+                               [](address_t a, const Symbol& s) { return a < s.address; });
+  if (next == m_symbols.begin()) return nullptr;
+
+  const Symbol& symbol = *std::prev(next);
+  if (symbol.size != 0) {
+    return addr - symbol.address < symbol.size ? &symbol : nullptr;
+  }
+  return &symbol;
+}
+
+std::string SymbolTable::describe(address_t addr) const {
+  const Symbol* symbol = find(addr);
+  if (!symbol) return "";
+
+  std::ostringstream ss;
+  ss << symbol->name;
+  if (addr != symbol->address) ss << "+0x" << std::hex << (addr - symbol->address);
+  return ss.str();
+}
+
+const Symbol* SymbolTable::lookup(const std::string& name) const {
+  auto it = std::find_if(m_symbols.begin(), m_symbols.end(),
+                         [&](const Symbol& symbol) { return symbol.name == name; });
+  return it == m_symbols.end() ? nullptr : &*it;
+}
+
+bool ElfLoader::is_elf(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  char magic[4] = {};
+  return file.read(magic, sizeof(magic)) && std::memcmp(magic, ELF_MAGIC, sizeof(magic)) == 0;
+}
+
+ElfProgram ElfLoader::load(const std::string& path, CPU& cpu) {
+  size_t file_size = 0;
+  std::shared_ptr<const uint8_t> image = map_file(path, file_size);
+  const uint8_t* file = image.get();
+
+  if (file_size < EHDR_SIZE || std::memcmp(file, ELF_MAGIC, sizeof(ELF_MAGIC)) != 0) {
+    throw std::runtime_error("'" + path + "' is not an ELF file");
+  }
+  if (file[4] != ELFCLASS32 || file[5] != ELFDATA2MSB || be16(file + 18) != EM_MIPS) {
+    throw std::runtime_error("'" + path + "' is not a 32-bit big-endian MIPS executable");
+  }
+
+  uint32_t phoff = be32(file + 28);
+  uint16_t phentsize = be16(file + 42);
+  uint16_t phnum = be16(file + 44);
+  if (phentsize < PHDR_SIZE || !in_file(phoff, uint64_t{phentsize} * phnum, file_size)) {
+    throw std::runtime_error("'" + path + "' has a malformed program header table");
+  }
+
+  ElfProgram program;
+  program.entry = be32(file + 24);
+
+  // Check every segment before touching the CPU, so a bad file leaves the
+  // current program loaded
+  struct Segment {
+    uint32_t offset;
+    uint32_t vaddr;
+    uint32_t filesz;
+  };
+  std::vector<Segment> segments;
+  uint64_t memory_size = cpu.get_memory().size();
+  for (uint16_t i = 0; i < phnum; ++i) {
+    const uint8_t* ph = file + phoff + size_t{i} * phentsize;
+    if (be32(ph) != PT_LOAD) continue;
+
+    uint32_t offset = be32(ph + 4);
+    uint32_t vaddr = be32(ph + 8);
+    uint32_t filesz = be32(ph + 16);
+    uint32_t memsz = be32(ph + 20);
+    if (filesz > memsz || !in_file(offset, filesz, file_size)) {
+      throw std::runtime_error("'" + path + "' has a segment outside the file");
+    }
+    if (uint64_t{vaddr} + memsz > memory_size || (vaddr & 0x3) != 0) {
+      std::ostringstream ss;
+      ss << "Segment at 0x" << std::hex << std::setw(8) << std::setfill('0') << vaddr
+         << " does not fit in memory";
+      throw std::runtime_error(ss.str());
+    }
+    segments.push_back({offset, vaddr, filesz});
+  }
+  program.symbols = SymbolTable(
+      read_symbols(file, file_size, be32(file + 32), be16(file + 46), be16(file + 48)));
+
+  cpu.reset();
+  Memory& memory = cpu.get_memory();
+  for (const Segment& segment : segments) {
+    // Memory is zero after reset, which covers the p_memsz tail (.bss)
+    memory.map_image(std::shared_ptr<const uint8_t>(image, file + segment.offset), segment.filesz,
+                     segment.vaddr);
+    ++program.segments;
+    program.file_bytes += segment.filesz;
+  }
+  cpu.get_registers().set_pc(program.entry);
+  return program;
+}
+
+} // namespace ez_arch
@@ -0,0 +1,43 @@
+#include "core/execution_engine.hpp"
+#include "core/trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace ez_arch {
+
+std::unique_ptr<ExecutionEngine> ExecutionEngine::create(std::string_view name) {
+  if (name == "step") return std::make_unique<StepEngine>();
+  if (name == "stage") return std::make_unique<StageEngine>();
+  if (name == "run") return std::make_unique<RunEngine>();
+  throw std::invalid_argument("Unknown execution engine '" + std::string(name) +
+                              "' (expected step, stage or run)");
+}
+
+uint64_t StepEngine::run(CPU& cpu, uint64_t max_instructions) {
+  uint64_t start = cpu.get_instruction_count();
+  uint64_t end = start + std::min(max_instructions, CPU::UNLIMITED - start);
+  while (!cpu.is_halted() && cpu.get_instruction_count() < end) {
+    cpu.step();
+  }
+  return cpu.get_instruction_count() - start;
+}
+
+uint64_t StageEngine::run(CPU& cpu, uint64_t max_instructions) {
+  uint64_t start = cpu.get_instruction_count();
+  uint64_t end = start + std::min(max_instructions, CPU::UNLIMITED - start);
+  TraceRecord record;
+  while (!cpu.is_halted() && cpu.get_instruction_count() < end) {
+    // step_stage() runs the halt word as a no-op; step() lets the CPU see it
+    if (cpu.get_current_stage() == ExecutionStage::FETCH && !TraceRecorder::peek(cpu, record)) {
+      cpu.step();
+      continue;
+    }
+    do {
+      cpu.step_stage();
+    } while (!cpu.is_halted() && cpu.get_current_stage() != ExecutionStage::FETCH);
+  }
+  return cpu.get_instruction_count() - start;
+}
+
+} // namespace ez_arch
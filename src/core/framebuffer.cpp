@@ -0,0 +1,86 @@
+#include "core/framebuffer.hpp"
+#include "core/memory.hpp"
+#include <stdexcept>
+
+namespace ez_arch {
+
+FramebufferDevice::FramebufferDevice(unsigned width, unsigned height)
+    : m_width(width), m_height(height), m_dirty(false) {
+  if (width == 0 || height == 0) {
+    throw std::invalid_argument("Framebuffer size must be non-zero");
+  }
+  reset();
+}
+
+uint64_t FramebufferDevice::mapped_size() const {
+  uint64_t bytes = uint64_t{m_width} * m_height * 4;
+  return (bytes + Memory::PAGE_SIZE - 1) & ~uint64_t{Memory::PAGE_SIZE - 1};
+}
+
+word_t FramebufferDevice::read_word(address_t offset) {
+  size_t pixel = offset / 4;
+  if (pixel >= size_t{m_width} * m_height) return 0;  // Page padding
+
+  const uint8_t* p = &m_pixels[pixel * 4];
+  return (word_t{p[0]} << 16) | (word_t{p[1]} << 8) | word_t{p[2]};
+}
+
+void FramebufferDevice::write_word(address_t offset, word_t value) {
+  size_t pixel = offset / 4;
+  if (pixel >= size_t{m_width} * m_height) return;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  uint8_t* p = &m_pixels[pixel * 4];
+  p[0] = (value >> 16) & 0xFF;
+  p[1] = (value >> 8) & 0xFF;
+  p[2] = value & 0xFF;
+  p[3] = 0xFF;
+  m_dirtyRows[pixel / m_width] = true;
+  m_dirty = true;
+}
+
+void FramebufferDevice::reset() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_pixels.assign(size_t{m_width} * m_height * 4, 0);
+  for (size_t i = 3; i < m_pixels.size(); i += 4) {
+    m_pixels[i] = 0xFF;  // Opaque black
+  }
+  m_dirtyRows.assign(m_height, true);
+  m_dirty = true;
+}
+
+std::vector<RowSpan> FramebufferDevice::take_dirty_rows() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return take_dirty_rows_locked();
+}
+
+std::vector<RowSpan> FramebufferDevice::take_dirty_rows(std::vector<uint8_t>& rows) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  std::vector<RowSpan> spans = take_dirty_rows_locked();
+  rows.clear();
+  size_t row_bytes = size_t{m_width} * 4;
+  for (const RowSpan& span : spans) {
+    const uint8_t* first = &m_pixels[span.first * row_bytes];
+    rows.insert(rows.end(), first, first + span.count * row_bytes);
+  }
+  return spans;
+}
+
+std::vector<RowSpan> FramebufferDevice::take_dirty_rows_locked() {
+  std::vector<RowSpan> spans;
+  if (!m_dirty) return spans;
+
+  for (unsigned row = 0; row < m_height; ++row) {
+    if (!m_dirtyRows[row]) continue;
+    if (!spans.empty() && spans.back().first + spans.back().count == row) {
+      ++spans.back().count;
+    } else {
+      spans.push_back({row, 1});
+    }
+    m_dirtyRows[row] = false;
+  }
+  m_dirty = false;
+  return spans;
+}
+
+} // namespace ez_arch
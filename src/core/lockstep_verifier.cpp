@@ -0,0 +1,193 @@
+#include "core/lockstep_verifier.hpp"
+#include "core/register_names.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+namespace ez_arch {
+
+namespace {
+
+std::string word_address(address_t addr) {
+  std::ostringstream out;
+  out << "0x" << std::hex << std::setw(8) << std::setfill('0') << addr;
+  return out.str();
+}
+
+// The reference and the engine's CPU side by side, with the dirty epochs
+// memory is compared since
+class Lockstep {
+public:
+  // step() never stops on a repeated state, so the engine must not either
+  Lockstep(CPU& cpu, ExecutionEngine& engine)
+      : m_cpu(cpu), m_reference(cpu.fork()), m_engine(engine),
+        m_detectLoops(cpu.loop_detection()) {
+    m_cpu.set_loop_detection(false);
+    m_reference.set_loop_detection(false);
+    checkpoint();
+  }
+  ~Lockstep() { m_cpu.set_loop_detection(m_detectLoops); }
+
+  CPU& reference() { return m_reference; }
+
+  // Run the reference through up to `count` instructions, or to the end of
+  // its block, then the engine through as many
+  void advance(uint64_t count, bool block) {
+    uint64_t before = m_reference.get_instruction_count();
+    while (!m_reference.is_halted() && m_reference.get_instruction_count() - before < count) {
+      address_t pc = m_reference.get_registers().get_pc();
+      m_reference.step();
+      if (block && m_reference.get_registers().get_pc() != pc + 4) break;
+    }
+    uint64_t retired = m_reference.get_instruction_count() - before;
+    m_engine.run(m_cpu, retired + (m_reference.is_halted() ? 1 : 0));
+  }
+
+  // Differences since the last call; starts new epochs
+  std::vector<StateDifference> compare();
+
+  void checkpoint() {
+    m_referenceCheckpoint = m_reference.snapshot();
+    m_cpuCheckpoint = m_cpu.snapshot();
+    begin_epochs();
+  }
+
+  void rewind() {
+    m_reference.restore(*m_referenceCheckpoint);
+    m_cpu.restore(*m_cpuCheckpoint);
+    begin_epochs();
+  }
+
+private:
+  CPU& m_cpu;
+  CPU m_reference;
+  ExecutionEngine& m_engine;
+  bool m_detectLoops;
+  std::shared_ptr<const CPU::Snapshot> m_referenceCheckpoint;
+  std::shared_ptr<const CPU::Snapshot> m_cpuCheckpoint;
+  uint64_t m_referenceEpoch = 0;
+  uint64_t m_cpuEpoch = 0;
+
+  void begin_epochs() {
+    m_referenceEpoch = m_reference.get_memory().begin_epoch();
+    m_cpuEpoch = m_cpu.get_memory().begin_epoch();
+  }
+};
+
+std::vector<StateDifference> Lockstep::compare() {
+  std::vector<StateDifference> differences;
+  auto differ = [&](std::string location, uint64_t expected, uint64_t actual) {
+    if (expected != actual) differences.push_back({std::move(location), expected, actual});
+  };
+
+  const RegisterFile& expected = m_reference.get_registers();
+  const RegisterFile& actual = m_cpu.get_registers();
+  differ("PC", expected.get_pc(), actual.get_pc());
+  for (register_id_t i = 1; i < RegisterFile::NUM_REGISTERS; ++i) {
+    differ(std::string(REGISTER_NAMES[i]), expected.read(i), actual.read(i));
+  }
+  differ("instructions", m_reference.get_instruction_count(), m_cpu.get_instruction_count());
+  differ("halted", m_reference.is_halted(), m_cpu.is_halted());
+  differ("faulted", m_reference.is_faulted(), m_cpu.is_faulted());
+  differ("stage", static_cast<uint64_t>(m_reference.get_current_stage()),
+         static_cast<uint64_t>(m_cpu.get_current_stage()));
+
+  // Any page either side wrote; the rest still match
+  Memory& memory = m_cpu.get_memory();
+  std::vector<address_t> pages = m_reference.get_memory().pages_written_since(m_referenceEpoch);
+  std::vector<address_t> written = memory.pages_written_since(m_cpuEpoch);
+  pages.insert(pages.end(), written.begin(), written.end());
+  std::sort(pages.begin(), pages.end());
+  pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+  // Comparing must not count as a watched read
+  bool had_hit = memory.watch_hit().has_value();
+  size_t memory_differences = 0;
+  for (address_t base : pages) {
+    for (address_t offset = 0; offset < Memory::PAGE_SIZE; offset += 4) {
+      word_t want = m_reference.get_memory().read_word(base + offset);
+      word_t got = memory.read_word(base + offset);
+      if (want != got && memory_differences++ < LockstepVerifier::MAX_MEMORY_DIFFERENCES) {
+        differences.push_back({word_address(base + offset), want, got});
+      }
+    }
+  }
+  if (!had_hit) memory.clear_watch_hit();
+
+  begin_epochs();
+  return differences;
+}
+
+} // namespace
+
+VerifyResult LockstepVerifier::run(CPU& cpu, ExecutionEngine& engine, const VerifyConfig& config) {
+  if (config.granularity == VerifyGranularity::INTERVAL && config.interval == 0) {
+    throw std::invalid_argument("Verification interval must be non-zero");
+  }
+  uint64_t unit = CPU::UNLIMITED;
+  if (config.granularity == VerifyGranularity::INSTRUCTION) unit = 1;
+  if (config.granularity == VerifyGranularity::INTERVAL) unit = config.interval;
+  bool block = config.granularity == VerifyGranularity::BLOCK;
+
+  Lockstep lockstep(cpu, engine);
+  CPU& reference = lockstep.reference();
+  uint64_t start = reference.get_instruction_count();
+  uint64_t end = start + std::min(config.max_instructions, CPU::UNLIMITED - start);
+  uint64_t checkpoint = start;
+
+  VerifyResult result;
+  while (!reference.is_halted() && reference.get_instruction_count() < end) {
+    uint64_t before = reference.get_instruction_count();
+    address_t pc = reference.get_registers().get_pc();
+    word_t word = reference.get_memory().read_word(pc);
+    lockstep.advance(std::min(unit, end - before), block);
+    ++result.comparisons;
+
+    std::vector<StateDifference> differences = lockstep.compare();
+    if (differences.empty()) {
+      result.instructions = reference.get_instruction_count() - start;
+      if (reference.get_instruction_count() - checkpoint >= CHECKPOINT_INTERVAL) {
+        lockstep.checkpoint();
+        checkpoint = reference.get_instruction_count();
+      }
+      continue;
+    }
+
+    // Only one instruction ran (fetching the halt word counts): that is the one
+    uint64_t failed_at = reference.get_instruction_count();
+    bool failed_halted = reference.is_halted();
+    if (failed_at - before + (failed_halted ? 1 : 0) <= 1) {
+      result.divergence = Divergence{before, pc, word, std::move(differences)};
+      break;
+    }
+
+    // Otherwise repeat the stretch since the checkpoint one at a time
+    lockstep.rewind();
+    while (!reference.is_halted() &&
+           (reference.get_instruction_count() < failed_at || failed_halted)) {
+      uint64_t at = reference.get_instruction_count();
+      address_t at_pc = reference.get_registers().get_pc();
+      lockstep.advance(1, false);
+      std::vector<StateDifference> exact = lockstep.compare();
+      if (!exact.empty()) {
+        result.instructions = at - start;
+        result.divergence = Divergence{at, at_pc, reference.get_current_instruction(),
+                                       std::move(exact)};
+        break;
+      }
+    }
+    // An engine that does not repeat itself only gets the stretch pinned
+    // down, named by its first instruction
+    if (!result.divergence) {
+      result.divergence = Divergence{before, pc, word, std::move(differences)};
+    }
+    break;
+  }
+
+  result.halted = cpu.is_halted();
+  return result;
+}
+
+} // namespace ez_arch
@@ -0,0 +1,51 @@
+#include "core/mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define EZ_ARCH_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ez_arch {
+
+std::shared_ptr<const uint8_t> map_file(const std::string& path, size_t& size) {
+#ifdef EZ_ARCH_HAS_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Could not open '" + path + "': " + std::strerror(errno));
+  }
+  struct stat info {};
+  if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+    ::close(fd);
+    throw std::runtime_error("'" + path + "' is empty or unreadable");
+  }
+  size = static_cast<size_t>(info.st_size);
+  void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Could not map '" + path + "': " + std::strerror(errno));
+  }
+  return std::shared_ptr<const uint8_t>(static_cast<const uint8_t*>(data),
+                                        [size](const uint8_t* p) {
+                                          ::munmap(const_cast<uint8_t*>(p), size);
+                                        });
+#else
+  std::ifstream file(path, std::ios::binary);
+  if (!file) throw std::runtime_error("Could not open '" + path + "'");
+  auto bytes = std::make_shared<std::vector<uint8_t>>(std::istreambuf_iterator<char>(file),
+                                                      std::istreambuf_iterator<char>());
+  if (bytes->empty()) throw std::runtime_error("'" + path + "' is empty or unreadable");
+  size = bytes->size();
+  return std::shared_ptr<const uint8_t>(bytes, bytes->data());
+#endif
+}
+
+} // namespace ez_arch
@@ -1,65 +1,752 @@
 #include <cassert>
 #include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
 
 #include "core/memory.hpp"
 
 namespace ez_arch {
-    
-    void Memory::check_alignment(address_t addr) const {
-        assert((addr & 0x3) == 0);
+
+    namespace {
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    constexpr bool HOST_IS_BIG_ENDIAN = true;
+#else
+    constexpr bool HOST_IS_BIG_ENDIAN = false;
+#endif
+
+    // Plain shift-and-mask form so the compiler can vectorize it into byte shuffles
+    void byteswap_words(word_t* words, size_t count) {
+      for (size_t i = 0; i < count; ++i) {
+        word_t w = words[i];
+        words[i] = (w >> 24) | ((w >> 8) & 0x0000FF00) | ((w << 8) & 0x00FF0000) | (w << 24);
+      }
+    }
+
+    std::string fault_message(MemoryFault::Kind kind, address_t addr) {
+      std::ostringstream ss;
+      ss << (kind == MemoryFault::Kind::MISALIGNED ? "Misaligned access at 0x"
+                                                    : "Out of range access at 0x")
+         << std::hex << std::setw(8) << std::setfill('0') << addr;
+      return ss.str();
+    }
+
+    } // namespace
+
+    MemoryFault::MemoryFault(Kind kind, address_t addr)
+        : std::runtime_error(fault_message(kind, addr)), m_kind(kind), m_addr(addr) {}
+
+    Memory::Memory(uint64_t size) : m_size(size), m_residentPages(0), m_epoch(0) {
+      assert(size <= ADDRESS_SPACE_SIZE);
+      build_directory();
+    }
+
+    Memory::Memory(const Memory& other)
+        : m_size(other.m_size), m_residentPages(0), m_epoch(0) {
+      *this = other;
+    }
+
+    Memory& Memory::operator=(const Memory& other) {
+      if (this == &other) return *this;
+      assign(other, false);
+      return *this;
+    }
+
+    Memory Memory::fork() {
+      // Both sides must trap their next write to a now shared page
+      write_protect_resident();
+
+      Memory child(0);
+      child.assign(*this, true);
+      return child;
+    }
+
+    void Memory::assign(const Memory& other, bool share_pages) {
+      m_size = other.m_size;
+      m_residentPages = other.m_residentPages;
+      m_residentList = other.m_residentList;
+      m_devices = other.m_devices;
+      m_clockedDevices = other.m_clockedDevices;
+      m_images = other.m_images;
+      m_lazyList = other.m_lazyList;
+      m_writtenList = other.m_writtenList;
+      m_watches = other.m_watches;
+      m_watchHit.reset();
+      for (DeviceMapping& mapping : m_devices) {
+        if (auto copy = mapping.device->clone()) mapping.device = std::move(copy);
+      }
+      m_epoch = other.m_epoch;
+      m_ownedTables.clear();
+
+      for (size_t dir = 0; dir < TABLE_SIZE; ++dir) {
+        const PageTable* source = other.m_directory[dir];
+        if (is_shared(source)) {
+          m_directory[dir] = const_cast<PageTable*>(source);
+          continue;
+        }
+
+        auto table = std::make_unique<PageTable>();
+        for (size_t i = 0; i < TABLE_SIZE; ++i) {
+          table->entries[i] = source->entries[i];
+          if (source->pages[i]) {
+            table->pages[i] = share_pages ? source->pages[i]
+                                          : std::make_shared<Page>(*source->pages[i]);
+            table->entries[i].page = table->pages[i].get();
+          }
+        }
+        m_directory[dir] = table.get();
+        m_ownedTables.push_back(std::move(table));
+      }
+    }
+
+    Memory::Memory(Memory&& other) noexcept : m_size(0), m_residentPages(0), m_epoch(0) {
+      *this = std::move(other);
     }
 
-    void Memory::check_bounds(address_t addr, size_t access_size) const {
-        assert((addr + access_size) <= m_memory.size());
+    Memory& Memory::operator=(Memory&& other) noexcept {
+      if (this == &other) return *this;
+
+      m_directory = other.m_directory;
+      m_ownedTables = std::move(other.m_ownedTables);
+      m_residentList = std::move(other.m_residentList);
+      m_devices = std::move(other.m_devices);
+      m_clockedDevices = std::move(other.m_clockedDevices);
+      m_images = std::move(other.m_images);
+      m_lazyList = std::move(other.m_lazyList);
+      m_writtenList = std::move(other.m_writtenList);
+      m_watches = std::move(other.m_watches);
+      m_watchHit = other.m_watchHit;
+      m_size = other.m_size;
+      m_residentPages = other.m_residentPages;
+      m_epoch = other.m_epoch;
+
+      // The moved-from memory faults on every access until reset()
+      other.m_directory.fill(&guard_table());
+      other.m_ownedTables.clear();
+      other.m_residentList.clear();
+      other.m_devices.clear();
+      other.m_clockedDevices.clear();
+      other.m_images.clear();
+      other.m_lazyList.clear();
+      other.m_writtenList.clear();
+      other.m_watches.clear();
+      other.m_watchHit.reset();
+      other.m_residentPages = 0;
+      return *this;
+    }
+
+    Memory::Page& Memory::zero_page() {
+      static Page zero{};
+      return zero;
+    }
+
+    Memory::PageTable& Memory::empty_table() {
+      static PageTable table = [] {
+        PageTable t;
+        t.entries.fill({&zero_page(), TRAP_WRITE, 0});
+        return t;
+      }();
+      return table;
+    }
+
+    Memory::PageTable& Memory::guard_table() {
+      static PageTable table = [] {
+        PageTable t;
+        t.entries.fill({&zero_page(), TRAP_READ | TRAP_WRITE, 0});
+        return t;
+      }();
+      return table;
+    }
+
+    void Memory::build_directory() {
+      constexpr uint64_t REGION_SIZE = uint64_t{PAGE_SIZE} << TABLE_BITS;
+
+      m_ownedTables.clear();
+      for (size_t dir = 0; dir < TABLE_SIZE; ++dir) {
+        uint64_t region_start = dir * REGION_SIZE;
+        if (region_start + REGION_SIZE <= m_size) {
+          m_directory[dir] = &empty_table();
+        } else if (region_start >= m_size) {
+          m_directory[dir] = &guard_table();
+        } else {
+          // The region holding the end of memory gets per-page traps
+          m_directory[dir] = &guard_table();
+          PageTable& table = own_table(static_cast<address_t>(region_start));
+          for (size_t i = 0; i < TABLE_SIZE; ++i) {
+            uint64_t page_start = region_start + i * PAGE_SIZE;
+            table.entries[i] = {&zero_page(),
+                                static_cast<uint8_t>(resident_trap(page_start) | TRAP_WRITE), 0};
+          }
+        }
+      }
+    }
+
+    uint8_t Memory::resident_trap(uint64_t page_start) const {
+      // Pages that are not wholly inside memory keep checking every access
+      uint8_t trap = (page_start + PAGE_SIZE <= m_size) ? 0 : TRAP_READ | TRAP_WRITE;
+      return static_cast<uint8_t>(trap | watch_trap(page_start));
+    }
+
+    uint8_t Memory::watch_trap(uint64_t page_start) const {
+      if (m_watches.empty()) return 0;
+
+      // Watches do not overlap, so their ends are sorted too
+      uint64_t page_end = page_start + PAGE_SIZE;
+      auto it = std::partition_point(m_watches.begin(), m_watches.end(), [&](const Watchpoint& w) {
+        return w.start + uint64_t{w.length} <= page_start;
+      });
+      uint8_t trap = 0;
+      for (; it != m_watches.end() && it->start < page_end; ++it) {
+        trap |= TRAP_WATCH | TRAP_WRITE;
+        if (it->on_read) trap |= TRAP_READ;
+      }
+      return trap;
+    }
+
+    void Memory::refresh_watch_traps(const Watchpoint& watch) {
+      uint64_t end = uint64_t{watch.start} + watch.length;
+      for (uint64_t page = watch.start & ~uint64_t{PAGE_OFFSET_MASK}; page < end; page += PAGE_SIZE) {
+        address_t base = static_cast<address_t>(page);
+        PageEntry& e = owned_entry(base);
+        if (e.trap & (TRAP_DEVICE | TRAP_LAZY)) {
+          // These trap every access anyway; only the watch bit changes
+          e.trap = static_cast<uint8_t>((e.trap & ~TRAP_WATCH) | (watch_trap(page) & TRAP_WATCH));
+        } else {
+          // The write trap stays set: the page may be shared or due a dirty stamp
+          e.trap = static_cast<uint8_t>(resident_trap(page) | TRAP_WRITE);
+        }
+      }
+    }
+
+    void Memory::note_access(address_t addr, uint64_t size, bool write) const {
+      if (m_watchHit) return;  // Keep the first hit
+      uint64_t end = uint64_t{addr} + size;
+      auto it = std::partition_point(m_watches.begin(), m_watches.end(), [&](const Watchpoint& w) {
+        return w.start + uint64_t{w.length} <= addr;
+      });
+      for (; it != m_watches.end() && it->start < end; ++it) {
+        if (write || it->on_read) {
+          m_watchHit = WatchHit{addr, write};
+          return;
+        }
+      }
+    }
+
+    Memory::PageTable& Memory::own_table(address_t addr) {
+      PageTable*& slot = m_directory[addr >> (PAGE_SHIFT + TABLE_BITS)];
+      if (!is_shared(slot)) return *slot;
+
+      auto table = std::make_unique<PageTable>();
+      table->entries = slot->entries;
+      slot = table.get();
+      m_ownedTables.push_back(std::move(table));
+      return *slot;
+    }
+
+    Memory::PageEntry& Memory::owned_entry(address_t addr) {
+      return own_table(addr).entries[(addr >> PAGE_SHIFT) & (TABLE_SIZE - 1)];
+    }
+
+    Memory::Page& Memory::writable_page(address_t addr) {
+      PageTable& table = own_table(addr);
+      size_t index = (addr >> PAGE_SHIFT) & (TABLE_SIZE - 1);
+      PageEntry& e = table.entries[index];
+      std::shared_ptr<Page>& page = table.pages[index];
+
+      if (!page) {
+        page = std::make_shared<Page>();
+        if (e.trap & TRAP_LAZY) {
+          // First touch of an image page: copy it in
+          const ImageMapping& image = m_images[e.index];
+          address_t base = addr & ~PAGE_OFFSET_MASK;
+          std::memcpy(page->words.data(), image.data.get() + (base - image.base), PAGE_SIZE);
+          if (!HOST_IS_BIG_ENDIAN) {
+            byteswap_words(page->words.data(), WORDS_PER_PAGE);
+          }
+        }
+        m_residentList.push_back(addr & ~PAGE_OFFSET_MASK);
+        ++m_residentPages;
+      } else if (page.use_count() > 1) {
+        // Shared with a fork: take a private copy
+        page = std::make_shared<Page>(*page);
+      }
+      e.page = page.get();
+      return *page;
+    }
+
+    Memory::Page& Memory::page_for_write(address_t addr) {
+      Page& page = writable_page(addr);
+      address_t base = addr & ~PAGE_OFFSET_MASK;
+
+      // First write this epoch: stamp the page and stop trapping its writes
+      page.epoch = m_epoch;
+      PageEntry& e = owned_entry(base);
+      uint8_t trap = resident_trap(base);
+      if ((e.trap & TRAP_WRITE) && !(trap & TRAP_WRITE)) m_writtenList.push_back(base);
+      e.trap = trap;
+      return page;
+    }
+
+    void Memory::release_page(address_t addr) {
+      PageTable& table = own_table(addr);
+      size_t index = (addr >> PAGE_SHIFT) & (TABLE_SIZE - 1);
+      table.pages[index].reset();
+      table.entries[index] = {&zero_page(),
+                              static_cast<uint8_t>(resident_trap(addr) | TRAP_WRITE), 0};
+      --m_residentPages;
+    }
+
+    void Memory::materialize(address_t addr) const {
+      // Copying in keeps the contents the same, so const readers may do it
+      Memory& self = const_cast<Memory&>(*this);
+      address_t base = addr & ~PAGE_OFFSET_MASK;
+      self.writable_page(base);
+      self.owned_entry(base).trap = static_cast<uint8_t>(resident_trap(base) | TRAP_WRITE);
+    }
+
+    void Memory::materialize_all() const {
+      for (address_t base : m_lazyList) {
+        if (entry(base).trap & TRAP_LAZY) materialize(base);
+      }
+      const_cast<Memory&>(*this).m_lazyList.clear();
+    }
+
+    size_t Memory::lazy_pages() const {
+      return static_cast<size_t>(std::count_if(m_lazyList.begin(), m_lazyList.end(),
+          [this](address_t base) { return (entry(base).trap & TRAP_LAZY) != 0; }));
+    }
+
+    void Memory::check_access(address_t addr, size_t access_size, size_t alignment) const {
+      if ((addr & (alignment - 1)) != 0) {
+        throw MemoryFault(MemoryFault::Kind::MISALIGNED, addr);
+      }
+      if (static_cast<uint64_t>(addr) + access_size > m_size) {
+        throw MemoryFault(MemoryFault::Kind::OUT_OF_RANGE, addr);
+      }
+    }
+
+    word_t Memory::read_word_slow(address_t addr) const {
+      check_access(addr, WORD_ACCESS_SIZE, WORD_ACCESS_SIZE);
+      if (entry(addr).trap & TRAP_WATCH) note_access(addr, WORD_ACCESS_SIZE, false);
+      if (entry(addr).trap & TRAP_DEVICE) {
+        ++m_deviceAccesses;
+        const DeviceMapping& mapping = device_at(addr);
+        return mapping.device->read_word(addr - mapping.base);
+      }
+      if (entry(addr).trap & TRAP_LAZY) materialize(addr);
+      return entry(addr).page->words[word_index(addr)];
+    }
+
+    void Memory::write_word_slow(address_t addr, word_t value) {
+      check_access(addr, WORD_ACCESS_SIZE, WORD_ACCESS_SIZE);
+      if (entry(addr).trap & TRAP_WATCH) note_access(addr, WORD_ACCESS_SIZE, true);
+      if (entry(addr).trap & TRAP_DEVICE) {
+        ++m_deviceAccesses;
+        const DeviceMapping& mapping = device_at(addr);
+        mapping.device->write_word(addr - mapping.base, value);
+        return;
+      }
+      page_for_write(addr).words[word_index(addr)] = value;
+    }
+
+    uint8_t Memory::read_byte_slow(address_t addr) const {
+      check_access(addr, BYTE_ACCESS_SIZE, BYTE_ACCESS_SIZE);
+      if (entry(addr).trap & TRAP_WATCH) note_access(addr, BYTE_ACCESS_SIZE, false);
+      if (entry(addr).trap & TRAP_DEVICE) {
+        ++m_deviceAccesses;
+        const DeviceMapping& mapping = device_at(addr);
+        return mapping.device->read_byte(addr - mapping.base);
+      }
+      if (entry(addr).trap & TRAP_LAZY) materialize(addr);
+      return (entry(addr).page->words[word_index(addr)] >> byte_shift(addr)) & 0xFF;
     }
 
-    word_t Memory::read_word(address_t addr) const {
-      check_alignment(addr);
-      check_bounds(addr, WORD_ACCESS_SIZE);
-      word_t result = (m_memory[addr] << 24)     |
-                      (m_memory[addr + 1] << 16) |
-                      (m_memory[addr + 2] << 8)  |
-                      (m_memory[addr + 3]); // Combine bytes into word (big endian)
-      return result;
+    void Memory::write_byte_slow(address_t addr, uint8_t value) {
+      check_access(addr, BYTE_ACCESS_SIZE, BYTE_ACCESS_SIZE);
+      if (entry(addr).trap & TRAP_WATCH) note_access(addr, BYTE_ACCESS_SIZE, true);
+      if (entry(addr).trap & TRAP_DEVICE) {
+        ++m_deviceAccesses;
+        const DeviceMapping& mapping = device_at(addr);
+        mapping.device->write_byte(addr - mapping.base, value);
+        return;
+      }
+      word_t& word = page_for_write(addr).words[word_index(addr)];
+      unsigned shift = byte_shift(addr);
+      word = (word & ~(word_t{0xFF} << shift)) | (static_cast<word_t>(value) << shift);
     }
 
-    void Memory::write_word(address_t addr, word_t value) {
-      check_alignment(addr);
-      check_bounds(addr, WORD_ACCESS_SIZE);
-      m_memory[addr]     = (value >> 24) & 0xFF;
-      m_memory[addr + 1] = (value >> 16) & 0xFF;
-      m_memory[addr + 2] = (value >> 8) & 0xFF;
-      m_memory[addr + 3] = value & 0xFF;
+    void Memory::load_program(const std::vector<word_t>& program, address_t start_addr){
+      load_words(program.data(), program.size(), start_addr);
     }
-    
-    uint8_t Memory::read_byte(address_t addr) const {
-      check_bounds(addr, BYTE_ACCESS_SIZE);
-      return m_memory[addr];
+
+    void Memory::load_words(const word_t* words, size_t count_words, address_t start_addr) {
+      check_access(start_addr, count_words * WORD_ACCESS_SIZE, WORD_ACCESS_SIZE);
+
+      // Words are already in host order: copy a page at a time
+      size_t copied = 0;
+      while (copied < count_words) {
+        address_t addr = start_addr + static_cast<address_t>(copied * WORD_ACCESS_SIZE);
+        size_t index = word_index(addr);
+        size_t count = std::min(count_words - copied, WORDS_PER_PAGE - index);
+        if (entry(addr).trap & TRAP_DEVICE) {
+          for (size_t i = 0; i < count; ++i) {
+            write_word_slow(addr + static_cast<address_t>(i * WORD_ACCESS_SIZE),
+                            words[copied + i]);
+          }
+        } else {
+          std::memcpy(&page_for_write(addr).words[index], words + copied,
+                      count * WORD_ACCESS_SIZE);
+        }
+        copied += count;
+      }
     }
 
-    void Memory::write_byte(address_t addr, uint8_t value) {
-      check_bounds(addr, BYTE_ACCESS_SIZE);
-      m_memory[addr] = value;
+    void Memory::load_image(const uint8_t* data, size_t size, address_t start_addr) {
+      check_access(start_addr, size, WORD_ACCESS_SIZE);
+
+      size_t whole_words = size / WORD_ACCESS_SIZE;
+      size_t copied = 0;
+      while (copied < whole_words) {
+        address_t addr = start_addr + static_cast<address_t>(copied * WORD_ACCESS_SIZE);
+        size_t index = word_index(addr);
+        size_t count = std::min(whole_words - copied, WORDS_PER_PAGE - index);
+        if (entry(addr).trap & TRAP_DEVICE) {
+          // Devices see the image one byte at a time, in order
+          for (size_t i = 0; i < count * WORD_ACCESS_SIZE; ++i) {
+            write_byte_slow(addr + static_cast<address_t>(i),
+                            data[copied * WORD_ACCESS_SIZE + i]);
+          }
+          copied += count;
+          continue;
+        }
+        word_t* words = &page_for_write(addr).words[index];
+        std::memcpy(words, data + copied * WORD_ACCESS_SIZE, count * WORD_ACCESS_SIZE);
+        if (!HOST_IS_BIG_ENDIAN) {
+          byteswap_words(words, count);
+        }
+        copied += count;
+      }
+
+      // Trailing partial word
+      for (size_t i = whole_words * WORD_ACCESS_SIZE; i < size; ++i) {
+        write_byte(start_addr + static_cast<address_t>(i), data[i]);
+      }
     }
-    
-    void Memory::load_program(const std::vector<word_t>& program, address_t start_addr){ 
-      const size_t program_size = program.size();
-      
-      check_bounds(start_addr, program_size * WORD_ACCESS_SIZE);
-      check_alignment(start_addr);
 
-      // For overflow wrapping:
-      // size_t bytes_needed = program_size * WORD_ACCESS_SIZE; // Check if program fits
-      // assert(bytes_needed / WORD_ACCESS_SIZE == program_size); // Overflow check
-      // assert(start_addr + bytes_needed <= m_memory.size());     // Bounds check
+    void Memory::map_image(std::shared_ptr<const uint8_t> image, size_t size, address_t start_addr) {
+      check_access(start_addr, size, WORD_ACCESS_SIZE);
+
+      uint64_t end = uint64_t{start_addr} + size;
+      uint64_t first = (uint64_t{start_addr} + PAGE_OFFSET_MASK) & ~uint64_t{PAGE_OFFSET_MASK};
+      uint64_t last = end & ~uint64_t{PAGE_OFFSET_MASK};
+      if (first >= last || m_images.size() > UINT16_MAX) {
+        load_image(image.get(), size, start_addr);
+        return;
+      }
+
+      // Partial pages at either end are copied now
+      const uint8_t* data = image.get();
+      load_image(data, first - start_addr, start_addr);
+      load_image(data + (last - start_addr), end - last, static_cast<address_t>(last));
 
-      for (size_t i = 0; i < program_size; ++i) {
-        write_word(start_addr + (i * 4), program[i]);
+      uint16_t index = static_cast<uint16_t>(m_images.size());
+      m_images.push_back({start_addr, image});
+      for (uint64_t page = first; page < last; page += PAGE_SIZE) {
+        address_t base = static_cast<address_t>(page);
+        PageTable& table = own_table(base);
+        size_t slot = (base >> PAGE_SHIFT) & (TABLE_SIZE - 1);
+        if (table.pages[slot] || (table.entries[slot].trap & (TRAP_DEVICE | TRAP_LAZY))) {
+          // Already holds data or a device: no point deferring
+          load_image(data + (page - start_addr), PAGE_SIZE, base);
+          continue;
+        }
+        table.entries[slot] = {
+            &zero_page(),
+            static_cast<uint8_t>(TRAP_READ | TRAP_WRITE | TRAP_LAZY | (watch_trap(page) & TRAP_WATCH)),
+            index};
+        m_lazyList.push_back(base);
       }
     }
 
     void Memory::reset() {
-      std::fill(m_memory.begin(), m_memory.end(), 0);
+      // Dropping the owned tables frees every page; untouched regions cost nothing
+      build_directory();
+      m_residentList.clear();
+      m_residentPages = 0;
+      m_images.clear();
+      m_lazyList.clear();
+      m_writtenList.clear();
+
+      // Devices and watches stay set across resets
+      for (size_t i = 0; i < m_devices.size(); ++i) {
+        m_devices[i].device->reset();
+        apply_device_mapping(i);
+      }
+      for (const Watchpoint& watch : m_watches) {
+        refresh_watch_traps(watch);
+      }
+      m_watchHit.reset();
+    }
+
+    void Memory::map_device(address_t base, uint64_t size, std::shared_ptr<Device> device) {
+      if (!device) {
+        throw std::invalid_argument("Cannot map a null device");
+      }
+      if ((base & PAGE_OFFSET_MASK) != 0 || (size & PAGE_OFFSET_MASK) != 0 || size == 0) {
+        throw std::invalid_argument("Device ranges must be whole, page aligned pages");
+      }
+      if (static_cast<uint64_t>(base) + size > m_size) {
+        throw std::invalid_argument("Device range lies outside memory");
+      }
+      for (const DeviceMapping& mapping : m_devices) {
+        if (base < mapping.base + mapping.size && mapping.base < base + size) {
+          throw std::invalid_argument("Device range overlaps another device");
+        }
+      }
+      if (m_devices.size() > UINT16_MAX) {
+        throw std::invalid_argument("Too many devices");
+      }
+
+      if (device->clocked()) m_clockedDevices.push_back(m_devices.size());
+      m_devices.push_back({base, size, std::move(device)});
+      apply_device_mapping(m_devices.size() - 1);
+    }
+
+    void Memory::tick_devices(uint64_t cycle) {
+      for (size_t index : m_clockedDevices) {
+        m_devices[index].device->tick(*this, cycle);
+      }
+    }
+
+    bool Memory::devices_busy() const {
+      return std::any_of(m_devices.begin(), m_devices.end(),
+                         [](const DeviceMapping& mapping) { return mapping.device->busy(); });
+    }
+
+    void Memory::copy_block(address_t dst, address_t src, uint64_t length) {
+      if (length == 0) return;
+      check_access(src, length, BYTE_ACCESS_SIZE);
+      check_access(dst, length, BYTE_ACCESS_SIZE);
+
+      // Copy from the end when the destination overlaps the source from above,
+      // so no source byte is overwritten before it is read
+      bool backward = dst > src && dst < src + length;
+
+      if (((src | dst | length) & 0x3) != 0) {
+        for (uint64_t n = 0; n < length; ++n) {
+          uint64_t i = backward ? length - 1 - n : n;
+          write_byte(static_cast<address_t>(dst + i), read_byte(static_cast<address_t>(src + i)));
+        }
+        return;
+      }
+
+      // Chunks never cross a page on either side
+      uint64_t remaining = length;
+      while (remaining > 0) {
+        uint64_t done = length - remaining;
+        uint64_t chunk;
+        address_t from;
+        address_t to;
+        if (backward) {
+          address_t from_end = static_cast<address_t>(src + remaining - 1);
+          address_t to_end = static_cast<address_t>(dst + remaining - 1);
+          chunk = std::min({remaining, uint64_t{(from_end & PAGE_OFFSET_MASK) + 1u},
+                            uint64_t{(to_end & PAGE_OFFSET_MASK) + 1u}});
+          from = static_cast<address_t>(src + remaining - chunk);
+          to = static_cast<address_t>(dst + remaining - chunk);
+        } else {
+          from = static_cast<address_t>(src + done);
+          to = static_cast<address_t>(dst + done);
+          chunk = std::min({remaining, uint64_t{PAGE_SIZE - (from & PAGE_OFFSET_MASK)},
+                            uint64_t{PAGE_SIZE - (to & PAGE_OFFSET_MASK)}});
+        }
+
+        if ((entry(from).trap | entry(to).trap) & TRAP_DEVICE) {
+          for (uint64_t n = 0; n < chunk; n += WORD_ACCESS_SIZE) {
+            uint64_t i = backward ? chunk - WORD_ACCESS_SIZE - n : n;
+            write_word(static_cast<address_t>(to + i), read_word(static_cast<address_t>(from + i)));
+          }
+        } else {
+          if (entry(from).trap & TRAP_WATCH) note_access(from, chunk, false);
+          if (entry(to).trap & TRAP_WATCH) note_access(to, chunk, true);
+          if (entry(from).trap & TRAP_LAZY) materialize(from);
+          // Resolve the destination first: it may replace a shared page
+          word_t* out = &page_for_write(to).words[word_index(to)];
+          const word_t* in = &entry(from).page->words[word_index(from)];
+          std::memmove(out, in, chunk);
+        }
+        remaining -= chunk;
+      }
+    }
+
+    void Memory::apply_device_mapping(size_t index) {
+      const DeviceMapping& mapping = m_devices[index];
+      uint64_t end = mapping.base + mapping.size;
+
+      // Drop any RAM the device now covers
+      size_t kept = 0;
+      for (address_t base : m_residentList) {
+        if (base >= mapping.base && base < end) {
+          release_page(base);
+          continue;
+        }
+        m_residentList[kept++] = base;
+      }
+      m_residentList.resize(kept);
+
+      for (uint64_t page = mapping.base; page < end; page += PAGE_SIZE) {
+        owned_entry(static_cast<address_t>(page)) = {
+            &zero_page(),
+            static_cast<uint8_t>(TRAP_READ | TRAP_WRITE | TRAP_DEVICE | (watch_trap(page) & TRAP_WATCH)),
+            static_cast<uint16_t>(index)};
+      }
+    }
+
+    void Memory::write_protect_resident() {
+      for (address_t base : m_residentList) {
+        PageEntry& e = owned_entry(base);
+        // Skip the store when already set, so forking a frozen memory never writes
+        if (!(e.trap & TRAP_WRITE)) e.trap |= TRAP_WRITE;
+      }
+      if (!m_writtenList.empty()) m_writtenList.clear();
+    }
+
+    uint64_t Memory::begin_epoch() {
+      ++m_epoch;
+      // Only pages written since the last epoch began stopped trapping writes
+      for (address_t base : m_writtenList) {
+        if (!(entry(base).trap & TRAP_WRITE)) owned_entry(base).trap |= TRAP_WRITE;
+      }
+      m_writtenList.clear();
+      return m_epoch;
+    }
+
+    size_t Memory::shared_pages() const {
+      size_t shared = 0;
+      for (address_t base : m_residentList) {
+        const PageTable* table = m_directory[base >> (PAGE_SHIFT + TABLE_BITS)];
+        if (table->pages[(base >> PAGE_SHIFT) & (TABLE_SIZE - 1)].use_count() > 1) ++shared;
+      }
+      return shared;
+    }
+
+    std::vector<address_t> Memory::pages_written_since(uint64_t epoch) const {
+      std::vector<address_t> pages;
+      for (address_t base : m_residentList) {
+        if (entry(base).page->epoch >= epoch) pages.push_back(base);
+      }
+      return pages;
+    }
+
+    uint64_t Memory::restore_since(const Memory& baseline, uint64_t epoch) {
+      assert(baseline.m_size == m_size);
+
+      size_t kept = 0;
+      for (address_t base : m_residentList) {
+        const Page& page = *entry(base).page;
+        if (page.epoch >= epoch) {
+          const PageEntry& origin = baseline.entry(base);
+          const Page& source = *origin.page;
+          if (origin.trap & TRAP_LAZY) {
+            // Not copied in at the baseline: map the same image page again
+            release_page(base);
+            owned_entry(base) = origin;
+            owned_entry(base).trap = static_cast<uint8_t>((origin.trap & ~TRAP_WATCH) |
+                                                          (watch_trap(base) & TRAP_WATCH));
+            if (std::find(m_lazyList.begin(), m_lazyList.end(), base) == m_lazyList.end()) {
+              m_lazyList.push_back(base);
+            }
+            continue;
+          }
+          if (&source == &zero_page()) {
+            // Allocated after the baseline: drop it again
+            release_page(base);
+            continue;
+          }
+          if (&source != &page) {
+            Page& restored = writable_page(base);
+            restored.words = source.words;
+            restored.epoch = m_epoch;  // Changed, as far as other trackers know
+          }
+        }
+        m_residentList[kept++] = base;
+      }
+      m_residentList.resize(kept);
+
+      return begin_epoch();
+    }
+
+    void Memory::add_watch(address_t start, uint32_t length, bool on_read) {
+      if (length == 0 || uint64_t{start} + length > m_size) {
+        throw std::invalid_argument("Watch range must be non-empty and inside memory");
+      }
+      auto it = std::partition_point(m_watches.begin(), m_watches.end(), [&](const Watchpoint& w) {
+        return w.start + uint64_t{w.length} <= start;
+      });
+      if (it != m_watches.end() && it->start < uint64_t{start} + length) {
+        throw std::invalid_argument("Watch range overlaps another watch");
+      }
+
+      it = m_watches.insert(it, {start, length, on_read});
+      refresh_watch_traps(*it);
+    }
+
+    bool Memory::remove_watch(address_t start) {
+      auto it = std::find_if(m_watches.begin(), m_watches.end(),
+                             [&](const Watchpoint& w) { return w.start == start; });
+      if (it == m_watches.end()) return false;
+
+      Watchpoint removed = *it;
+      m_watches.erase(it);
+      refresh_watch_traps(removed);
+      return true;
+    }
+
+    void Memory::clear_watches() {
+      std::vector<Watchpoint> removed;
+      removed.swap(m_watches);
+      for (const Watchpoint& watch : removed) {
+        refresh_watch_traps(watch);
+      }
+      m_watchHit.reset();
+    }
+
+    void Memory::copy_watches(const Memory& other) {
+      if (this == &other) return;
+      clear_watches();
+      m_watches = other.m_watches;
+      for (const Watchpoint& watch : m_watches) {
+        refresh_watch_traps(watch);
+      }
+    }
+
+    void Memory::for_each_page(const PageVisitor& visit) const {
+      materialize_all();
+      for_each_resident_page(visit);
+    }
+
+    void Memory::for_each_resident_page(const PageVisitor& visit) const {
+      for (address_t base : m_residentList) {
+        const Page& page = *entry(base).page;
+        visit(base, page.words.data(), page.epoch);
+      }
+    }
+
+    void Memory::for_each_image_page(const ImagePageVisitor& visit) const {
+      for (address_t base : m_lazyList) {
+        const PageEntry& e = entry(base);
+        if (!(e.trap & TRAP_LAZY)) continue;  // Copied in since
+        const ImageMapping& image = m_images[e.index];
+        visit(base, image.data.get() + (base - image.base));
+      }
+    }
+
+    void Memory::for_each_page_written_since(uint64_t epoch, const PageVisitor& visit) const {
+      for (address_t base : m_residentList) {
+        const Page& page = *entry(base).page;
+        if (page.epoch >= epoch) visit(base, page.words.data(), page.epoch);
+      }
     }
 
 } // namespace ez_arch
@@ -0,0 +1,80 @@
+#include "core/parallel_cache_sim.hpp"
+#include <algorithm>
+#include <thread>
+
+namespace ez_arch {
+
+double CacheSimStats::miss_rate() const {
+  return accesses ? static_cast<double>(misses) / static_cast<double>(accesses) : 0.0;
+}
+
+CacheSimStats& CacheSimStats::operator+=(const CacheSimStats& other) {
+  accesses += other.accesses;
+  misses += other.misses;
+  fetch_misses += other.fetch_misses;
+  load_misses += other.load_misses;
+  store_misses += other.store_misses;
+  return *this;
+}
+
+CacheSimStats ParallelCacheSim::run(const std::vector<MemoryAccess>& accesses,
+                                    const CacheConfig& config, unsigned threads) {
+  // Validates the geometry before any worker starts
+  CacheModel probe(config);
+
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(std::min<size_t>(threads, probe.num_sets()));
+
+  // One pass deals the trace out by set, keeping trace order within each
+  std::vector<std::vector<const MemoryAccess*>> buckets(threads > 1 ? threads : 0);
+  if (threads > 1) {
+    for (std::vector<const MemoryAccess*>& bucket : buckets) {
+      bucket.reserve(accesses.size() / threads);
+    }
+    for (const MemoryAccess& access : accesses) {
+      buckets[probe.set_index(access.addr) % threads].push_back(&access);
+    }
+  }
+
+  std::vector<CacheSimStats> partial(threads);
+
+  auto worker = [&](unsigned id) {
+    CacheModel cache(config);
+    CacheSimStats& stats = partial[id];
+
+    auto replay = [&](const MemoryAccess& access) {
+      ++stats.accesses;
+      if (cache.access(access.addr)) return;
+
+      ++stats.misses;
+      switch (access.kind) {
+        case AccessKind::FETCH: ++stats.fetch_misses; break;
+        case AccessKind::LOAD: ++stats.load_misses; break;
+        case AccessKind::STORE: ++stats.store_misses; break;
+      }
+    };
+
+    if (buckets.empty()) {
+      for (const MemoryAccess& access : accesses) replay(access);
+    } else {
+      for (const MemoryAccess* access : buckets[id]) replay(*access);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; ++t) {
+    pool.emplace_back(worker, t);
+  }
+  worker(0);
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+
+  CacheSimStats total;
+  for (const CacheSimStats& stats : partial) {
+    total += stats;
+  }
+  return total;
+}
+
+} // namespace ez_arch
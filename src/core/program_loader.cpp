@@ -0,0 +1,101 @@
+#include "core/program_loader.hpp"
+#include "core/mapped_file.hpp"
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace ez_arch {
+
+namespace {
+
+constexpr uint64_t ONES = 0x0101010101010101ULL;
+constexpr uint64_t HIGHS = 0x8080808080808080ULL;
+
+// Bytes >= lo get their high bit set; valid while every byte is below 0x80
+constexpr uint64_t at_least(uint64_t x, uint8_t lo) { return (x + (0x80 - lo) * ONES) & HIGHS; }
+constexpr uint64_t at_most(uint64_t x, uint8_t hi) { return ~(x + (0x7F - hi) * ONES) & HIGHS; }
+
+// Decode eight ASCII hex digits at once; false if any is not a hex digit
+bool decode_hex8(const char* text, word_t& value) {
+  // First digit in the low byte; compilers turn this into one load
+  uint64_t x = 0;
+  for (int i = 0; i < 8; ++i) x |= uint64_t{static_cast<uint8_t>(text[i])} << (8 * i);
+  if (x & HIGHS) return false;
+
+  uint64_t folded = x | (0x20 * ONES);  // 'A'-'F' to 'a'-'f'
+  uint64_t digit = at_least(x, '0') & at_most(x, '9');
+  uint64_t alpha = at_least(folded, 'a') & at_most(folded, 'f');
+  if ((digit | alpha) != HIGHS) return false;
+
+  // Nibble per byte, then pairs of nibbles into bytes
+  uint64_t nibbles = (folded & (0x0F * ONES)) + (alpha >> 7) * 9;
+  uint64_t pairs = ((nibbles & 0x000F000F000F000FULL) << 4) | ((nibbles >> 8) & 0x000F000F000F000FULL);
+  value = static_cast<word_t>(((pairs & 0xFF) << 24) | (((pairs >> 16) & 0xFF) << 16) |
+                              (((pairs >> 32) & 0xFF) << 8) | ((pairs >> 48) & 0xFF));
+  return true;
+}
+
+bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+} // namespace
+
+HexProgram ProgramLoader::parse_hex(std::string_view text, bool swar) {
+  HexProgram program;
+  program.words.reserve(text.size() / 9);
+
+  const char* p = text.data();
+  const char* end = p + text.size();
+  while (p < end) {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    if (!eol) eol = end;
+
+    word_t word;
+    if (swar && eol - p == 8 && decode_hex8(p, word)) {
+      program.words.push_back(word);
+      p = eol + 1;
+      continue;
+    }
+
+    const char* line = p;
+    p = eol + 1;
+    if (line == eol || *line == '#') continue;
+
+    const char* digits = line;
+    while (digits < eol && is_space(*digits)) ++digits;
+    if (eol - digits > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+      digits += 2;
+    }
+    auto [next, error] = std::from_chars(digits, eol, word, 16);
+    if (error == std::errc()) {
+      program.words.push_back(word);
+    } else {
+      const char* trimmed = eol;
+      while (trimmed > line && is_space(trimmed[-1])) --trimmed;
+      program.bad_lines.emplace_back(line, trimmed);
+    }
+  }
+  return program;
+}
+
+HexProgram ProgramLoader::read_hex_file(const std::string& path) {
+  size_t size = 0;
+  std::shared_ptr<const uint8_t> data = map_file(path, size);
+  return parse_hex(std::string_view(reinterpret_cast<const char*>(data.get()), size));
+}
+
+bool ProgramLoader::is_binary_image(const std::string& path) {
+  auto ends_with = [&](std::string_view suffix) {
+    return path.size() >= suffix.size() &&
+           path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+  };
+  return ends_with(".bin") || ends_with(".img");
+}
+
+size_t ProgramLoader::load_binary_file(const std::string& path, CPU& cpu) {
+  size_t size = 0;
+  std::shared_ptr<const uint8_t> data = map_file(path, size);
+  cpu.load_image(data.get(), size);
+  return size;
+}
+
+} // namespace ez_arch
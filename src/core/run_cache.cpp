@@ -0,0 +1,204 @@
+#include "core/run_cache.hpp"
+#include "core/state_file.hpp"
+#include "core/state_hash.hpp"
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
+#include <unistd.h>
+
+namespace ez_arch {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Files inside an entry's directory
+constexpr const char* START_FILE = "start";
+constexpr const char* STATE_FILE = "state";
+constexpr const char* RESULT_FILE = "run";
+
+std::string entry_file(const std::string& entry, const char* name) {
+  return (fs::path(entry) / name).string();
+}
+
+// Temporary directories are unique to the process and, within it, to the write
+std::atomic<uint64_t> next_temporary{0};
+
+std::string temporary_suffix() {
+  return ".tmp" + std::to_string(::getpid()) + "-" + std::to_string(next_temporary++);
+}
+
+// Exactly the state StateHasher covers: registers, PC, halt and fault flags
+// and memory. `stored` was loaded from a state file, so all its pages are
+// resident; `cpu`'s lazy image pages are compared without copying them in.
+bool same_state(const CPU& cpu, const CPU& stored) {
+  const RegisterFile& a = cpu.get_registers();
+  const RegisterFile& b = stored.get_registers();
+  if (a.get_pc() != b.get_pc() || cpu.is_halted() != stored.is_halted() ||
+      cpu.is_faulted() != stored.is_faulted()) {
+    return false;
+  }
+  for (register_id_t i = 1; i < RegisterFile::NUM_REGISTERS; ++i) {
+    if (a.read(i) != b.read(i)) return false;
+  }
+
+  const Memory& memory = cpu.get_memory();
+  const Memory& other = stored.get_memory();
+  std::unordered_set<address_t> compared;
+  bool same = true;
+  auto compare = [&](address_t base, auto word_at) {
+    compared.insert(base);
+    for (address_t offset = 0; same && offset < Memory::PAGE_SIZE; offset += 4) {
+      same = word_at(offset) == other.read_word(base + offset);
+    }
+  };
+  memory.for_each_resident_page([&](address_t base, const word_t* words, uint64_t) {
+    compare(base, [&](address_t offset) { return words[offset / 4]; });
+  });
+  memory.for_each_image_page([&](address_t base, const uint8_t* bytes) {
+    compare(base, [&](address_t offset) {
+      const uint8_t* b = bytes + offset;
+      return (word_t{b[0]} << 24) | (word_t{b[1]} << 16) | (word_t{b[2]} << 8) | word_t{b[3]};
+    });
+  });
+
+  // Pages only the stored state has must be zero
+  other.for_each_resident_page([&](address_t base, const word_t* words, uint64_t) {
+    if (!same || compared.count(base)) return;
+    same = std::all_of(words, words + Memory::PAGE_SIZE / 4, [](word_t w) { return w == 0; });
+  });
+  return same;
+}
+
+// Entries are written under a name private to this write, then renamed into
+// place whole. An entry already there stays: it is complete, and replacing it
+// could mix its files with ours under a reader.
+void install(const std::string& temporary, const std::string& path) {
+  std::error_code error;
+  fs::rename(temporary, path, error);
+  if (!error) return;
+
+  fs::remove_all(temporary, error);
+  if (!fs::is_directory(path, error)) throw std::runtime_error("Could not write '" + path + "'");
+}
+
+} // namespace
+
+RunCache::RunCache(std::string directory)
+    : m_directory(std::move(directory)), m_hits(0), m_misses(0) {
+  std::error_code error;
+  fs::create_directories(m_directory, error);
+  if (error || !fs::is_directory(m_directory)) {
+    throw std::runtime_error("Could not create cache directory '" + m_directory + "'");
+  }
+}
+
+std::optional<RunCache::Key> RunCache::key(CPU& cpu, uint64_t max_instructions) const {
+  const Memory& memory = cpu.get_memory();
+  if (cpu.is_halted() || cpu.get_current_stage() != ExecutionStage::FETCH ||
+      memory.devices_busy()) {
+    return std::nullopt;
+  }
+  cpu.restart_loop_detection();  // So the result depends on the starting state alone
+  return Key{StateHasher::hash(cpu), max_instructions, cpu.loop_detection(),
+             cpu.get_instruction_count(), memory.device_accesses(), cpu.snapshot()};
+}
+
+bool RunCache::load(const Key& key, CPU& cpu) {
+  std::string path = entry_path(key);
+  uint64_t retired = 0;
+  int loop_detected = 0;
+  std::ifstream result(entry_file(path, RESULT_FILE));
+  if (!(result >> retired >> loop_detected)) {
+    ++m_misses;
+    return false;
+  }
+
+  // Only a run from this very state may be reused, whatever the hash says
+  try {
+    CPU start;
+    StateFile::load(entry_file(path, START_FILE), start);
+    if (!same_state(cpu, start)) {
+      ++m_misses;
+      return false;
+    }
+  } catch (const std::runtime_error&) {
+    ++m_misses;
+    return false;
+  }
+
+  std::shared_ptr<const CPU::Snapshot> before = cpu.snapshot();
+  try {
+    StateFile::load(entry_file(path, STATE_FILE), cpu);
+  } catch (const std::runtime_error&) {
+    cpu.restore(*before);  // Unreadable entries count as misses
+    ++m_misses;
+    return false;
+  }
+
+  // The file has the instruction count of the run that stored it
+  cpu.set_control_state(cpu.get_current_stage(), cpu.is_halted(), key.start_instruction + retired,
+                        cpu.get_current_instruction(), cpu.get_pipeline(), cpu.get_fault(),
+                        loop_detected != 0);
+  ++m_hits;
+  return true;
+}
+
+void RunCache::store(const Key& key, const CPU& cpu) {
+  uint64_t retired = cpu.get_instruction_count() - key.start_instruction;
+  bool complete = cpu.is_halted() || retired == key.max_instructions;
+  if (!complete || cpu.get_memory().device_accesses() != key.device_accesses) return;
+
+  std::string path = entry_path(key);
+  std::string temporary = path + temporary_suffix();
+  std::error_code error;
+  if (!fs::create_directory(temporary, error)) {
+    throw std::runtime_error("Could not write '" + path + "'");
+  }
+
+  try {
+    CPU start;
+    start.restore(*key.start);
+    StateFile::save(entry_file(temporary, START_FILE), start);
+    StateFile::save(entry_file(temporary, STATE_FILE), cpu);
+
+    std::ofstream result(entry_file(temporary, RESULT_FILE), std::ios::trunc);
+    result << retired << ' ' << (cpu.loop_detected() ? 1 : 0) << '\n';
+    result.close();
+    if (!result) throw std::runtime_error("Could not write '" + path + "'");
+  } catch (...) {
+    fs::remove_all(temporary, error);
+    throw;
+  }
+  install(temporary, path);
+}
+
+uint64_t RunCache::run(CPU& cpu, uint64_t max_instructions) {
+  std::optional<Key> run_key = key(cpu, max_instructions);
+  if (!run_key) return cpu.run(max_instructions);
+  if (load(*run_key, cpu)) return cpu.get_instruction_count() - run_key->start_instruction;
+
+  uint64_t retired = cpu.run(max_instructions);
+  store(*run_key, cpu);
+  return retired;
+}
+
+std::string RunCache::entry_path(const Key& key) const {
+  std::ostringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << key.state_hash << std::dec << '-';
+  if (key.max_instructions == CPU::UNLIMITED) {
+    name << "all";
+  } else {
+    name << key.max_instructions;
+  }
+  name << (key.detect_loops ? "-loops" : "") << "-v" << ENGINE_VERSION;
+  return (fs::path(m_directory) / name.str()).string();
+}
+
+} // namespace ez_arch
@@ -0,0 +1,95 @@
+#include "core/sampled_simulation.hpp"
+#include "core/cpu.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace ez_arch {
+
+SamplingResult SampledSimulator::run(CPU& cpu, const SamplingConfig& config) {
+  if (config.window == 0 || config.warmup + config.window > config.period) {
+    throw std::invalid_argument("Sampling needs 0 < warmup + window <= period");
+  }
+
+  TimingModel model(config.timing);
+  SamplingResult result;
+  std::vector<double> sample_cpis;
+  double partial_cpi = -1.0;
+  TraceRecord record;
+
+  auto budget = [&](uint64_t wanted) {
+    return std::min(wanted, config.max_instructions - result.instructions);
+  };
+
+  // Detailed timing; returns the number of instructions retired
+  auto simulate_detailed = [&](uint64_t count) {
+    uint64_t retired = 0;
+    while (retired < count && TraceRecorder::record_step(cpu, record)) {
+      model.consume(record);
+      ++retired;
+    }
+    result.instructions += retired;
+    result.detailed_instructions += retired;
+    return retired;
+  };
+
+  auto fast_forward = [&](uint64_t count) {
+    uint64_t retired = 0;
+    if (config.functional_warming) {
+      while (retired < count && TraceRecorder::record_step(cpu, record)) {
+        model.warm(record);
+        ++retired;
+      }
+    } else {
+      retired = cpu.run(count);
+    }
+    result.instructions += retired;
+  };
+
+  while (!cpu.is_halted() && result.instructions < config.max_instructions) {
+    simulate_detailed(budget(config.warmup));
+
+    TimingStats before = model.stats();
+    uint64_t measured = simulate_detailed(budget(config.window));
+    uint64_t cycles = model.stats().cycles - before.cycles;
+
+    if (measured == config.window) {
+      sample_cpis.push_back(static_cast<double>(cycles) / static_cast<double>(measured));
+    } else if (measured > 0) {
+      partial_cpi = static_cast<double>(cycles) / static_cast<double>(measured);
+    }
+
+    fast_forward(budget(config.period - config.warmup - config.window));
+  }
+
+  // A run shorter than one full window still gets a (noisy) estimate
+  if (sample_cpis.empty() && partial_cpi >= 0.0) {
+    sample_cpis.push_back(partial_cpi);
+  }
+
+  result.halted = cpu.is_halted();
+  result.samples = sample_cpis.size();
+  if (sample_cpis.empty()) return result;
+
+  double n = static_cast<double>(sample_cpis.size());
+  double sum = 0.0;
+  for (double cpi : sample_cpis) sum += cpi;
+  result.mean_cpi = sum / n;
+
+  if (sample_cpis.size() > 1) {
+    double squares = 0.0;
+    for (double cpi : sample_cpis) {
+      squares += (cpi - result.mean_cpi) * (cpi - result.mean_cpi);
+    }
+    result.cpi_stddev = std::sqrt(squares / (n - 1.0));
+  }
+
+  double instructions = static_cast<double>(result.instructions);
+  result.estimated_cycles = result.mean_cpi * instructions;
+  result.cycles_error = config.z_score * result.cpi_stddev / std::sqrt(n) * instructions;
+
+  return result;
+}
+
+} // namespace ez_arch
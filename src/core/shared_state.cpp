@@ -0,0 +1,349 @@
+#include "core/shared_state.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define EZ_ARCH_HAS_SHM 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ez_arch {
+
+namespace {
+
+constexpr char MAGIC[4] = {'E', 'Z', 'S', 'H'};
+constexpr uint32_t LAYOUT_VERSION = 1;
+constexpr size_t WORDS_PER_PAGE = Memory::PAGE_SIZE / Memory::WORD_ACCESS_SIZE;
+constexpr int SYNC_RETRIES = 64;
+
+struct PageSlot {
+  address_t base;
+  uint32_t resident;  // 0 once the page was dropped; its data is zero
+  uint64_t version;   // Publish number of the last change
+};
+
+static_assert(std::is_trivially_copyable<PipelineRegisters>::value,
+              "Pipeline latches are copied into shared memory as bytes");
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "The sequence lock must work across processes");
+
+} // namespace
+
+struct alignas(64) SharedStateLayout {
+  char magic[4];
+  uint32_t layout_version;
+  std::atomic<uint32_t> sequence;  // Odd while the writer is updating
+  uint32_t max_pages;
+  uint32_t page_count;             // Slots in use
+  uint32_t overflow;
+
+  uint32_t stage;
+  uint32_t halted;
+  uint32_t faulted;
+  uint32_t fault_kind;
+  address_t fault_address;
+  word_t pc;
+  word_t current_instruction;
+  uint64_t instruction_count;
+  word_t registers[RegisterFile::NUM_REGISTERS];
+  PipelineRegisters pipeline;
+};
+
+namespace {
+
+size_t slots_offset() {
+  return sizeof(SharedStateLayout);
+}
+
+size_t data_offset(size_t max_pages) {
+  size_t end = slots_offset() + max_pages * sizeof(PageSlot);
+  return (end + Memory::PAGE_SIZE - 1) & ~(Memory::PAGE_SIZE - 1);
+}
+
+size_t layout_size(size_t max_pages) {
+  return data_offset(max_pages) + max_pages * Memory::PAGE_SIZE;
+}
+
+template <typename Layout>
+auto page_slots(Layout* layout) {
+  using Slot = std::conditional_t<std::is_const<Layout>::value, const PageSlot, PageSlot>;
+  using Byte = std::conditional_t<std::is_const<Layout>::value, const char, char>;
+  return reinterpret_cast<Slot*>(reinterpret_cast<Byte*>(layout) + slots_offset());
+}
+
+template <typename Layout>
+auto page_data(Layout* layout, size_t slot) {
+  using Word = std::conditional_t<std::is_const<Layout>::value, const word_t, word_t>;
+  using Byte = std::conditional_t<std::is_const<Layout>::value, const char, char>;
+  return reinterpret_cast<Word*>(reinterpret_cast<Byte*>(layout) +
+                                 data_offset(layout->max_pages) + slot * Memory::PAGE_SIZE);
+}
+
+std::string segment_path(const std::string& name) {
+  return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+[[noreturn]] void throw_errno(const std::string& what, const std::string& path) {
+  throw std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+SharedStatePublisher::SharedStatePublisher(const std::string& name, size_t max_pages)
+    : m_name(segment_path(name)), m_maxPages(max_pages), m_mappedSize(layout_size(max_pages)),
+      m_layout(nullptr), m_publishCount(0) {
+#ifdef EZ_ARCH_HAS_SHM
+  // Replace a segment left behind by a crashed run
+  shm_unlink(m_name.c_str());
+  int fd = shm_open(m_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) throw_errno("Could not create shared memory", m_name);
+
+  if (ftruncate(fd, static_cast<off_t>(m_mappedSize)) != 0) {
+    int saved = errno;
+    close(fd);
+    shm_unlink(m_name.c_str());
+    errno = saved;
+    throw_errno("Could not size shared memory", m_name);
+  }
+
+  void* base = mmap(nullptr, m_mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    shm_unlink(m_name.c_str());
+    throw_errno("Could not map shared memory", m_name);
+  }
+
+  // The segment starts zero filled; only the header needs constructing
+  m_layout = new (base) SharedStateLayout{};
+  std::memcpy(m_layout->magic, MAGIC, sizeof(MAGIC));
+  m_layout->layout_version = LAYOUT_VERSION;
+  m_layout->max_pages = static_cast<uint32_t>(max_pages);
+#else
+  throw std::runtime_error("Shared memory attach needs a POSIX host");
+#endif
+}
+
+SharedStatePublisher::~SharedStatePublisher() {
+#ifdef EZ_ARCH_HAS_SHM
+  if (m_layout) {
+    munmap(m_layout, m_mappedSize);
+    shm_unlink(m_name.c_str());
+  }
+#endif
+}
+
+bool SharedStatePublisher::overflowed() const {
+  return m_layout && m_layout->overflow != 0;
+}
+
+void SharedStatePublisher::publish(CPU& cpu) {
+  SharedStateLayout& layout = *m_layout;
+  PageSlot* slots = page_slots(m_layout);
+
+  uint32_t sequence = layout.sequence.load(std::memory_order_relaxed);
+  layout.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  ++m_publishCount;
+
+  const RegisterFile& regs = cpu.get_registers();
+  for (register_id_t i = 0; i < RegisterFile::NUM_REGISTERS; ++i) {
+    layout.registers[i] = regs.read(i);
+  }
+  layout.pc = regs.get_pc();
+  layout.stage = static_cast<uint32_t>(cpu.get_current_stage());
+  layout.halted = cpu.is_halted();
+  layout.faulted = cpu.is_faulted();
+  if (cpu.is_faulted()) {
+    layout.fault_kind = static_cast<uint32_t>(cpu.get_fault()->kind());
+    layout.fault_address = cpu.get_fault()->address();
+  }
+  layout.current_instruction = cpu.get_current_instruction();
+  layout.instruction_count = cpu.get_instruction_count();
+  layout.pipeline = cpu.get_pipeline();
+
+  // The slot for a page seen in this publish, or null if there are none left
+  auto claim = [&](address_t base) -> PublishedPage* {
+    auto it = m_slots.find(base);
+    uint32_t slot;
+    if (it != m_slots.end()) {
+      slot = it->second;
+    } else {
+      if (m_published.size() >= m_maxPages) {
+        layout.overflow = 1;
+        return nullptr;
+      }
+      slot = static_cast<uint32_t>(m_published.size());
+      m_slots.emplace(base, slot);
+      m_published.push_back({nullptr, 0, 0});
+      slots[slot].base = base;
+    }
+
+    PublishedPage& published = m_published[slot];
+    published.seen = m_publishCount;
+    return &published;
+  };
+  auto changed = [&](PublishedPage& published) {
+    uint32_t slot = static_cast<uint32_t>(&published - m_published.data());
+    slots[slot].resident = 1;
+    slots[slot].version = m_publishCount;
+    return page_data(m_layout, slot);
+  };
+
+  Memory& memory = cpu.get_memory();
+  memory.for_each_resident_page([&](address_t base, const word_t* words, uint64_t epoch) {
+    PublishedPage* published = claim(base);
+    if (!published || (published->source == words && published->epoch == epoch)) return;
+
+    std::memcpy(changed(*published), words, Memory::PAGE_SIZE);
+    published->source = words;
+    published->epoch = epoch;
+  });
+
+  // Image pages not copied in yet go straight from the image
+  memory.for_each_image_page([&](address_t base, const uint8_t* bytes) {
+    PublishedPage* published = claim(base);
+    if (!published || (published->source == bytes && published->epoch == 0)) return;
+
+    word_t* data = changed(*published);
+    for (size_t i = 0; i < WORDS_PER_PAGE; ++i) {
+      const uint8_t* b = bytes + i * 4;
+      data[i] = (word_t{b[0]} << 24) | (word_t{b[1]} << 16) | (word_t{b[2]} << 8) | word_t{b[3]};
+    }
+    published->source = bytes;
+    published->epoch = 0;
+  });
+
+  // Pages dropped since the last publish (reset, restore) read as zero again
+  for (size_t slot = 0; slot < m_published.size(); ++slot) {
+    PublishedPage& published = m_published[slot];
+    if (published.seen == m_publishCount || published.source == nullptr) continue;
+    std::memset(page_data(m_layout, slot), 0, Memory::PAGE_SIZE);
+    slots[slot].resident = 0;
+    slots[slot].version = m_publishCount;
+    published.source = nullptr;
+  }
+  layout.page_count = static_cast<uint32_t>(m_published.size());
+
+  layout.sequence.store(sequence + 2, std::memory_order_release);
+
+  memory.begin_epoch();
+}
+
+SharedStateSubscriber::SharedStateSubscriber(const std::string& name)
+    : m_name(segment_path(name)), m_mappedSize(0), m_layout(nullptr), m_lastSequence(0) {
+#ifdef EZ_ARCH_HAS_SHM
+  int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+  if (fd < 0) throw_errno("Could not open shared memory", m_name);
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(SharedStateLayout)) {
+    close(fd);
+    throw std::runtime_error("Shared memory " + m_name + " is not an ez_arch state segment");
+  }
+
+  m_mappedSize = static_cast<size_t>(info.st_size);
+  void* base = mmap(nullptr, m_mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) throw_errno("Could not map shared memory", m_name);
+
+  m_layout = static_cast<const SharedStateLayout*>(base);
+  if (std::memcmp(m_layout->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      m_layout->layout_version != LAYOUT_VERSION ||
+      layout_size(m_layout->max_pages) > m_mappedSize) {
+    munmap(base, m_mappedSize);
+    m_layout = nullptr;
+    throw std::runtime_error("Shared memory " + m_name + " is not an ez_arch state segment");
+  }
+  m_pageVersions.assign(m_layout->max_pages, 0);
+#else
+  throw std::runtime_error("Shared memory attach needs a POSIX host");
+#endif
+}
+
+SharedStateSubscriber::~SharedStateSubscriber() {
+#ifdef EZ_ARCH_HAS_SHM
+  if (m_layout) munmap(const_cast<SharedStateLayout*>(m_layout), m_mappedSize);
+#endif
+}
+
+bool SharedStateSubscriber::sync(CPU& mirror) {
+  const SharedStateLayout& layout = *m_layout;
+  const PageSlot* slots = page_slots(m_layout);
+
+  struct ChangedPage {
+    uint32_t slot;
+    address_t base;
+    uint64_t version;
+  };
+  std::vector<ChangedPage> changed;
+  std::vector<word_t> staged;
+
+  for (int attempt = 0; attempt < SYNC_RETRIES; ++attempt) {
+    uint32_t sequence = layout.sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (sequence == m_lastSequence) return false;
+
+    // Copy everything out first; nothing is applied unless the read was clean
+    word_t registers[RegisterFile::NUM_REGISTERS];
+    std::memcpy(registers, layout.registers, sizeof(registers));
+    word_t pc = layout.pc;
+    uint32_t stage = layout.stage;
+    bool halted = layout.halted != 0;
+    bool faulted = layout.faulted != 0;
+    uint32_t fault_kind = layout.fault_kind;
+    address_t fault_address = layout.fault_address;
+    word_t current_instruction = layout.current_instruction;
+    uint64_t instruction_count = layout.instruction_count;
+    PipelineRegisters pipeline = layout.pipeline;
+
+    changed.clear();
+    staged.clear();
+    uint32_t page_count = std::min<uint32_t>(layout.page_count, layout.max_pages);
+    for (uint32_t slot = 0; slot < page_count; ++slot) {
+      uint64_t version = slots[slot].version;
+      if (version == m_pageVersions[slot]) continue;
+      changed.push_back({slot, slots[slot].base, version});
+      const word_t* data = page_data(m_layout, slot);
+      staged.insert(staged.end(), data, data + WORDS_PER_PAGE);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (layout.sequence.load(std::memory_order_relaxed) != sequence) continue;
+
+    RegisterFile& regs = mirror.get_registers();
+    for (register_id_t i = 1; i < RegisterFile::NUM_REGISTERS; ++i) {
+      regs.write(i, registers[i]);
+    }
+    regs.set_pc(pc);
+
+    std::optional<MemoryFault> fault;
+    if (faulted) fault.emplace(static_cast<MemoryFault::Kind>(fault_kind), fault_address);
+    mirror.set_control_state(static_cast<ExecutionStage>(stage), halted, instruction_count,
+                             current_instruction, pipeline, fault);
+
+    for (size_t i = 0; i < changed.size(); ++i) {
+      mirror.get_memory().load_words(&staged[i * WORDS_PER_PAGE], WORDS_PER_PAGE,
+                                     changed[i].base);
+      m_pageVersions[changed[i].slot] = changed[i].version;
+    }
+
+    m_lastSequence = sequence;
+    return true;
+  }
+
+  return false;
+}
+
+} // namespace ez_arch
@@ -0,0 +1,295 @@
+#include "core/state_file.hpp"
+#include "core/mapped_file.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace ez_arch {
+
+namespace {
+
+constexpr char MAGIC[4] = {'E', 'Z', 'S', 'T'};
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr uint32_t FLAG_COMPRESSED = 0x1;
+constexpr size_t PAGE_SIZE = Memory::PAGE_SIZE;
+constexpr size_t WORDS_PER_PAGE = PAGE_SIZE / Memory::WORD_ACCESS_SIZE;
+constexpr size_t DATA_ALIGNMENT = 16;
+
+struct FileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t flags;
+  uint64_t memory_size;
+  uint32_t page_count;
+  uint32_t stage;
+  uint32_t halted;
+  uint32_t faulted;
+  uint32_t fault_kind;
+  uint32_t fault_address;
+  word_t pc;
+  word_t current_instruction;
+  uint64_t instruction_count;
+  word_t registers[RegisterFile::NUM_REGISTERS];
+  PipelineRegisters pipeline;
+};
+
+// One stored page; a payload of exactly PAGE_SIZE bytes is the raw page
+struct PageRecord {
+  address_t base;
+  uint32_t size;
+  uint64_t offset;
+};
+
+static_assert(std::is_trivially_copyable<FileHeader>::value,
+              "The header is written and read as bytes");
+
+// LZ4-style block: sequences of [token][literal length+][literals]
+// [offset:2][match length+]. The token's high nibble is the literal count and
+// its low nibble the match length minus MIN_MATCH, 15 meaning more length
+// bytes follow. The last sequence has literals only.
+constexpr size_t MIN_MATCH = 4;
+constexpr unsigned HASH_BITS = 12;
+
+void put_length(std::vector<uint8_t>& out, size_t length) {
+  for (; length >= 255; length -= 255) out.push_back(255);
+  out.push_back(static_cast<uint8_t>(length));
+}
+
+void put_sequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literal_count,
+                  size_t offset, size_t match_length) {
+  size_t match_code = match_length ? match_length - MIN_MATCH : 0;
+  out.push_back(static_cast<uint8_t>((std::min<size_t>(literal_count, 15) << 4) |
+                                     std::min<size_t>(match_code, 15)));
+  if (literal_count >= 15) put_length(out, literal_count - 15);
+  out.insert(out.end(), literals, literals + literal_count);
+  if (match_length == 0) return;
+
+  out.push_back(static_cast<uint8_t>(offset));
+  out.push_back(static_cast<uint8_t>(offset >> 8));
+  if (match_code >= 15) put_length(out, match_code - 15);
+}
+
+void lz_compress(const uint8_t* in, size_t size, std::vector<uint8_t>& out) {
+  std::array<int32_t, size_t{1} << HASH_BITS> table;
+  table.fill(-1);
+
+  size_t anchor = 0;
+  size_t i = 0;
+  while (i + MIN_MATCH <= size) {
+    uint32_t sequence;
+    std::memcpy(&sequence, in + i, sizeof(sequence));
+    uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+    int32_t candidate = table[hash];
+    table[hash] = static_cast<int32_t>(i);
+
+    if (candidate < 0 || i - static_cast<size_t>(candidate) > 0xFFFF ||
+        std::memcmp(in + candidate, in + i, MIN_MATCH) != 0) {
+      ++i;
+      continue;
+    }
+
+    size_t length = MIN_MATCH;
+    while (i + length < size && in[candidate + length] == in[i + length]) ++length;
+    put_sequence(out, in + anchor, i - anchor, i - static_cast<size_t>(candidate), length);
+    i += length;
+    anchor = i;
+  }
+  put_sequence(out, in + anchor, size - anchor, 0, 0);
+}
+
+bool get_length(const uint8_t*& in, const uint8_t* end, size_t& length) {
+  uint8_t byte;
+  do {
+    if (in == end) return false;
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// False unless `in` decodes to exactly `size` bytes
+bool lz_decompress(const uint8_t* in, size_t in_size, uint8_t* out, size_t size) {
+  const uint8_t* end = in + in_size;
+  size_t produced = 0;
+
+  while (in < end) {
+    uint8_t token = *in++;
+    size_t literals = token >> 4;
+    if (literals == 15 && !get_length(in, end, literals)) return false;
+    if (literals > static_cast<size_t>(end - in) || literals > size - produced) return false;
+    std::memcpy(out + produced, in, literals);
+    in += literals;
+    produced += literals;
+    if (in == end) break;  // Last sequence
+
+    if (end - in < 2) return false;
+    size_t offset = in[0] | (size_t{in[1]} << 8);
+    in += 2;
+    size_t length = token & 0xF;
+    if (length == 15 && !get_length(in, end, length)) return false;
+    length += MIN_MATCH;
+    if (offset == 0 || offset > produced || length > size - produced) return false;
+
+    // Byte by byte: matches may overlap their own output
+    for (size_t i = 0; i < length; ++i, ++produced) out[produced] = out[produced - offset];
+  }
+  return produced == size;
+}
+
+bool is_zero_page(const word_t* words) {
+  return std::all_of(words, words + WORDS_PER_PAGE, [](word_t w) { return w == 0; });
+}
+
+} // namespace
+
+StateFileInfo StateFile::save(const std::string& path, const CPU& cpu, bool compress) {
+  struct StoredPage {
+    address_t base;
+    const word_t* words;
+  };
+  std::vector<StoredPage> pages;
+  cpu.get_memory().for_each_page([&](address_t base, const word_t* words, uint64_t) {
+    if (!is_zero_page(words)) pages.push_back({base, words});
+  });
+  std::sort(pages.begin(), pages.end(),
+            [](const StoredPage& a, const StoredPage& b) { return a.base < b.base; });
+
+  FileHeader header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.byte_order = BYTE_ORDER_MARK;
+  header.flags = compress ? FLAG_COMPRESSED : 0;
+  header.memory_size = cpu.get_memory().size();
+  header.page_count = static_cast<uint32_t>(pages.size());
+  header.stage = static_cast<uint32_t>(cpu.get_current_stage());
+  header.halted = cpu.is_halted();
+  if (cpu.is_faulted()) {
+    header.faulted = 1;
+    header.fault_kind = static_cast<uint32_t>(cpu.get_fault()->kind());
+    header.fault_address = cpu.get_fault()->address();
+  }
+  header.pc = cpu.get_registers().get_pc();
+  header.current_instruction = cpu.get_current_instruction();
+  header.instruction_count = cpu.get_instruction_count();
+  for (register_id_t i = 0; i < RegisterFile::NUM_REGISTERS; ++i) {
+    header.registers[i] = cpu.get_registers().read(i);
+  }
+  header.pipeline = cpu.get_pipeline();
+
+  size_t data_start = sizeof(FileHeader) + pages.size() * sizeof(PageRecord);
+  data_start = (data_start + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+
+  std::vector<PageRecord> records;
+  records.reserve(pages.size());
+  std::vector<uint8_t> data;
+  std::vector<uint8_t> packed;
+  for (const StoredPage& page : pages) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(page.words);
+    packed.clear();
+    if (compress) lz_compress(bytes, PAGE_SIZE, packed);
+
+    PageRecord record{page.base, 0, data_start + data.size()};
+    if (compress && packed.size() < PAGE_SIZE) {
+      record.size = static_cast<uint32_t>(packed.size());
+      data.insert(data.end(), packed.begin(), packed.end());
+    } else {
+      record.size = static_cast<uint32_t>(PAGE_SIZE);
+      data.insert(data.end(), bytes, bytes + PAGE_SIZE);
+    }
+    // Keep raw pages word aligned in the mapped file
+    data.resize((data.size() + 3) & ~size_t{3});
+    records.push_back(record);
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) throw std::runtime_error("Could not open '" + path + "' for writing");
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(records.data()),
+            static_cast<std::streamsize>(records.size() * sizeof(PageRecord)));
+  const char padding[DATA_ALIGNMENT] = {};
+  out.write(padding, static_cast<std::streamsize>(
+                         data_start - sizeof(FileHeader) - records.size() * sizeof(PageRecord)));
+  out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+  if (!out) throw std::runtime_error("Could not write '" + path + "'");
+
+  return {pages.size(), data_start + data.size(), compress};
+}
+
+StateFileInfo StateFile::load(const std::string& path, CPU& cpu) {
+  size_t file_size = 0;
+  std::shared_ptr<const uint8_t> file = map_file(path, file_size);
+
+  FileHeader header;
+  if (file_size < sizeof(header)) throw std::runtime_error("'" + path + "' is not a state file");
+  std::memcpy(&header, file.get(), sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error("'" + path + "' is not a state file");
+  }
+  if (header.version != VERSION) {
+    throw std::runtime_error("'" + path + "' has unsupported state version " +
+                             std::to_string(header.version));
+  }
+  if (header.byte_order != BYTE_ORDER_MARK) {
+    throw std::runtime_error("'" + path + "' was saved on a host of the other byte order");
+  }
+  if (header.memory_size != cpu.get_memory().size()) {
+    throw std::runtime_error("'" + path + "' was saved with a different memory size");
+  }
+  size_t records_end = sizeof(FileHeader) + size_t{header.page_count} * sizeof(PageRecord);
+  if (records_end > file_size || header.stage > static_cast<uint32_t>(ExecutionStage::WRITE_BACK)) {
+    throw std::runtime_error("'" + path + "' is corrupt");
+  }
+
+  cpu.reset();
+  Memory& memory = cpu.get_memory();
+  std::array<word_t, WORDS_PER_PAGE> buffer;
+  for (uint32_t i = 0; i < header.page_count; ++i) {
+    PageRecord record;
+    std::memcpy(&record, file.get() + sizeof(FileHeader) + i * sizeof(PageRecord), sizeof(record));
+    if (record.offset > file_size || record.size > file_size - record.offset ||
+        (record.base % PAGE_SIZE) != 0 || record.base + uint64_t{PAGE_SIZE} > header.memory_size) {
+      cpu.reset();
+      throw std::runtime_error("'" + path + "' is corrupt");
+    }
+
+    const uint8_t* payload = file.get() + record.offset;
+    if (record.size == PAGE_SIZE) {
+      // Raw pages install straight from the mapping
+      const word_t* words = reinterpret_cast<const word_t*>(payload);
+      if (record.offset % alignof(word_t) != 0) {
+        std::memcpy(buffer.data(), payload, PAGE_SIZE);
+        words = buffer.data();
+      }
+      memory.load_words(words, WORDS_PER_PAGE, record.base);
+    } else if (lz_decompress(payload, record.size, reinterpret_cast<uint8_t*>(buffer.data()),
+                             PAGE_SIZE)) {
+      memory.load_words(buffer.data(), WORDS_PER_PAGE, record.base);
+    } else {
+      cpu.reset();
+      throw std::runtime_error("'" + path + "' has a corrupt page");
+    }
+  }
+
+  RegisterFile& registers = cpu.get_registers();
+  for (register_id_t i = 1; i < RegisterFile::NUM_REGISTERS; ++i) {
+    registers.write(i, header.registers[i]);
+  }
+  registers.set_pc(header.pc);
+
+  std::optional<MemoryFault> fault;
+  if (header.faulted) {
+    fault.emplace(static_cast<MemoryFault::Kind>(header.fault_kind), header.fault_address);
+  }
+  cpu.set_control_state(static_cast<ExecutionStage>(header.stage), header.halted != 0,
+                        header.instruction_count, header.current_instruction, header.pipeline,
+                        fault);
+
+  return {header.page_count, file_size, (header.flags & FLAG_COMPRESSED) != 0};
+}
+
+} // namespace ez_arch
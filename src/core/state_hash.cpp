@@ -0,0 +1,130 @@
+#include "core/state_hash.hpp"
+#include <array>
+
+namespace ez_arch {
+
+namespace {
+
+constexpr size_t PAGE_WORDS = Memory::PAGE_SIZE / 4;
+
+// splitmix64's finalizer: every input bit affects every output bit
+uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t page_hash(address_t base, const word_t* words) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < PAGE_WORDS; ++i) {
+    if (words[i] != 0) {
+      address_t addr = base + static_cast<address_t>(i * 4);
+      sum += mix((uint64_t{addr} << 32) | words[i]);
+    }
+  }
+  return sum;
+}
+
+// The same for a page still mapped from an image, without copying it in
+uint64_t image_page_hash(address_t base, const uint8_t* bytes) {
+  std::array<word_t, PAGE_WORDS> words;
+  for (size_t i = 0; i < PAGE_WORDS; ++i) {
+    const uint8_t* b = bytes + i * 4;
+    words[i] = (word_t{b[0]} << 24) | (word_t{b[1]} << 16) | (word_t{b[2]} << 8) | word_t{b[3]};
+  }
+  return page_hash(base, words.data());
+}
+
+// Every page's hash, lazy image pages included
+template <typename Visit>
+void hash_pages(const Memory& memory, Visit visit) {
+  memory.for_each_resident_page([&](address_t base, const word_t* words, uint64_t) {
+    visit(base, page_hash(base, words));
+  });
+  memory.for_each_image_page([&](address_t base, const uint8_t* bytes) {
+    visit(base, image_page_hash(base, bytes));
+  });
+}
+
+uint64_t combine(const CPU& cpu, uint64_t memory_hash) {
+  const RegisterFile& regs = cpu.get_registers();
+  uint64_t hash = mix(uint64_t{regs.get_pc()} | (uint64_t{cpu.is_halted()} << 32) |
+                      (uint64_t{cpu.is_faulted()} << 33));
+  for (register_id_t i = 1; i < RegisterFile::NUM_REGISTERS; ++i) {
+    hash = mix(hash ^ ((uint64_t{i} << 32) | regs.read(i)));
+  }
+  return mix(hash ^ memory_hash);
+}
+
+bool same_registers(const RegisterFile& a, const RegisterFile& b) {
+  if (a.get_pc() != b.get_pc()) return false;
+  for (register_id_t i = 1; i < RegisterFile::NUM_REGISTERS; ++i) {
+    if (a.read(i) != b.read(i)) return false;
+  }
+  return true;
+}
+
+} // namespace
+
+StateHasher::StateHasher(CPU& cpu) : m_cpu(cpu), m_memoryHash(0) {
+  Memory& memory = m_cpu.get_memory();
+  hash_pages(memory, [&](address_t base, uint64_t hash) {
+    m_pageHashes[base] = hash;
+    m_memoryHash += hash;
+  });
+  m_epoch = memory.begin_epoch();
+}
+
+uint64_t StateHasher::update() {
+  Memory& memory = m_cpu.get_memory();
+  memory.for_each_page_written_since(m_epoch, [&](address_t base, const word_t* words, uint64_t) {
+    uint64_t hash = page_hash(base, words);
+    uint64_t& known = m_pageHashes[base];  // Zero for a page new since
+    m_memoryHash += hash - known;
+    known = hash;
+  });
+  m_epoch = memory.begin_epoch();
+  return combine(m_cpu, m_memoryHash);
+}
+
+uint64_t StateHasher::hash(const CPU& cpu) {
+  uint64_t memory_hash = 0;
+  hash_pages(cpu.get_memory(), [&](address_t, uint64_t hash) { memory_hash += hash; });
+  return combine(cpu, memory_hash);
+}
+
+bool LoopDetector::sample() {
+  const Memory& memory = m_cpu.get_memory();
+  if (memory.devices_busy() || memory.device_accesses() != m_deviceAccesses) {
+    m_deviceAccesses = memory.device_accesses();
+    forget();
+    return false;
+  }
+  if (!m_hasher) m_hasher.emplace(m_cpu);
+
+  uint64_t hash = m_hasher->update();
+  const RegisterFile& regs = m_cpu.get_registers();
+  if (m_saved && hash == m_savedHash && same_registers(regs, m_savedRegisters)) return true;
+
+  if (!m_saved || m_length == m_power) {
+    if (m_saved) m_power *= 2;
+    m_saved = true;
+    m_savedHash = hash;
+    m_savedRegisters = regs;
+    m_length = 0;
+  }
+  ++m_length;
+  return false;
+}
+
+void LoopDetector::forget() {
+  m_hasher.reset();
+  m_saved = false;
+  m_power = 1;
+  m_length = 0;
+}
+
+} // namespace ez_arch
@@ -0,0 +1,215 @@
+#include "core/time_parallel.hpp"
+#include "core/state_hash.hpp"
+#include "core/trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+namespace ez_arch {
+
+namespace {
+
+using SnapshotPtr = std::shared_ptr<const CPU::Snapshot>;
+
+// One segment as executed from some start state
+struct Segment {
+  uint64_t start_count = 0;  // After warm-up
+  uint64_t start_hash = 0;
+  uint64_t end_count = 0;
+  uint64_t end_hash = 0;
+  bool halted = false;
+  SnapshotPtr end;
+  SnapshotPtr checkpoint;    // Warm-up start of the next segment, if reached
+  std::optional<TimingModel> model;  // As it ends, stats included
+  std::array<uint64_t, 5> stage_busy{};
+};
+
+void check(const CPU& cpu, const TimeParallelConfig& config) {
+  if (config.segment_length == 0 || config.warmup > config.segment_length) {
+    throw std::invalid_argument(
+        "Time-parallel simulation needs a non-zero segment length and warmup <= segment length");
+  }
+  if (cpu.get_current_stage() != ExecutionStage::FETCH) {
+    throw std::invalid_argument("Time-parallel simulation must start between instructions");
+  }
+  TimingModel probe(config.timing);  // Validates cache geometry before any worker starts
+}
+
+void add(TimingStats& total, const TimingStats& stats) {
+  total.instructions += stats.instructions;
+  total.cycles += stats.cycles;
+  total.data_stall_cycles += stats.data_stall_cycles;
+  total.branches += stats.branches;
+  total.mispredictions += stats.mispredictions;
+  total.icache_accesses += stats.icache_accesses;
+  total.icache_misses += stats.icache_misses;
+  total.dcache_accesses += stats.dcache_accesses;
+  total.dcache_misses += stats.dcache_misses;
+}
+
+// One instruction through the stage-accurate path; false if it did not retire
+bool detailed_step(CPU& cpu, TimingModel& model, std::array<uint64_t, 5>* busy) {
+  TraceRecord record;
+  if (!TraceRecorder::peek(cpu, record)) {
+    cpu.step();  // Lets the CPU observe the halt word
+    return false;
+  }
+
+  uint64_t before = cpu.get_instruction_count();
+  for (unsigned stage = 0; stage < TimingModel::PIPELINE_DEPTH; ++stage) {
+    cpu.step_stage();
+  }
+  if (cpu.get_instruction_count() == before) return false;
+
+  model.consume(record);
+  if (busy) {
+    ++(*busy)[static_cast<size_t>(ExecutionStage::FETCH)];
+    ++(*busy)[static_cast<size_t>(ExecutionStage::DECODE)];
+    ++(*busy)[static_cast<size_t>(ExecutionStage::EXECUTE)];
+    if (record.is_load() || record.is_store()) {
+      ++(*busy)[static_cast<size_t>(ExecutionStage::MEMORY_ACCESS)];
+    }
+    if (record.dest != 0) ++(*busy)[static_cast<size_t>(ExecutionStage::WRITE_BACK)];
+  }
+  return true;
+}
+
+// Time `warmup` instructions from `from` without measuring them, then
+// `length` more; snapshot `checkpoint_at` instructions into the segment
+Segment execute(const CPU::Snapshot& from, TimingModel model, uint64_t warmup, uint64_t length,
+                uint64_t checkpoint_at) {
+  CPU cpu;
+  cpu.restore(from);
+  for (uint64_t i = 0; i < warmup && detailed_step(cpu, model, nullptr); ++i) {
+  }
+  model.reset_stats();
+
+  Segment segment;
+  segment.start_count = cpu.get_instruction_count();
+  segment.start_hash = StateHasher::hash(cpu);
+  for (uint64_t done = 0;; ++done) {
+    if (done == checkpoint_at) segment.checkpoint = cpu.snapshot();
+    if (done == length || !detailed_step(cpu, model, &segment.stage_busy)) break;
+  }
+
+  segment.end_count = cpu.get_instruction_count();
+  segment.end_hash = StateHasher::hash(cpu);
+  segment.halted = cpu.is_halted();
+  segment.end = cpu.snapshot();
+  segment.model.emplace(std::move(model));
+  return segment;
+}
+
+} // namespace
+
+TimeParallelResult TimeParallelSimulator::run(CPU& cpu, const TimeParallelConfig& config) {
+  check(cpu, config);
+
+  // Predict each later segment's warm-up start with a functional run
+  std::vector<SnapshotPtr> predictions;
+  CPU fast = cpu.fork();
+  fast.set_loop_detection(false);
+  uint64_t base = cpu.get_instruction_count();
+  uint64_t segments = config.max_instructions == 0
+                          ? 0
+                          : (config.max_instructions - 1) / config.segment_length + 1;
+  for (uint64_t k = 1; k < segments; ++k) {
+    uint64_t target = base + k * config.segment_length - config.warmup;
+    fast.run(target - fast.get_instruction_count());
+    if (fast.is_halted()) break;
+    predictions.push_back(fast.snapshot());
+  }
+
+  return run(cpu, config, predictions);
+}
+
+TimeParallelResult TimeParallelSimulator::run(CPU& cpu, const TimeParallelConfig& config,
+                                              const std::vector<SnapshotPtr>& predictions) {
+  check(cpu, config);
+  TimeParallelResult result;
+  result.halted = cpu.is_halted();
+  if (cpu.is_halted() || config.max_instructions == 0) return result;
+
+  uint64_t length = config.segment_length;
+  uint64_t last_segment = (config.max_instructions - 1) / length;
+  auto length_of = [&](uint64_t k) { return std::min(length, config.max_instructions - k * length); };
+  uint64_t checkpoint_at = length - config.warmup;
+
+  std::vector<SnapshotPtr> starts{cpu.snapshot()};
+  for (size_t i = 0; i < predictions.size() && starts.size() <= last_segment; ++i) {
+    starts.push_back(predictions[i]);
+  }
+  std::vector<Segment> segments(starts.size());
+
+  unsigned threads = config.threads;
+  if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(std::min<size_t>(threads, starts.size()));
+
+  std::atomic<size_t> next_segment{0};
+  std::exception_ptr failure;
+  std::mutex failure_mutex;
+
+  // Each start state belongs to one worker, which restores (forks) it
+  auto worker = [&]() {
+    for (size_t k = next_segment++; k < starts.size(); k = next_segment++) {
+      try {
+        segments[k] = execute(*starts[k], TimingModel(config.timing), k == 0 ? 0 : config.warmup,
+                              length_of(k), checkpoint_at);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(failure_mutex);
+        if (!failure) failure = std::current_exception();
+      }
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : pool) {
+    thread.join();
+  }
+
+  if (failure) std::rethrow_exception(failure);
+
+  // Validate in order, re-executing from the true state where the guess was off
+  for (uint64_t k = 0; k <= last_segment; ++k) {
+    if (k > 0) {
+      const Segment& previous = segments[k - 1];
+      bool predicted = k < starts.size();
+      if (!predicted || segments[k].start_count != previous.end_count ||
+          segments[k].start_hash != previous.end_hash) {
+        if (predicted) ++result.mispredictions;
+        TimingModel model = *previous.model;
+        model.reset_stats();
+        Segment redone = execute(*previous.end, std::move(model), 0, length_of(k), checkpoint_at);
+        if (predicted) {
+          segments[k] = std::move(redone);
+        } else {
+          segments.push_back(std::move(redone));
+        }
+      }
+    }
+
+    const Segment& segment = segments[k];
+    ++result.segments;
+    result.instructions += segment.end_count - segment.start_count;
+    add(result.stats, segment.model->stats());
+    for (size_t stage = 0; stage < result.stage_busy.size(); ++stage) {
+      result.stage_busy[stage] += segment.stage_busy[stage];
+    }
+    if (segment.halted) break;
+    if (k < last_segment && segment.checkpoint) result.checkpoints.push_back(segment.checkpoint);
+  }
+
+  cpu.restore(*segments[result.segments - 1].end);
+  result.halted = cpu.is_halted();
+  return result;
+}
+
+} // namespace ez_arch
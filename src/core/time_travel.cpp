@@ -0,0 +1,321 @@
+#include "core/time_travel.hpp"
+#include "core/trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ez_arch {
+
+namespace {
+
+// Oldest undo entries are dropped past this; replay covers them instead
+constexpr size_t UNDO_LIMIT = 4096;
+
+} // namespace
+
+TimeTravel::TimeTravel(CPU& cpu, uint64_t interval, size_t max_checkpoints)
+    : m_cpu(cpu), m_interval(interval), m_maxCheckpoints(max_checkpoints), m_last(0),
+      m_trackFetches(false) {
+  if (interval == 0 || max_checkpoints < 2) {
+    throw std::invalid_argument("Checkpoint interval must be non-zero and at least 2 checkpoints kept");
+  }
+  restart();
+}
+
+void TimeTravel::restart() {
+  m_checkpoints.clear();
+  m_checkpoints.push_back({position(), m_cpu.snapshot()});
+  m_undo.clear();
+  m_last = position();
+  m_firstFetch.clear();
+  m_cpu.restart_loop_detection();  // The CPU may have been edited
+}
+
+void TimeTravel::set_fetch_tracking(bool enabled) {
+  m_trackFetches = enabled;
+  if (!enabled) m_firstFetch.clear();
+}
+
+bool TimeTravel::step() {
+  if (m_cpu.is_halted()) return false;
+  prepare_forward();
+
+  // Reading the old store value must not count as a watched read
+  Memory& memory = m_cpu.get_memory();
+  bool had_hit = memory.watch_hit().has_value();
+  UndoEntry entry;
+  bool undoable = record_undo(entry);
+  if (!had_hit) memory.clear_watch_hit();
+  record_fetch();
+  m_cpu.step();
+  if (undoable && position() == entry.instruction + 1) {
+    if (m_undo.size() == UNDO_LIMIT) m_undo.erase(m_undo.begin(), m_undo.begin() + UNDO_LIMIT / 2);
+    m_undo.push_back(entry);
+  } else {
+    m_undo.clear();
+  }
+
+  after_forward();
+  return true;
+}
+
+bool TimeTravel::step_stage() {
+  if (m_cpu.is_halted()) return false;
+  prepare_forward();
+  m_undo.clear();  // Undo entries cover whole instructions from FETCH
+  record_fetch();
+  m_cpu.step_stage();
+  after_forward();
+  return true;
+}
+
+uint64_t TimeTravel::run(uint64_t max_instructions, const Breakpoints* breakpoints) {
+  if (m_cpu.is_halted() || m_cpu.stop_requested()) return 0;
+  prepare_forward();
+  m_undo.clear();
+  if (breakpoints && breakpoints->empty()) breakpoints = nullptr;
+  Memory& memory = m_cpu.get_memory();
+  memory.clear_watch_hit();
+  bool watching = !memory.watches().empty();
+
+  uint64_t start = position();
+  uint64_t end = start + std::min(max_instructions, UNLIMITED - start);
+  bool stopped = false;
+  while (!m_cpu.is_halted() && position() < end && !stopped) {
+    // Run flat out up to the next checkpoint
+    uint64_t chunk_end = std::min(end, m_checkpoints.back().instruction + m_interval);
+    if (!breakpoints && !watching && !m_trackFetches) {
+      m_cpu.run(chunk_end - position());
+    } else {
+      while (!m_cpu.is_halted() && position() < chunk_end) {
+        address_t pc = m_cpu.get_registers().get_pc();
+        record_fetch();
+        m_cpu.step();
+        address_t next = m_cpu.get_registers().get_pc();
+        if (breakpoints && breakpoints->contains(next) && !m_cpu.is_halted()) {
+          stopped = true;
+          break;
+        }
+        if (watching && memory.watch_hit()) {
+          stopped = true;
+          break;
+        }
+        if (next != pc + 4 && m_cpu.stop_requested()) break;  // Checked like CPU::run
+      }
+    }
+    stopped = stopped || m_cpu.stop_requested();
+    after_forward();
+  }
+  return position() - start;
+}
+
+bool TimeTravel::step_back(uint64_t count) {
+  if (position() < first() || position() > m_last) restart();
+  if (count > position() - first()) return false;
+
+  if (m_cpu.get_current_stage() == ExecutionStage::FETCH && count <= m_undo.size()) {
+    for (uint64_t i = 0; i < count; ++i) {
+      apply_undo(m_undo.back());
+      m_undo.pop_back();
+    }
+    return true;
+  }
+
+  replay_to(position() - count);
+  return true;
+}
+
+bool TimeTravel::seek(uint64_t instruction) {
+  if (position() < first() || position() > m_last) restart();
+  if (instruction < first()) return false;
+
+  if (instruction < position()) return step_back(position() - instruction);
+  if (instruction <= m_last) {
+    replay_to(instruction);
+  } else {
+    run(instruction - position());
+  }
+  return position() == instruction;
+}
+
+bool TimeTravel::reverse_continue(const std::function<bool(const CPU&)>& stop) {
+  if (position() < first() || position() > m_last) restart();
+
+  uint64_t origin = position();
+  std::shared_ptr<const CPU::Snapshot> here = m_cpu.snapshot();
+
+  // Scan segments from the latest back; within one, the last hit wins
+  auto segment = std::lower_bound(m_checkpoints.begin(), m_checkpoints.end(), origin,
+                                  [](const Checkpoint& c, uint64_t at) { return c.instruction < at; });
+  while (segment != m_checkpoints.begin()) {
+    --segment;
+    uint64_t end = (segment + 1 == m_checkpoints.end()) ? origin
+                                                        : std::min(origin, (segment + 1)->instruction);
+    m_cpu.restore(*segment->snapshot);
+
+    bool found = false;
+    uint64_t hit = 0;
+    while (position() < end) {
+      if (stop(m_cpu)) {
+        found = true;
+        hit = position();
+      }
+      if (m_cpu.is_halted()) break;
+      m_cpu.step();
+    }
+
+    if (found) {
+      replay_to(hit);
+      return true;
+    }
+  }
+
+  m_cpu.restore(*here);  // Undo entries still end here
+  return false;
+}
+
+uint64_t TimeTravel::patch_code(address_t addr, const std::vector<word_t>& words) {
+  if (position() < first() || position() > m_last) restart();
+
+  // Only words that change matter, and only from their first fetch on
+  Memory& memory = m_cpu.get_memory();
+  std::vector<std::pair<address_t, word_t>> changes;
+  uint64_t diverge = m_last;
+  for (size_t i = 0; i < words.size(); ++i) {
+    address_t at = addr + static_cast<address_t>(i * 4);
+    if (memory.read_word(at) == words[i]) continue;
+    changes.emplace_back(at, words[i]);
+    auto fetched = m_firstFetch.find(at);
+    if (fetched != m_firstFetch.end()) diverge = std::min(diverge, fetched->second);
+  }
+  if (changes.empty()) return diverge;
+
+  // States before the divergence differ only in the edited words. One taken
+  // at it may already have fetched there (a halt), so it goes too.
+  while (m_checkpoints.size() > 1 && m_checkpoints.back().instruction >= diverge) {
+    m_checkpoints.pop_back();
+  }
+  CPU scratch;
+  for (Checkpoint& checkpoint : m_checkpoints) {
+    scratch.restore(*checkpoint.snapshot);
+    for (const auto& [at, word] : changes) scratch.get_memory().write_word(at, word);
+    checkpoint.snapshot = scratch.snapshot();
+  }
+  for (auto it = m_firstFetch.begin(); it != m_firstFetch.end();) {
+    it = it->second >= diverge ? m_firstFetch.erase(it) : std::next(it);
+  }
+
+  // The current state still holds unless it fetched a changed word
+  bool unaffected = position() < diverge ||
+                    (position() == diverge && !m_cpu.is_halted() &&
+                     m_cpu.get_current_stage() == ExecutionStage::FETCH);
+  if (unaffected) {
+    for (const auto& [at, word] : changes) memory.write_word(at, word);
+    m_cpu.restart_loop_detection();
+  } else {
+    replay_to(diverge);  // From a patched checkpoint
+  }
+  m_last = diverge;
+  return diverge;
+}
+
+void TimeTravel::prepare_forward() {
+  if (position() < first() || position() > m_last) {
+    restart();
+    return;
+  }
+
+  // Executing from an earlier point starts a new future
+  while (m_checkpoints.size() > 1 && m_checkpoints.back().instruction > position()) {
+    m_checkpoints.pop_back();
+  }
+  if (position() < m_last) {
+    for (auto it = m_firstFetch.begin(); it != m_firstFetch.end();) {
+      it = it->second >= position() ? m_firstFetch.erase(it) : std::next(it);
+    }
+  }
+  m_last = position();
+}
+
+void TimeTravel::after_forward() {
+  m_last = std::max(m_last, position());
+  checkpoint_if_due();
+}
+
+void TimeTravel::checkpoint_if_due() {
+  if (position() < m_checkpoints.back().instruction + m_interval) return;
+
+  m_checkpoints.push_back({position(), m_cpu.snapshot()});
+  if (m_checkpoints.size() > m_maxCheckpoints) thin_checkpoints();
+}
+
+void TimeTravel::thin_checkpoints() {
+  // Keep the first and every other one after it
+  size_t kept = 0;
+  for (size_t i = 0; i < m_checkpoints.size(); i += 2) {
+    m_checkpoints[kept++] = std::move(m_checkpoints[i]);
+  }
+  m_checkpoints.resize(kept);
+  m_interval *= 2;
+}
+
+bool TimeTravel::record_undo(UndoEntry& entry) const {
+  const Memory& memory = m_cpu.get_memory();
+  if (m_cpu.get_current_stage() != ExecutionStage::FETCH || memory.devices_busy()) return false;
+
+  TraceRecord record;
+  if (!TraceRecorder::peek(m_cpu, record)) return false;  // Halts or faults without retiring
+  if (memory.is_device(record.pc)) return false;
+  if ((record.is_load() || record.is_store()) && memory.is_device(record.mem_addr)) return false;
+
+  const RegisterFile& regs = m_cpu.get_registers();
+  entry.instruction = position();
+  entry.pc = regs.get_pc();
+  entry.current_instruction = m_cpu.get_current_instruction();
+  entry.pipeline = m_cpu.get_pipeline();
+  entry.reg = record.dest;
+  entry.reg_value = regs.read(record.dest);
+  entry.stored = record.is_store();
+  entry.store_addr = record.mem_addr;
+  entry.store_value = 0;
+  if (entry.stored) {
+    try {
+      entry.store_value = memory.read_word(record.mem_addr);
+    } catch (const MemoryFault&) {
+      return false;  // The store faults, so nothing retires
+    }
+  }
+  return true;
+}
+
+void TimeTravel::apply_undo(const UndoEntry& entry) {
+  RegisterFile& regs = m_cpu.get_registers();
+  if (entry.stored) m_cpu.get_memory().write_word(entry.store_addr, entry.store_value);
+  if (entry.reg != 0) regs.write(entry.reg, entry.reg_value);
+  regs.set_pc(entry.pc);
+  m_cpu.set_control_state(ExecutionStage::FETCH, false, entry.instruction,
+                          entry.current_instruction, entry.pipeline, std::nullopt);
+
+  // Idle clocked devices only track time; put them back at this instruction
+  Memory& memory = m_cpu.get_memory();
+  if (memory.has_clocked_devices()) memory.tick_devices(entry.instruction);
+  memory.clear_watch_hit();
+}
+
+void TimeTravel::replay_to(uint64_t instruction) {
+  auto checkpoint = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), instruction,
+                                     [](uint64_t at, const Checkpoint& c) { return at < c.instruction; });
+  --checkpoint;  // Callers keep instruction >= first()
+
+  // Continue from the current state when it is closer than the checkpoint
+  bool from_here = m_cpu.get_current_stage() == ExecutionStage::FETCH && !m_cpu.is_halted() &&
+                   position() <= instruction && position() >= checkpoint->instruction;
+  if (!from_here) m_cpu.restore(*checkpoint->snapshot);
+
+  while (position() < instruction && !m_cpu.is_halted()) {
+    m_cpu.step();
+  }
+  m_undo.clear();
+  m_cpu.get_memory().clear_watch_hit();  // Replayed accesses are old news
+}
+
+} // namespace ez_arch
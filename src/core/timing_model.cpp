@@ -0,0 +1,103 @@
+#include "core/timing_model.hpp"
+#include <algorithm>
+
+namespace ez_arch {
+
+namespace {
+
+double ratio(uint64_t numerator, uint64_t denominator) {
+  return denominator ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+}
+
+} // namespace
+
+double TimingStats::cpi() const { return ratio(cycles, instructions); }
+double TimingStats::icache_miss_rate() const { return ratio(icache_misses, icache_accesses); }
+double TimingStats::dcache_miss_rate() const { return ratio(dcache_misses, dcache_accesses); }
+double TimingStats::mispredict_rate() const { return ratio(mispredictions, branches); }
+
+TimingModel::TimingModel(const TimingConfig& config)
+    : m_config(config),
+      m_icache(config.icache),
+      m_dcache(config.dcache),
+      m_predictor(config.predictor),
+      m_pipelineFilled(false),
+      m_cycle(0) {
+  m_ready.fill(0);
+}
+
+void TimingModel::consume(const TraceRecord& record) {
+  uint64_t start = m_cycle;
+
+  // The first instruction pays for filling the pipeline
+  if (!m_pipelineFilled) {
+    m_cycle += PIPELINE_DEPTH - 1;
+    m_pipelineFilled = true;
+  }
+
+  // IF
+  ++m_stats.icache_accesses;
+  if (!m_icache.access(record.pc)) {
+    ++m_stats.icache_misses;
+    m_cycle += m_config.miss_penalty;
+  }
+
+  // ID: wait until both source operands are readable ($zero never stalls)
+  uint64_t issue = std::max({m_cycle, m_ready[record.src1], m_ready[record.src2]});
+  m_stats.data_stall_cycles += issue - m_cycle;
+  uint64_t next = issue + 1;
+
+  // MEM
+  uint64_t mem_delay = 0;
+  if (record.is_load() || record.is_store()) {
+    ++m_stats.dcache_accesses;
+    if (!m_dcache.access(record.mem_addr)) {
+      ++m_stats.dcache_misses;
+      mem_delay = m_config.miss_penalty;
+      next += mem_delay;
+    }
+  }
+
+  if (record.is_branch()) {
+    ++m_stats.branches;
+    if (!m_predictor.resolve(record.pc, record.target, record.is_taken())) {
+      ++m_stats.mispredictions;
+      next += m_config.branch_penalty;
+    }
+  } else if (record.is_jump()) {
+    next += m_config.jump_penalty;
+  }
+
+  // WB: when can a later instruction in ID read the result?
+  if (record.dest != 0) {
+    uint64_t latency;
+    if (!m_config.forwarding) {
+      latency = 3;  // ID -> EX -> MEM -> WB, register file written first half
+    } else if (record.is_load()) {
+      latency = 2;  // MEM -> EX forwarding
+    } else {
+      latency = 1;  // EX -> EX forwarding
+    }
+    m_ready[record.dest] = issue + latency + mem_delay;
+  }
+
+  m_cycle = next;
+  ++m_stats.instructions;
+  m_stats.cycles += m_cycle - start;
+}
+
+void TimingModel::warm(const TraceRecord& record) {
+  m_icache.access(record.pc);
+  if (record.is_load() || record.is_store()) {
+    m_dcache.access(record.mem_addr);
+  }
+  if (record.is_branch()) {
+    m_predictor.update(record.pc, record.is_taken());
+  }
+}
+
+void TimingModel::reset_stats() {
+  m_stats = TimingStats{};
+}
+
+} // namespace ez_arch
@@ -0,0 +1,178 @@
+#include "core/trace.hpp"
+#include "core/cpu.hpp"
+#include <cstring>
+#include <fstream>
+
+namespace ez_arch {
+
+namespace {
+
+constexpr char ACCESS_TRACE_MAGIC[4] = {'E', 'Z', 'A', 'T'};
+constexpr uint32_t ACCESS_TRACE_VERSION = 1;
+
+} // namespace
+
+std::vector<MemoryAccess> memory_accesses(const std::vector<TraceRecord>& trace) {
+  std::vector<MemoryAccess> accesses;
+  accesses.reserve(trace.size() * 2);
+
+  for (const TraceRecord& record : trace) {
+    accesses.push_back({record.pc, AccessKind::FETCH});
+    if (record.is_load()) {
+      accesses.push_back({record.mem_addr, AccessKind::LOAD});
+    } else if (record.is_store()) {
+      accesses.push_back({record.mem_addr, AccessKind::STORE});
+    }
+  }
+
+  return accesses;
+}
+
+bool save_access_trace(const std::string& filename, const std::vector<MemoryAccess>& accesses) {
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) return false;
+
+  uint64_t count = accesses.size();
+  out.write(ACCESS_TRACE_MAGIC, sizeof(ACCESS_TRACE_MAGIC));
+  out.write(reinterpret_cast<const char*>(&ACCESS_TRACE_VERSION), sizeof(ACCESS_TRACE_VERSION));
+  out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  out.write(reinterpret_cast<const char*>(accesses.data()),
+            static_cast<std::streamsize>(count * sizeof(MemoryAccess)));
+
+  return static_cast<bool>(out);
+}
+
+bool load_access_trace(const std::string& filename, std::vector<MemoryAccess>& accesses) {
+  std::ifstream in(filename, std::ios::binary | std::ios::ate);
+  if (!in) return false;
+  uint64_t file_size = static_cast<uint64_t>(in.tellg());
+  in.seekg(0);
+
+  char magic[4];
+  uint32_t version = 0;
+  uint64_t count = 0;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char*>(&version), sizeof(version));
+  in.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+  if (!in || std::memcmp(magic, ACCESS_TRACE_MAGIC, sizeof(magic)) != 0 ||
+      version != ACCESS_TRACE_VERSION) {
+    return false;
+  }
+
+  // Reject truncated files before allocating for them
+  uint64_t header_size = static_cast<uint64_t>(in.tellg());
+  if (count > (file_size - header_size) / sizeof(MemoryAccess)) return false;
+
+  accesses.resize(count);
+  in.read(reinterpret_cast<char*>(accesses.data()),
+          static_cast<std::streamsize>(count * sizeof(MemoryAccess)));
+
+  return static_cast<bool>(in);
+}
+
+bool TraceRecorder::peek(const CPU& cpu, TraceRecord& record) {
+  if (cpu.is_halted()) return false;
+
+  const RegisterFile& regs = cpu.get_registers();
+  address_t pc = regs.get_pc();
+  word_t instruction_word = 0;
+  try {
+    instruction_word = cpu.get_memory().read_word(pc);
+  } catch (const MemoryFault&) {
+    return false;  // The CPU faults on this fetch
+  }
+  Instruction instr(instruction_word);
+
+  if (instr.get_raw() == 0) return false;  // Halt word
+
+  record = TraceRecord{};
+  record.pc = pc;
+  record.instruction = instr.get_raw();
+
+  register_id_t rs = instr.get_rs();
+  register_id_t rt = instr.get_rt();
+  word_t sign_extended_imm =
+      static_cast<word_t>(static_cast<int32_t>(instr.get_immediate()));
+
+  switch (instr.get_opcode()) {
+    case 0x00:
+      record.src1 = rs;
+      record.src2 = rt;
+      record.dest = instr.get_rd();
+      break;
+
+    case Opcode::ADDI:
+    case Opcode::ANDI:
+    case Opcode::ORI:
+      record.src1 = rs;
+      record.dest = rt;
+      break;
+
+    case Opcode::LW:
+      record.src1 = rs;
+      record.dest = rt;
+      record.mem_addr = regs.read(rs) + sign_extended_imm;
+      record.flags |= TraceFlag::LOAD;
+      break;
+
+    case Opcode::SW:
+      record.src1 = rs;
+      record.src2 = rt;
+      record.mem_addr = regs.read(rs) + sign_extended_imm;
+      record.flags |= TraceFlag::STORE;
+      break;
+
+    case Opcode::BEQ:
+    case Opcode::BNE: {
+      record.src1 = rs;
+      record.src2 = rt;
+      record.target = pc + 4 + (sign_extended_imm << 2);
+      record.flags |= TraceFlag::BRANCH;
+      bool equal = regs.read(rs) == regs.read(rt);
+      bool taken = (instr.get_opcode() == Opcode::BEQ) ? equal : !equal;
+      if (taken) record.flags |= TraceFlag::TAKEN;
+      break;
+    }
+
+    case Opcode::J:
+    case Opcode::JAL:
+      record.target = ((pc + 4) & 0xF0000000) | (instr.get_address() << 2);
+      record.flags |= TraceFlag::JUMP | TraceFlag::TAKEN;
+      if (instr.get_opcode() == Opcode::JAL) record.dest = 31;
+      break;
+
+    default:
+      break;  // Unknown opcodes execute as no-ops
+  }
+
+  return true;
+}
+
+bool TraceRecorder::record_step(CPU& cpu, TraceRecord& record) {
+  // Finish any partially executed instruction first
+  while (!cpu.is_halted() && cpu.get_current_stage() != ExecutionStage::FETCH) {
+    cpu.step_stage();
+  }
+
+  if (!peek(cpu, record)) {
+    cpu.step();  // Lets the CPU observe the halt word
+    return false;
+  }
+
+  cpu.step();
+  return true;
+}
+
+std::vector<TraceRecord> TraceRecorder::record(CPU& cpu, uint64_t max_instructions) {
+  std::vector<TraceRecord> trace;
+  TraceRecord record;
+
+  while (trace.size() < max_instructions && record_step(cpu, record)) {
+    trace.push_back(record);
+  }
+
+  return trace;
+}
+
+} // namespace ez_arch
@@ -6,10 +6,21 @@
 #include <sstream>
 
 #include "core/decoder.hpp"
+#include "core/dma.hpp"
 #include "gui/style.hpp"
 
 namespace ez_arch {
 
+namespace {
+
+// Instructions between progress notifications from a background Run
+constexpr uint64_t RUN_NOTIFY_INTERVAL = 1000000;
+
+// Where LoadQ and RunQ put the instruction queue
+constexpr address_t QUEUE_BASE = 0x00000100;
+
+}  // namespace
+
 CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
     : m_cpu(cpu), m_window(window) {
   if (!loadFont()) {
@@ -18,6 +29,8 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
 
   // Initialize view state
   m_activeView = ActiveView::NONE;
+  m_queueLoaded = false;
+  m_queueRan = false;
 
   m_needsUpdate = true;
 
@@ -39,6 +52,30 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
                                  TOP_BAR_HEIGHT + 20.f);
   m_instructionView->setDisplayRange(0, 16);
 
+  // Map the framebuffer and DMA controller, and create the framebuffer view
+  try {
+    m_cpu.get_memory().map_device(DmaDevice::DEFAULT_BASE, Memory::PAGE_SIZE,
+                                  std::make_shared<DmaDevice>());
+    auto framebuffer = std::make_shared<FramebufferDevice>();
+    m_cpu.get_memory().map_device(FramebufferDevice::DEFAULT_BASE,
+                                  framebuffer->mapped_size(), framebuffer);
+    m_framebuffer = framebuffer;
+    m_framebufferView = std::make_unique<FramebufferView>(*m_framebuffer, m_font);
+    m_framebufferView->setPosition(LEFT_SIDEBAR_WIDTH + 20.f,
+                                   TOP_BAR_HEIGHT + 20.f);
+  } catch (const std::exception& e) {
+    std::cerr << "Warning: Devices unavailable: " << e.what() << "\n";
+  }
+
+  // Record history from here on, devices included
+  m_history = std::make_unique<TimeTravel>(m_cpu);
+  m_timelineView = std::make_unique<TimelineView>(m_font);
+  m_timelineView->setOnSeek([this](uint64_t instruction) {
+    stopRun();
+    m_history->seek(instruction);
+    m_needsUpdate = true;
+  });
+
   // Create the datapath view for main area
   m_datapathView = std::make_unique<DatapathView>(m_cpu, m_font);
 
@@ -46,7 +83,8 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
   auto stepStageBtn = std::make_unique<Button>("Stage", m_font);
   stepStageBtn->setPosition(700.f, 15.f);
   stepStageBtn->setCallback([this]() {
-    m_cpu.step_stage();
+    stopRun();
+    m_history->step_stage();
     m_needsUpdate = true;
   });
   m_buttons.push_back(std::move(stepStageBtn));
@@ -54,7 +92,8 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
   auto stepBtn = std::make_unique<Button>("Step", m_font);
   stepBtn->setPosition(800.f, 15.f);
   stepBtn->setCallback([this]() {
-    m_cpu.step();
+    stopRun();
+    m_history->step();
     m_needsUpdate = true;
   });
   m_buttons.push_back(std::move(stepBtn));
@@ -62,37 +101,43 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
   auto runBtn = std::make_unique<Button>("Run", m_font);
   runBtn->setPosition(900.f, 15.f);
   runBtn->setCallback([this]() {
-    m_cpu.run();
-    m_needsUpdate = true;
+    // A second click stops the run
+    if (m_run) {
+      stopRun();
+    } else {
+      startRun();
+    }
   });
   m_buttons.push_back(std::move(runBtn));
 
   auto resetBtn = std::make_unique<Button>("Reset", m_font);
   resetBtn->setPosition(1000.f, 15.f);
   resetBtn->setCallback([this]() {
+    stopRun();
     m_cpu.reset();
+    m_history->restart();
+    m_history->set_fetch_tracking(false);
+    m_queueLoaded = false;
     m_needsUpdate = true;
   });
   m_buttons.push_back(std::move(resetBtn));
 
+  auto backBtn = std::make_unique<Button>("Back", m_font);
+  backBtn->setCallback([this]() {
+    stopRun();
+    m_history->step_back();
+    m_needsUpdate = true;
+  });
+  m_backButton = backBtn.get();
+  m_buttons.push_back(std::move(backBtn));
+
   // Load queued to memory button
   auto loadBtn = std::make_unique<Button>("LoadQ", m_font);
   loadBtn->setPosition(1100.f, 15.f);
   loadBtn->setCallback([this]() {
-    // Append instructions into memory at base address 0x100, sequentially
-    const uint32_t base = 0x00000100;
-    uint32_t addr = base;
-    for (const auto& line : m_instructionQueue) {
-      try {
-        word_t w = Decoder::assemble(line);
-        m_cpu.get_memory().write_word(addr, w);
-        addr += 4;
-      } catch (...) {
-        // ignore malformed lines
-      }
-    }
-    // Set PC to the base of the loaded block
-    m_cpu.get_registers().set_pc(base);
+    stopRun();
+    loadQueue();
+    m_queueRan = false;
     m_needsUpdate = true;
   });
   m_buttons.push_back(std::move(loadBtn));
@@ -101,19 +146,16 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
   auto runQBtn = std::make_unique<Button>("RunQ", m_font);
   runQBtn->setPosition(1200.f, 15.f);
   runQBtn->setCallback([this]() {
-    const uint32_t base = 0x00000100;
-    uint32_t addr = base;
-    for (const auto& line : m_instructionQueue) {
-      try {
-        word_t w = Decoder::assemble(line);
-        m_cpu.get_memory().write_word(addr, w);
-        addr += 4;
-      } catch (...) {
-      }
+    stopRun();
+    // Once loaded, only the edited part of the program is run again
+    if (m_queueLoaded) {
+      m_history->patch_code(QUEUE_BASE, queueWords());
+      m_loadedQueue = assembleQueue();
+    } else {
+      loadQueue();
     }
-    m_cpu.get_registers().set_pc(base);
-    m_cpu.run();
-    m_needsUpdate = true;
+    m_queueRan = true;
+    startRun();
   });
   m_buttons.push_back(std::move(runQBtn));
 
@@ -172,6 +214,18 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
   });
   m_buttons.push_back(std::move(queueToggle));
 
+  // Framebuffer toggle
+  auto framebufferToggle = std::make_unique<Button>("F", m_font);
+  framebufferToggle->setPosition(5.f, TOP_BAR_HEIGHT + 310.f);
+  framebufferToggle->setSize(TOGGLE_BUTTON_SIZE, TOGGLE_BUTTON_SIZE);
+  framebufferToggle->setCallback([this]() {
+    m_activeView = (m_activeView == ActiveView::FRAMEBUFFER)
+                       ? ActiveView::NONE
+                       : ActiveView::FRAMEBUFFER;
+    m_needsUpdate = true;
+  });
+  m_buttons.push_back(std::move(framebufferToggle));
+
   // Builder and Queue views
   m_builderView = std::make_unique<InstructionBuilderView>(m_font);
   m_queueView = std::make_unique<InstructionQueueView>(m_font);
@@ -191,6 +245,7 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
     m_instructionQueue.push_back(line);
     InstructionCache::append(line);
     m_queueView->setItems(m_instructionQueue);
+    queueEdited();
   });
 
   m_queueView->setOnDelete([this](size_t idx) {
@@ -198,6 +253,7 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
       m_instructionQueue.erase(m_instructionQueue.begin() + idx);
       syncQueueToCache();
       m_queueView->setItems(m_instructionQueue);
+      queueEdited();
     }
   });
 
@@ -205,6 +261,7 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
     m_instructionQueue.clear();
     InstructionCache::clear();
     m_queueView->setItems(m_instructionQueue);
+    queueEdited();
   });
 
   // Reorder callbacks
@@ -215,6 +272,7 @@ CPUVisualizer::CPUVisualizer(CPU& cpu, sf::RenderWindow& window)
         std::swap(m_instructionQueue[idx], m_instructionQueue[newIdx]);
         syncQueueToCache();
         m_queueView->setItems(m_instructionQueue);
+        queueEdited();
       }
     }
   });
@@ -248,12 +306,62 @@ void CPUVisualizer::handleResize(unsigned width, unsigned height) {
   m_datapathView->setPosition(LEFT_SIDEBAR_WIDTH, TOP_BAR_HEIGHT);
   m_datapathView->setSize(width - LEFT_SIDEBAR_WIDTH, height - TOP_BAR_HEIGHT);
 
+  // Timeline strip along the bottom of the main area, Back button at its left
+  float timelineY = height - TIMELINE_HEIGHT;
+  m_backButton->setPosition(LEFT_SIDEBAR_WIDTH + PADDING,
+                            timelineY + (TIMELINE_HEIGHT - BUTTON_HEIGHT) / 2.f);
+  m_timelineView->setPosition(LEFT_SIDEBAR_WIDTH + BUTTON_WIDTH + 2 * PADDING,
+                              timelineY);
+  m_timelineView->setSize(width - LEFT_SIDEBAR_WIDTH - BUTTON_WIDTH - 2 * PADDING,
+                          TIMELINE_HEIGHT);
+
   // TODO: Resize other views
 
   m_needsUpdate = true;
 }
 
+void CPUVisualizer::startRun() {
+  m_runFirst = m_history->first();
+  m_runStart = m_history->position();
+  m_run = std::make_unique<AsyncRun>(
+      m_cpu, [this](uint64_t count) { return m_history->run(count); },
+      CPU::UNLIMITED, RUN_NOTIFY_INTERVAL);
+}
+
+void CPUVisualizer::stopRun() {
+  if (!m_run) return;
+  m_run->cancel();
+  m_run->wait();
+  m_run.reset();
+  m_needsUpdate = true;
+}
+
+void CPUVisualizer::pollRun() {
+  RunNotification notification;
+  while (m_run && m_run->poll(notification)) {
+    uint64_t position = m_runStart + notification.instructions;
+    m_timelineView->setRange(m_runFirst, position, position);
+    if (notification.error) {
+      try {
+        std::rethrow_exception(notification.error);
+      } catch (const std::exception& e) {
+        std::cerr << "Run failed: " << e.what() << "\n";
+      } catch (...) {
+        std::cerr << "Run failed\n";
+      }
+    }
+    if (notification.finished) stopRun();
+  }
+}
+
 void CPUVisualizer::update() {
+  if (m_run) pollRun();
+
+  // Guest pixel writes do not set m_needsUpdate; upload dirty rows each
+  // frame, also during a run, as the framebuffer hands them over under a lock
+  if (m_framebufferView) m_framebufferView->update();
+  if (m_run) return;  // Still running; the CPU is not ours to read
+
   // Update all view components
   if (m_needsUpdate) {
     m_registerView->update();
@@ -262,6 +370,9 @@ void CPUVisualizer::update() {
     m_datapathView->update();
     m_needsUpdate = false;
   }
+
+  m_timelineView->setRange(m_history->first(), m_history->last(),
+                           m_history->position());
 }
 
 void CPUVisualizer::draw() {
@@ -270,6 +381,7 @@ void CPUVisualizer::draw() {
   drawLeftSidebar();
   drawMainArea();
   drawActiveView();
+  m_timelineView->draw(m_window);
 
   // Draw buttons
   for (auto& btn : m_buttons) {
@@ -294,6 +406,7 @@ void CPUVisualizer::handleMouseMove(float x, float y) {
   for (auto& btn : m_buttons) {
     btn->handleMouseMove(x, y);
   }
+  m_timelineView->handleMouseMove(x, y);
   if (m_activeView == ActiveView::BUILDER && m_builderView)
     m_builderView->handleMouseMove(x, y);
   if (m_activeView == ActiveView::QUEUE && m_queueView)
@@ -304,6 +417,7 @@ void CPUVisualizer::handleMousePress(float x, float y) {
   for (auto& btn : m_buttons) {
     btn->handleMousePress(x, y);
   }
+  m_timelineView->handleMousePress(x, y);
   if (m_activeView == ActiveView::BUILDER && m_builderView)
     m_builderView->handleMousePress(x, y);
   if (m_activeView == ActiveView::QUEUE && m_queueView)
@@ -314,6 +428,7 @@ void CPUVisualizer::handleMouseRelease(float x, float y) {
   for (auto& btn : m_buttons) {
     btn->handleMouseRelease(x, y);
   }
+  m_timelineView->handleMouseRelease(x, y);
   if (m_activeView == ActiveView::BUILDER && m_builderView)
     m_builderView->handleMouseRelease(x, y);
   if (m_activeView == ActiveView::QUEUE && m_queueView)
@@ -336,6 +451,17 @@ void CPUVisualizer::drawTopBar() {
   topBar.setOutlineThickness(2.f);
   m_window.draw(topBar);
 
+  if (m_run) {
+    sf::Text runText(m_font);
+    runText.setString("Running: " + std::to_string(m_run->instructions()) +
+                      " instructions (Run again to stop)");
+    runText.setCharacterSize(16);
+    runText.setFillColor(TITLE_TEXT_COLOR);
+    runText.setPosition({20.f, 20.f});
+    m_window.draw(runText);
+    return;
+  }
+
   // Draw pipeline stage (compact version)
   drawPipelineStage();
 
@@ -392,6 +518,12 @@ void CPUVisualizer::drawMainArea() {
 
 void CPUVisualizer::drawActiveView() {
   // Draw the selected view on top of the main area
+  // These read the live CPU, which the run's worker thread is writing
+  bool readsCPU = m_activeView == ActiveView::REGISTERS ||
+                  m_activeView == ActiveView::MEMORY ||
+                  m_activeView == ActiveView::INSTRUCTIONS;
+  if (m_run && readsCPU) return;
+
   switch (m_activeView) {
     case ActiveView::REGISTERS:
       m_registerView->draw(m_window);
@@ -409,6 +541,9 @@ void CPUVisualizer::drawActiveView() {
     case ActiveView::QUEUE:
       if (m_queueView) m_queueView->draw(m_window);
       break;
+    case ActiveView::FRAMEBUFFER:
+      if (m_framebufferView) m_framebufferView->draw(m_window);
+      break;
     case ActiveView::NONE:
       // Nothing to draw
       break;
@@ -482,6 +617,12 @@ void CPUVisualizer::handleTextEntered(uint32_t codepoint) {
                                                            : ActiveView::QUEUE;
         return;
       }
+      if (c == 'f') {
+        m_activeView = (m_activeView == ActiveView::FRAMEBUFFER)
+                           ? ActiveView::NONE
+                           : ActiveView::FRAMEBUFFER;
+        return;
+      }
     }
   }
 }
@@ -496,4 +637,48 @@ void CPUVisualizer::syncQueueToCache() {
   InstructionCache::save(m_instructionQueue);
 }
 
+std::vector<word_t> CPUVisualizer::assembleQueue() const {
+  std::vector<word_t> words;
+  for (const auto& line : m_instructionQueue) {
+    try {
+      words.push_back(Decoder::assemble(line));
+    } catch (...) {
+      // ignore malformed lines
+    }
+  }
+  return words;
+}
+
+std::vector<word_t> CPUVisualizer::queueWords() const {
+  // Entries no longer in the queue become halts
+  std::vector<word_t> words = assembleQueue();
+  if (words.size() < m_loadedQueue.size()) words.resize(m_loadedQueue.size(), 0);
+  return words;
+}
+
+void CPUVisualizer::loadQueue() {
+  m_loadedQueue = assembleQueue();
+  for (size_t i = 0; i < m_loadedQueue.size(); ++i) {
+    m_cpu.get_memory().write_word(QUEUE_BASE + static_cast<address_t>(i * 4), m_loadedQueue[i]);
+  }
+  // Set PC to the base of the loaded block
+  m_cpu.get_registers().set_pc(QUEUE_BASE);
+  m_history->restart();
+  // Costs a lookup per instruction, so only while there is a queue to edit
+  m_history->set_fetch_tracking(true);
+  m_queueLoaded = true;
+}
+
+void CPUVisualizer::queueEdited() {
+  if (!m_queueLoaded) return;
+  stopRun();
+
+  // History before the first fetch of a changed word stays; a program that
+  // was run is run again from there rather than from the start
+  m_history->patch_code(QUEUE_BASE, queueWords());
+  m_loadedQueue = assembleQueue();
+  if (m_queueRan) startRun();
+  m_needsUpdate = true;
+}
+
 }  // namespace ez_arch
@@ -0,0 +1,82 @@
+#include "gui/framebuffer_view.hpp"
+#include "gui/style.hpp"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace ez_arch {
+
+namespace {
+constexpr float MAX_DISPLAY_SIZE = 512.f;
+constexpr float HEADER_HEIGHT = 60.f;
+}
+
+FramebufferView::FramebufferView(FramebufferDevice& framebuffer, sf::Font& font)
+    : m_framebuffer(framebuffer), m_font(font), m_x(0.f), m_y(0.f) {
+    sf::Vector2u size(m_framebuffer.width(), m_framebuffer.height());
+    if (!m_texture.resize(size)) {
+        std::cerr << "Warning: Could not create framebuffer texture.\n";
+    }
+
+    // Integer scale keeps pixels sharp
+    float fit = MAX_DISPLAY_SIZE / static_cast<float>(std::max(size.x, size.y));
+    m_scale = std::max(1.f, static_cast<float>(static_cast<int>(fit)));
+}
+
+void FramebufferView::setPosition(float x, float y) {
+    m_x = x;
+    m_y = y;
+}
+
+void FramebufferView::update() {
+    // Only dirty rows go to the GPU, never the whole buffer. They are copied
+    // out under the framebuffer's lock, so a running guest is never read.
+    size_t offset = 0;
+    for (const RowSpan& span : m_framebuffer.take_dirty_rows(m_rows)) {
+        m_texture.update(&m_rows[offset], {m_framebuffer.width(), span.count}, {0, span.first});
+        offset += size_t{span.count} * m_framebuffer.width() * 4;
+    }
+}
+
+void FramebufferView::draw(sf::RenderWindow& window) {
+    drawHeader(window);
+
+    sf::Sprite sprite(m_texture);
+    sprite.setScale({m_scale, m_scale});
+    sprite.setPosition({m_x + PADDING, m_y + HEADER_HEIGHT});
+    window.draw(sprite);
+}
+
+void FramebufferView::drawHeader(sf::RenderWindow& window) {
+    float width = m_framebuffer.width() * m_scale + 2 * PADDING;
+    float height = HEADER_HEIGHT + m_framebuffer.height() * m_scale + PADDING;
+    
+    // Draw background box
+    sf::RectangleShape background({width, height});
+    background.setPosition({m_x, m_y});
+    background.setFillColor(VIEW_BOX_BACKGROUND_COLOR);
+    background.setOutlineColor(VIEW_BOX_OUTLINE_COLOR);
+    background.setOutlineThickness(VIEW_BOX_OUTLINE_THICKNESS);
+    window.draw(background);
+    
+    // Draw title
+    sf::Text title(m_font);
+    title.setString("Framebuffer");
+    title.setCharacterSize(TITLE_FONT_SIZE);
+    title.setFillColor(TITLE_TEXT_COLOR);
+    title.setPosition({m_x + PADDING, m_y + PADDING});
+    window.draw(title);
+    
+    // Draw geometry and base address
+    std::ostringstream info;
+    info << m_framebuffer.width() << 'x' << m_framebuffer.height() << " at 0x" << std::hex
+         << FramebufferDevice::DEFAULT_BASE;
+    sf::Text header(m_font);
+    header.setString(info.str());
+    header.setCharacterSize(HEADER_FONT_SIZE);
+    header.setFillColor(HEADER_TEXT_COLOR);
+    header.setPosition({m_x + PADDING, m_y + 40.f});
+    window.draw(header);
+}
+
+} // namespace ez_arch
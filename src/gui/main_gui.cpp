@@ -1,10 +1,27 @@
 #include <SFML/Graphics.hpp>
+#include <cstring>
+#include <iostream>
+#include <memory>
 #include <optional>
 
 #include "core/cpu.hpp"
+#include "core/shared_state.hpp"
 #include "gui/cpu_visualizer.hpp"
 
-int main() {
+int main(int argc, char** argv) {
+  // --attach <name> follows a CLI session started with "share <name>"
+  std::unique_ptr<ez_arch::SharedStateSubscriber> subscriber;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--attach") == 0 && i + 1 < argc) {
+      try {
+        subscriber = std::make_unique<ez_arch::SharedStateSubscriber>(argv[++i]);
+      } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+      }
+    }
+  }
+
   sf::ContextSettings settings;
   settings.antiAliasingLevel = 8;
   sf::RenderWindow window(sf::VideoMode({1200, 800}),
@@ -64,6 +81,9 @@ int main() {
 
     window.clear(sf::Color(255, 255, 255));
 
+    // Mirror the published state; local edits are overwritten on change
+    if (subscriber && subscriber->sync(cpu)) visualizer.refresh();
+
     // Update visualizer state from CPU
     visualizer.update();
 
@@ -0,0 +1,125 @@
+#include "gui/timeline_view.hpp"
+#include "gui/style.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace ez_arch {
+
+namespace {
+constexpr float LABEL_WIDTH = 180.f;
+constexpr float TRACK_HEIGHT = 6.f;
+constexpr float HANDLE_WIDTH = 8.f;
+}
+
+TimelineView::TimelineView(sf::Font& font)
+    : m_font(font), m_x(0.f), m_y(0.f), m_width(0.f), m_height(0.f),
+      m_first(0), m_last(0), m_current(0), m_dragging(false), m_requested(0) {}
+
+void TimelineView::setPosition(float x, float y) {
+    m_x = x;
+    m_y = y;
+}
+
+void TimelineView::setSize(float width, float height) {
+    m_width = width;
+    m_height = height;
+}
+
+void TimelineView::setOnSeek(SeekCallback callback) {
+    m_onSeek = callback;
+}
+
+void TimelineView::setRange(uint64_t first, uint64_t last, uint64_t current) {
+    m_first = first;
+    m_last = std::max(first, last);
+    m_current = std::clamp(current, m_first, m_last);
+}
+
+void TimelineView::handleMouseMove(float x, float /*y*/) {
+    if (m_dragging) seekTo(x);
+}
+
+void TimelineView::handleMousePress(float x, float y) {
+    if (!contains(x, y) || x < trackLeft() - HANDLE_WIDTH) return;
+    m_dragging = true;
+    m_requested = m_current;
+    seekTo(x);
+}
+
+void TimelineView::handleMouseRelease(float /*x*/, float /*y*/) {
+    m_dragging = false;
+}
+
+void TimelineView::draw(sf::RenderWindow& window) {
+    // Draw background strip
+    sf::RectangleShape background({m_width, m_height});
+    background.setPosition({m_x, m_y});
+    background.setFillColor(VIEW_BOX_BACKGROUND_COLOR);
+    background.setOutlineColor(VIEW_BOX_OUTLINE_COLOR);
+    background.setOutlineThickness(VIEW_BOX_OUTLINE_THICKNESS);
+    window.draw(background);
+
+    // Draw position label
+    sf::Text label(m_font);
+    label.setString("Instr " + std::to_string(m_current) + " / " + std::to_string(m_last));
+    label.setCharacterSize(HEADER_FONT_SIZE);
+    label.setFillColor(TITLE_TEXT_COLOR);
+    label.setPosition({m_x + PADDING, m_y + m_height / 2.f - HEADER_FONT_SIZE / 2.f - 2.f});
+    window.draw(label);
+
+    // Draw track, with the replayed part filled in
+    float centerY = m_y + m_height / 2.f;
+    sf::RectangleShape track({trackRight() - trackLeft(), TRACK_HEIGHT});
+    track.setPosition({trackLeft(), centerY - TRACK_HEIGHT / 2.f});
+    track.setFillColor(sf::Color(180, 180, 180));
+    window.draw(track);
+
+    float handleX = xFor(m_current);
+    sf::RectangleShape elapsed({handleX - trackLeft(), TRACK_HEIGHT});
+    elapsed.setPosition({trackLeft(), centerY - TRACK_HEIGHT / 2.f});
+    elapsed.setFillColor(BUTTON_NORMAL_COLOR);
+    window.draw(elapsed);
+
+    // Draw handle
+    sf::RectangleShape handle({HANDLE_WIDTH, m_height - 2 * PADDING});
+    handle.setPosition({handleX - HANDLE_WIDTH / 2.f, m_y + PADDING});
+    handle.setFillColor(m_dragging ? BUTTON_PRESSED_COLOR : BUTTON_HOVER_COLOR);
+    window.draw(handle);
+}
+
+float TimelineView::trackLeft() const {
+    return m_x + LABEL_WIDTH;
+}
+
+float TimelineView::trackRight() const {
+    return std::max(trackLeft() + 1.f, m_x + m_width - PADDING);
+}
+
+bool TimelineView::contains(float x, float y) const {
+    return x >= m_x && x <= m_x + m_width && y >= m_y && y <= m_y + m_height;
+}
+
+uint64_t TimelineView::instructionAt(float x) const {
+    float fraction = (x - trackLeft()) / (trackRight() - trackLeft());
+    fraction = std::clamp(fraction, 0.f, 1.f);
+    double span = static_cast<double>(m_last - m_first);
+    return m_first + static_cast<uint64_t>(std::llround(fraction * span));
+}
+
+float TimelineView::xFor(uint64_t instruction) const {
+    if (m_last == m_first) return trackLeft();
+    double fraction = static_cast<double>(instruction - m_first) /
+                      static_cast<double>(m_last - m_first);
+    return trackLeft() + static_cast<float>(fraction) * (trackRight() - trackLeft());
+}
+
+void TimelineView::seekTo(float x) {
+    // Report each new instruction once while dragging; every seek replays
+    uint64_t instruction = instructionAt(x);
+    if (instruction == m_requested) return;
+    m_requested = instruction;
+    if (m_onSeek) m_onSeek(instruction);
+}
+
+} // namespace ez_arch
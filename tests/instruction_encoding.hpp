@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core/types.hpp"
+
+namespace ez_arch {
+
+// Helper function to create R-type instruction
+inline word_t make_r_instruction(uint8_t rs, uint8_t rt, uint8_t rd, uint8_t shamt, uint8_t funct) {
+  return (0 << 26) | (rs << 21) | (rt << 16) | (rd << 11) | (shamt << 6) | funct;
+}
+
+// Helper function to create I-type instruction; imm is a signed value or the
+// raw 16-bit field
+inline word_t make_i_instruction(uint8_t opcode, uint8_t rs, uint8_t rt, int32_t imm) {
+  return (opcode << 26) | (rs << 21) | (rt << 16) | (imm & 0xFFFF);
+}
+
+// Helper function to create J-type instruction
+inline word_t make_j_instruction(uint8_t opcode, uint32_t address) {
+  return (opcode << 26) | (address & 0x3FFFFFF);
+}
+
+} // namespace ez_arch
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "core/async_run.hpp"
+#include "core/time_travel.hpp"
+#include "instruction_encoding.hpp"
+#include <chrono>
+#include <thread>
+
+using namespace ez_arch;
+
+namespace {
+
+// Counts r1 down from `count`, then halts
+std::vector<word_t> countdown_program(uint16_t count) {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 1, count),
+    make_i_instruction(Opcode::ADDI, 1, 1, 0xFFFF),  // loop:
+    make_i_instruction(Opcode::BNE, 1, 0, 0xFFFE),   // bne $1, $0, loop
+    0x00000000
+  };
+}
+
+std::vector<word_t> endless_program() {
+  return {make_i_instruction(Opcode::ADDI, 1, 1, 1), make_i_instruction(Opcode::BEQ, 0, 0, 0xFFFE)};
+}
+
+// Drain notifications until the final one
+std::vector<RunNotification> drain(AsyncRun& run) {
+  std::vector<RunNotification> seen;
+  RunNotification notification;
+  while (seen.empty() || !seen.back().finished) {
+    if (run.poll(notification)) {
+      seen.push_back(notification);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  return seen;
+}
+
+} // namespace
+
+TEST(SpscQueueTest, PushPopAcrossWraparound) {
+  SpscQueue<int, 4> queue;
+  int value = 0;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.pop(value));
+
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue.push(round * 10 + i));
+    EXPECT_FALSE(queue.push(99));
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(queue.pop(value));
+      EXPECT_EQ(value, round * 10 + i);
+    }
+    EXPECT_TRUE(queue.empty());
+  }
+}
+
+TEST(AsyncRunTest, RunsToHaltWithCoalescedProgress) {
+  CPU cpu;
+  cpu.load_program(countdown_program(30000));
+  std::unique_ptr<AsyncRun> run = cpu.run_async(CPU::UNLIMITED, 1000);
+
+  std::vector<RunNotification> seen = drain(*run);
+  run->wait();
+  EXPECT_TRUE(run->finished());
+  EXPECT_FALSE(run->cancelled());
+  EXPECT_TRUE(cpu.is_halted());
+
+  // Progress never runs backwards and the last one is the whole run
+  for (size_t i = 1; i < seen.size(); ++i) {
+    EXPECT_GT(seen[i].instructions, seen[i - 1].instructions);
+  }
+  EXPECT_EQ(seen.back().instructions, 1 + 30000 * 2);
+  EXPECT_EQ(run->instructions(), 1 + 30000 * 2);
+  EXPECT_EQ(seen.back().pc, 0x0C);
+  EXPECT_LE(seen.size(), 62u);  // At most one per chunk
+}
+
+TEST(AsyncRunTest, CancelStopsEndlessRun) {
+  CPU cpu;
+  cpu.load_program(endless_program());
+  std::unique_ptr<AsyncRun> run = cpu.run_async();
+
+  while (run->instructions() == 0) std::this_thread::yield();
+  run->cancel();
+  std::vector<RunNotification> seen = drain(*run);
+  run->wait();
+  EXPECT_TRUE(run->cancelled());
+  EXPECT_FALSE(cpu.is_halted());
+  EXPECT_EQ(seen.back().instructions, cpu.get_instruction_count());
+
+  // The CPU is usable synchronously again
+  EXPECT_FALSE(cpu.stop_requested());
+  EXPECT_EQ(cpu.run(10), 10);
+}
+
+TEST(AsyncRunTest, DrivesTimeTravelWithinBudget) {
+  CPU cpu;
+  cpu.load_program(countdown_program(500));
+  TimeTravel history(cpu, 64);
+  {
+    AsyncRun run(cpu, [&](uint64_t count) { return history.run(count); }, 301, 100);
+    run.wait();
+    EXPECT_EQ(run.instructions(), 301);
+  }
+
+  // History recorded by the worker is usable afterwards
+  EXPECT_EQ(history.position(), 301);
+  ASSERT_TRUE(history.seek(3));
+  EXPECT_EQ(cpu.get_registers().read(1), 499);
+}
+
+TEST(AsyncRunTest, RunnerExceptionEndsTheRun) {
+  CPU cpu;
+  cpu.load_program(endless_program());
+  AsyncRun run(cpu, [&](uint64_t count) {
+    if (cpu.get_instruction_count() >= 200) throw std::runtime_error("runner failed");
+    return cpu.run(count);
+  }, CPU::UNLIMITED, 100);
+
+  std::vector<RunNotification> seen = drain(run);
+  run.wait();
+  EXPECT_EQ(seen.back().instructions, 200);
+  ASSERT_TRUE(seen.back().error);
+  EXPECT_THROW(std::rethrow_exception(seen.back().error), std::runtime_error);
+  for (size_t i = 0; i + 1 < seen.size(); ++i) EXPECT_FALSE(seen[i].error);
+}
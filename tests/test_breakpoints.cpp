@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include "core/breakpoints.hpp"
+#include "core/time_travel.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+// Counts r1 down from 5, stores at 0x0C and the branch at 0x10
+std::vector<word_t> countdown_program() {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 1, 5),
+    make_i_instruction(Opcode::ADDI, 2, 2, 4),       // loop:
+    make_i_instruction(Opcode::SW, 2, 1, 0x2000),
+    make_i_instruction(Opcode::ADDI, 1, 1, 0xFFFF),
+    make_i_instruction(Opcode::BNE, 1, 0, 0xFFFC),   // bne $1, $0, loop
+    0x00000000
+  };
+}
+
+} // namespace
+
+TEST(BreakpointsTest, AddRemoveAndContains) {
+  Breakpoints breakpoints;
+  EXPECT_FALSE(breakpoints.contains(0x0));
+
+  EXPECT_TRUE(breakpoints.add(0x1004));
+  EXPECT_TRUE(breakpoints.add(0xFFFFFFFC));
+  EXPECT_TRUE(breakpoints.add(0x0));
+  EXPECT_FALSE(breakpoints.add(0x1004));
+  EXPECT_THROW(breakpoints.add(0x1002), std::invalid_argument);
+
+  EXPECT_TRUE(breakpoints.contains(0x1004));
+  EXPECT_TRUE(breakpoints.contains(0xFFFFFFFC));
+  EXPECT_TRUE(breakpoints.contains(0x0));
+  EXPECT_FALSE(breakpoints.contains(0x1000));       // Same page
+  EXPECT_FALSE(breakpoints.contains(0x1004 + 4096)); // Same word, next page
+  EXPECT_EQ(breakpoints.addresses(), (std::vector<address_t>{0x0, 0x1004, 0xFFFFFFFC}));
+
+  EXPECT_TRUE(breakpoints.remove(0x1004));
+  EXPECT_FALSE(breakpoints.remove(0x1004));
+  EXPECT_FALSE(breakpoints.contains(0x1004));
+  EXPECT_EQ(breakpoints.size(), 2);
+
+  breakpoints.clear();
+  EXPECT_TRUE(breakpoints.empty());
+  EXPECT_FALSE(breakpoints.contains(0xFFFFFFFC));
+}
+
+TEST(BreakpointsTest, RunStopsBeforeBreakpointAndResumesPastIt) {
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu);
+  Breakpoints breakpoints;
+  breakpoints.add(0x0C);  // The decrement
+
+  EXPECT_EQ(history.run(TimeTravel::UNLIMITED, &breakpoints), 3);
+  EXPECT_EQ(cpu.get_registers().get_pc(), 0x0C);
+  EXPECT_EQ(cpu.get_registers().read(1), 5);
+
+  EXPECT_EQ(history.run(TimeTravel::UNLIMITED, &breakpoints), 4);
+  EXPECT_EQ(cpu.get_registers().get_pc(), 0x0C);
+  EXPECT_EQ(cpu.get_registers().read(1), 4);
+
+  // Breakpoints are positions in history like any other
+  ASSERT_TRUE(history.reverse_continue(
+      [&](const CPU& c) { return breakpoints.contains(c.get_registers().get_pc()); }));
+  EXPECT_EQ(history.position(), 3);
+
+  breakpoints.remove(0x0C);
+  history.run(TimeTravel::UNLIMITED, &breakpoints);
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_EQ(history.position(), 1 + 5 * 4);
+}
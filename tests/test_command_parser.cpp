@@ -119,6 +119,96 @@ TEST(CommandParserTest, ParsePC) {
   EXPECT_EQ(cmd.type, CommandType::PC);
 }
 
+TEST(CommandParserTest, ParseSweep) {
+  Command cmd = CommandParser::parse("sweep out.csv cache=1024,4096 fwd=on");
+  EXPECT_EQ(cmd.type, CommandType::SWEEP);
+  ASSERT_EQ(cmd.args.size(), 3);
+  EXPECT_EQ(cmd.args[0], "out.csv");
+  EXPECT_EQ(cmd.args[1], "cache=1024,4096");
+}
+
+TEST(CommandParserTest, ParseSample) {
+  Command cmd = CommandParser::parse("sample 10000 500 1000");
+  EXPECT_EQ(cmd.type, CommandType::SAMPLE);
+  ASSERT_EQ(cmd.args.size(), 3);
+  EXPECT_EQ(cmd.args[2], "1000");
+}
+
+TEST(CommandParserTest, ParseTraceAndCacheSim) {
+  Command trace = CommandParser::parse("trace accesses.bin");
+  EXPECT_EQ(trace.type, CommandType::TRACE);
+  ASSERT_EQ(trace.args.size(), 1);
+
+  Command sim = CommandParser::parse("cachesim accesses.bin size=1048576 assoc=8");
+  EXPECT_EQ(sim.type, CommandType::CACHE_SIM);
+  ASSERT_EQ(sim.args.size(), 3);
+  EXPECT_EQ(sim.args[1], "size=1048576");
+}
+
+TEST(CommandParserTest, ParseShare) {
+  Command cmd = CommandParser::parse("share ez_run");
+  EXPECT_EQ(cmd.type, CommandType::SHARE);
+  ASSERT_EQ(cmd.args.size(), 1);
+  EXPECT_EQ(cmd.args[0], "ez_run");
+}
+
+TEST(CommandParserTest, ParseBreakpointCommands) {
+  Command cmd = CommandParser::parse("break 0x400010");
+  EXPECT_EQ(cmd.type, CommandType::BREAK);
+  ASSERT_EQ(cmd.args.size(), 1);
+  EXPECT_EQ(cmd.args[0], "0x400010");
+
+  EXPECT_EQ(CommandParser::parse("b main").type, CommandType::BREAK);
+  EXPECT_EQ(CommandParser::parse("delete").type, CommandType::DELETE);
+  EXPECT_EQ(CommandParser::parse("continue").type, CommandType::CONTINUE);
+  EXPECT_EQ(CommandParser::parse("c").type, CommandType::CONTINUE);
+  EXPECT_EQ(CommandParser::parse("rc").type, CommandType::REVERSE_CONTINUE);
+}
+
+TEST(CommandParserTest, ParseBack) {
+  Command cmd = CommandParser::parse("back 5");
+  EXPECT_EQ(cmd.type, CommandType::BACK);
+  ASSERT_EQ(cmd.args.size(), 1);
+  EXPECT_EQ(cmd.args[0], "5");
+}
+
+TEST(CommandParserTest, ParseSeek) {
+  Command cmd = CommandParser::parse("seek 1200");
+  EXPECT_EQ(cmd.type, CommandType::SEEK);
+  ASSERT_EQ(cmd.args.size(), 1);
+  EXPECT_EQ(cmd.args[0], "1200");
+}
+
+TEST(CommandParserTest, ParseHashAndLoopCheck) {
+  EXPECT_EQ(CommandParser::parse("hash").type, CommandType::HASH);
+  Command cmd = CommandParser::parse("loopcheck off");
+  EXPECT_EQ(cmd.type, CommandType::LOOP_CHECK);
+  ASSERT_EQ(cmd.args.size(), 1);
+  EXPECT_EQ(cmd.args[0], "off");
+}
+
+TEST(CommandParserTest, ParseRunCache) {
+  Command cmd = CommandParser::parse("runcache .ez_runs");
+  EXPECT_EQ(cmd.type, CommandType::RUN_CACHE);
+  ASSERT_EQ(cmd.args.size(), 1);
+  EXPECT_EQ(cmd.args[0], ".ez_runs");
+}
+
+TEST(CommandParserTest, ParseTimeParallel) {
+  Command cmd = CommandParser::parse("ptime 1000000 10000 8");
+  EXPECT_EQ(cmd.type, CommandType::TIME_PARALLEL);
+  ASSERT_EQ(cmd.args.size(), 3);
+  EXPECT_EQ(cmd.args[2], "8");
+}
+
+TEST(CommandParserTest, ParseVerify) {
+  Command cmd = CommandParser::parse("verify 1000 stage");
+  EXPECT_EQ(cmd.type, CommandType::VERIFY);
+  ASSERT_EQ(cmd.args.size(), 2);
+  EXPECT_EQ(cmd.args[0], "1000");
+  EXPECT_EQ(cmd.args[1], "stage");
+}
+
 TEST(CommandParserTest, ParseReset) {
   Command cmd = CommandParser::parse("reset");
   EXPECT_EQ(cmd.type, CommandType::RESET);
@@ -1,23 +1,11 @@
 #include <gtest/gtest.h>
 #include "core/cpu.hpp"
+#include "instruction_encoding.hpp"
+#include <chrono>
+#include <thread>
 
 using namespace ez_arch;
 
-// Helper function to create R-type instruction
-word_t make_r_instruction(uint8_t rs, uint8_t rt, uint8_t rd, uint8_t shamt, uint8_t funct) {
-  return (0 << 26) | (rs << 21) | (rt << 16) | (rd << 11) | (shamt << 6) | funct;
-}
-
-// Helper function to create I-type instruction
-word_t make_i_instruction(uint8_t opcode, uint8_t rs, uint8_t rt, int16_t imm) {
-  return (opcode << 26) | (rs << 21) | (rt << 16) | (imm & 0xFFFF);
-}
-
-// Helper function to create J-type instruction
-word_t make_j_instruction(uint8_t opcode, uint32_t address) {
-  return (opcode << 26) | (address & 0x3FFFFFF);
-}
-
 // Initialization Tests
 TEST(CPUTest, DefaultInitialization) {
   CPU cpu;
@@ -626,3 +614,144 @@ TEST(CPUTest, SimpleLoop) {
   EXPECT_EQ(cpu.get_registers().read(1), 5);
   EXPECT_EQ(cpu.get_registers().read(2), 0);
 }
+
+// Faults
+TEST(CPUTest, MisalignedLoadFaultsAndHalts) {
+  CPU cpu;
+  // lw $2, 2($0)
+  std::vector<word_t> program = {make_i_instruction(Opcode::LW, 0, 2, 2)};
+
+  cpu.load_program(program);
+  cpu.run();
+
+  EXPECT_TRUE(cpu.is_halted());
+  ASSERT_TRUE(cpu.is_faulted());
+  EXPECT_EQ(cpu.get_fault()->kind(), MemoryFault::Kind::MISALIGNED);
+  EXPECT_EQ(cpu.get_registers().get_pc(), 0);  // Still on the faulting lw
+}
+
+TEST(CPUTest, StageStepFaultResetsToFetch) {
+  CPU cpu;
+  // sw $1, 1($0)
+  std::vector<word_t> program = {make_i_instruction(Opcode::SW, 0, 1, 1)};
+
+  cpu.load_program(program);
+  for (int i = 0; i < 4; ++i) cpu.step_stage();
+
+  EXPECT_TRUE(cpu.is_faulted());
+  EXPECT_EQ(cpu.get_current_stage(), ExecutionStage::FETCH);
+
+  cpu.reset();
+  EXPECT_FALSE(cpu.is_faulted());
+  EXPECT_FALSE(cpu.is_halted());
+}
+
+// Baselines
+TEST(CPUTest, RestoreBaselineRewindsState) {
+  CPU cpu;
+  std::vector<word_t> program = {
+    make_i_instruction(Opcode::ADDI, 0, 1, 100),  // r1 = 100
+    make_i_instruction(Opcode::SW, 1, 2, 0),      // mem[100] = r2
+    make_i_instruction(Opcode::ADDI, 2, 2, 1),    // r2 = r2 + 1
+    0x00000000
+  };
+
+  cpu.load_program(program);
+  EXPECT_FALSE(cpu.restore_baseline());
+  cpu.get_registers().write(2, 7);
+  cpu.save_baseline();
+
+  for (int run = 0; run < 3; ++run) {
+    cpu.run();
+    EXPECT_TRUE(cpu.is_halted());
+    EXPECT_EQ(cpu.get_memory().read_word(100), 7);
+    EXPECT_EQ(cpu.get_registers().read(2), 8);
+
+    ASSERT_TRUE(cpu.restore_baseline());
+    EXPECT_FALSE(cpu.is_halted());
+    EXPECT_EQ(cpu.get_registers().get_pc(), 0);
+    EXPECT_EQ(cpu.get_registers().read(2), 7);
+    EXPECT_EQ(cpu.get_memory().read_word(100), 0);
+    EXPECT_EQ(cpu.get_memory().read_word(4), program[1]);
+  }
+
+  cpu.reset();
+  EXPECT_FALSE(cpu.has_baseline());
+}
+
+// Copy-on-write snapshots
+TEST(CPUTest, ForkRunsIndependently) {
+  CPU parent;
+  std::vector<word_t> program = {
+    make_i_instruction(Opcode::ADDI, 2, 2, 1),    // r2 = r2 + 1
+    make_i_instruction(Opcode::SW, 0, 2, 64),     // mem[64] = r2
+    0x00000000
+  };
+  parent.load_program(program);
+
+  CPU child = parent.fork();
+  child.get_registers().write(2, 10);
+  child.run();
+  parent.run();
+
+  EXPECT_EQ(parent.get_memory().read_word(64), 1);
+  EXPECT_EQ(child.get_memory().read_word(64), 11);
+  EXPECT_EQ(parent.get_memory().read_word(0), program[0]);
+}
+
+TEST(CPUTest, SnapshotRestoresMidPipeline) {
+  CPU cpu;
+  std::vector<word_t> program = {
+    make_i_instruction(Opcode::ADDI, 1, 1, 5),    // r1 = r1 + 5
+    make_i_instruction(Opcode::SW, 0, 1, 128),    // mem[128] = r1
+    0x00000000
+  };
+  cpu.load_program(program);
+  cpu.step_stage();
+  cpu.step_stage();  // Decoded the addi
+
+  auto snapshot = cpu.snapshot();
+  cpu.run();
+  EXPECT_EQ(cpu.get_memory().read_word(128), 5);
+
+  for (int run = 0; run < 2; ++run) {
+    cpu.restore(*snapshot);
+    EXPECT_EQ(cpu.get_current_stage(), ExecutionStage::EXECUTE);
+    EXPECT_EQ(cpu.get_memory().read_word(128), 0);
+    cpu.run();
+    EXPECT_EQ(cpu.get_memory().read_word(128), 5);
+  }
+}
+
+TEST(CPUTest, RunStopsAtInstructionLimit) {
+  CPU cpu;
+  cpu.load_program({make_i_instruction(Opcode::ADDI, 1, 1, 1),
+                    make_i_instruction(Opcode::BEQ, 0, 0, -2)});  // Loops forever
+
+  EXPECT_EQ(cpu.run(1001), 1001);
+  EXPECT_EQ(cpu.get_registers().read(1), 501);
+  EXPECT_EQ(cpu.get_registers().get_pc(), 4);
+  EXPECT_EQ(cpu.run(0), 0);
+  EXPECT_FALSE(cpu.is_halted());
+}
+
+TEST(CPUTest, RequestStopEndsRunFromAnotherThread) {
+  CPU cpu;
+  cpu.load_program({make_i_instruction(Opcode::ADDI, 1, 1, 1),
+                    make_i_instruction(Opcode::BEQ, 0, 0, -2)});
+
+  std::thread stopper([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    cpu.request_stop();
+  });
+  uint64_t retired = cpu.run();
+  stopper.join();
+  EXPECT_GT(retired, 0u);
+  EXPECT_FALSE(cpu.is_halted());
+  EXPECT_EQ(cpu.get_registers().get_pc(), 0);  // Stopped at the loop's taken branch
+
+  // Stays requested until cleared
+  EXPECT_EQ(cpu.run(), 0);
+  cpu.clear_stop();
+  EXPECT_EQ(cpu.run(10), 10);
+}
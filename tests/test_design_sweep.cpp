@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <sstream>
+#include "core/cpu.hpp"
+#include "core/design_sweep.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+// $8 = 5; loop: $8 -= 1; sw $8, 0x100($0); bne $8, $0, loop; halt
+std::vector<word_t> countdown_program() {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 8, 5),
+    make_i_instruction(Opcode::ADDI, 8, 8, -1),
+    make_i_instruction(Opcode::SW, 0, 8, 0x100),
+    make_i_instruction(Opcode::BNE, 8, 0, -3),
+    0x00000000
+  };
+}
+
+TraceRecord alu_record(address_t pc, register_id_t dest, register_id_t src1,
+                       register_id_t src2 = 0) {
+  TraceRecord record{};
+  record.pc = pc;
+  record.dest = dest;
+  record.src1 = src1;
+  record.src2 = src2;
+  return record;
+}
+
+} // namespace
+
+// Cache Model Tests
+TEST(CacheModelTest, DirectMappedConflict) {
+  CacheModel cache({64, 16, 1});  // 4 sets
+  EXPECT_FALSE(cache.access(0x000));
+  EXPECT_TRUE(cache.access(0x004));   // Same line
+  EXPECT_FALSE(cache.access(0x040));  // Same set, evicts 0x000
+  EXPECT_FALSE(cache.access(0x000));
+  EXPECT_EQ(cache.misses(), 3);
+  EXPECT_EQ(cache.hits(), 1);
+}
+
+TEST(CacheModelTest, TwoWayLRU) {
+  CacheModel cache({64, 16, 2});  // 2 sets
+  cache.access(0x000);
+  cache.access(0x020);
+  cache.access(0x000);                // 0x020 is now LRU
+  EXPECT_FALSE(cache.access(0x040));  // Evicts 0x020
+  EXPECT_TRUE(cache.access(0x000));
+  EXPECT_FALSE(cache.access(0x020));
+}
+
+TEST(CacheModelTest, RejectsBadGeometry) {
+  EXPECT_THROW(CacheModel({100, 16, 1}), std::invalid_argument);
+  EXPECT_THROW(CacheModel({64, 12, 1}), std::invalid_argument);
+}
+
+// Branch Predictor Tests
+TEST(BranchPredictorTest, TwoBitLearnsLoop) {
+  BranchPredictor predictor(PredictorType::TWO_BIT);
+  for (int i = 0; i < 10; ++i) {
+    predictor.resolve(0x10, 0x04, true);
+  }
+  EXPECT_TRUE(predictor.predict(0x10, 0x04));
+  EXPECT_EQ(predictor.branches(), 10);
+  EXPECT_EQ(predictor.mispredictions(), 1);
+}
+
+TEST(BranchPredictorTest, BackwardTakenForwardNot) {
+  BranchPredictor predictor(PredictorType::BTFN);
+  EXPECT_TRUE(predictor.predict(0x10, 0x04));
+  EXPECT_FALSE(predictor.predict(0x10, 0x20));
+}
+
+// Timing Model Tests
+TEST(TimingModelTest, IndependentInstructionsDoNotStall) {
+  TimingModel model(TimingConfig{});
+  model.consume(alu_record(0, 8, 1));
+  model.consume(alu_record(4, 9, 2));
+  EXPECT_EQ(model.stats().data_stall_cycles, 0);
+  // 2 instructions + 4 fill cycles + 1 cold icache miss
+  EXPECT_EQ(model.stats().cycles, 2 + 4 + model.config().miss_penalty);
+}
+
+TEST(TimingModelTest, ForwardingRemovesAluHazard) {
+  TimingConfig config;
+  config.forwarding = true;
+  TimingModel model(config);
+  model.consume(alu_record(0, 8, 1));
+  model.consume(alu_record(4, 9, 8));
+  EXPECT_EQ(model.stats().data_stall_cycles, 0);
+}
+
+TEST(TimingModelTest, NoForwardingStallsUntilWriteBack) {
+  TimingConfig config;
+  config.forwarding = false;
+  TimingModel model(config);
+  model.consume(alu_record(0, 8, 1));
+  model.consume(alu_record(4, 9, 8));
+  EXPECT_EQ(model.stats().data_stall_cycles, 2);
+}
+
+TEST(TimingModelTest, LoadUseStallsOnceWithForwarding) {
+  TimingModel model(TimingConfig{});
+  TraceRecord load = alu_record(0, 8, 0);
+  load.flags = TraceFlag::LOAD;
+  load.mem_addr = 0x100;
+  model.consume(load);
+  // The cold dcache miss freezes the whole pipeline, so it is not a data stall
+  model.consume(alu_record(4, 9, 8));
+  EXPECT_EQ(model.stats().data_stall_cycles, 1);
+  EXPECT_EQ(model.stats().dcache_misses, 1);
+}
+
+// Trace Recorder Tests
+TEST(TraceRecorderTest, RecordsLoopUntilHalt) {
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  std::vector<TraceRecord> trace = TraceRecorder::record(cpu, 1000);
+
+  EXPECT_TRUE(cpu.is_halted());
+  ASSERT_EQ(trace.size(), 1 + 5 * 3);
+
+  const TraceRecord& store = trace[2];
+  EXPECT_TRUE(store.is_store());
+  EXPECT_EQ(store.mem_addr, 0x100);
+
+  const TraceRecord& first_branch = trace[3];
+  EXPECT_TRUE(first_branch.is_branch());
+  EXPECT_TRUE(first_branch.is_taken());
+  EXPECT_EQ(first_branch.target, 4);
+  EXPECT_FALSE(trace.back().is_taken());
+}
+
+TEST(TraceRecorderTest, StopsAtInstructionBudget) {
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  std::vector<TraceRecord> trace = TraceRecorder::record(cpu, 4);
+  EXPECT_EQ(trace.size(), 4);
+  EXPECT_FALSE(cpu.is_halted());
+}
+
+// Design Sweep Tests
+TEST(DesignSweepTest, GridSkipsInvalidGeometry) {
+  SweepGrid grid;
+  grid.cache_sizes = {64, 96};
+  grid.associativities = {1, 2};
+  grid.predictors = {PredictorType::TWO_BIT};
+  grid.forwarding = {true, false};
+  // 96 bytes gives a non power of two set count for both associativities
+  EXPECT_EQ(DesignSweep::make_configs(grid).size(), 4);
+}
+
+TEST(DesignSweepTest, ParallelMatchesSerial) {
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  std::vector<TraceRecord> trace = TraceRecorder::record(cpu, 1000);
+  std::vector<TimingConfig> configs = DesignSweep::make_configs(SweepGrid{});
+
+  auto serial = DesignSweep::run(trace, configs, 1);
+  auto parallel = DesignSweep::run(trace, configs, 4);
+
+  ASSERT_EQ(serial.size(), configs.size());
+  ASSERT_EQ(parallel.size(), configs.size());
+  for (size_t i = 0; i < configs.size(); ++i) {
+    EXPECT_EQ(serial[i].stats.cycles, parallel[i].stats.cycles);
+    EXPECT_EQ(parallel[i].stats.instructions, trace.size());
+  }
+}
+
+TEST(DesignSweepTest, ForwardingReducesCycles) {
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  std::vector<TraceRecord> trace = TraceRecorder::record(cpu, 1000);
+
+  TimingConfig with_forwarding;
+  TimingConfig without_forwarding;
+  without_forwarding.forwarding = false;
+
+  auto results = DesignSweep::run(trace, {with_forwarding, without_forwarding});
+  EXPECT_LT(results[0].stats.cycles, results[1].stats.cycles);
+}
+
+TEST(DesignSweepTest, CsvHasRowPerConfig) {
+  std::vector<SweepResult> results(3);
+  std::ostringstream out;
+  DesignSweep::write_csv(out, results);
+
+  std::string text = out.str();
+  EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 4);
+  EXPECT_EQ(text.rfind("cache_bytes,", 0), 0);
+}
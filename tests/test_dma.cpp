@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include "core/cpu.hpp"
+#include "core/dma.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+// Offsets of the DMA registers from $zero
+constexpr uint16_t REG_SRC = 0xF000;
+constexpr uint16_t REG_DST = 0xF004;
+constexpr uint16_t REG_LEN = 0xF008;
+constexpr uint16_t REG_CONTROL = 0xF00C;
+constexpr uint16_t REG_STATUS = 0xF010;
+
+// Program r1 -> src, r2 -> dst, r3 -> len, start, then spin until DONE
+std::vector<word_t> dma_copy_program() {
+  return {
+    make_i_instruction(Opcode::SW, 0, 1, REG_SRC),
+    make_i_instruction(Opcode::SW, 0, 2, REG_DST),
+    make_i_instruction(Opcode::SW, 0, 3, REG_LEN),
+    make_i_instruction(Opcode::ORI, 0, 4, DmaDevice::START),
+    make_i_instruction(Opcode::SW, 0, 4, REG_CONTROL),
+    make_i_instruction(Opcode::LW, 0, 5, REG_STATUS),  // poll:
+    make_i_instruction(Opcode::ANDI, 5, 5, DmaDevice::DONE),
+    make_i_instruction(Opcode::BEQ, 5, 0, 0xFFFD),      // beq $5, $0, poll
+    0x00000000
+  };
+}
+
+} // namespace
+
+TEST(DmaTest, TransferCompletesAfterModeledLatency) {
+  Memory mem;
+  DmaDevice dma(DmaConfig{10, 4});
+  mem.write_word(0x1000, 0xAABBCCDD);
+
+  dma.write_word(DmaDevice::SRC, 0x1000);
+  dma.write_word(DmaDevice::DST, 0x2000);
+  dma.write_word(DmaDevice::LEN, 16);
+  dma.write_word(DmaDevice::CONTROL, DmaDevice::START);
+  EXPECT_EQ(dma.read_word(DmaDevice::STATUS), DmaDevice::BUSY);
+
+  dma.tick(mem, 13);  // 10 setup + 4 transfer cycles not yet elapsed
+  EXPECT_EQ(dma.read_word(DmaDevice::STATUS), DmaDevice::BUSY);
+  EXPECT_EQ(mem.read_word(0x2000), 0);
+
+  dma.tick(mem, 14);
+  EXPECT_EQ(dma.read_word(DmaDevice::STATUS), DmaDevice::DONE);
+  EXPECT_EQ(mem.read_word(0x2000), 0xAABBCCDD);
+  EXPECT_EQ(dma.read_word(DmaDevice::TRAFFIC_LO), 32);
+  EXPECT_EQ(dma.transfers(), 1);
+  EXPECT_EQ(dma.busy_cycles(), 14);
+
+  dma.write_word(DmaDevice::CONTROL, DmaDevice::ACK);
+  EXPECT_EQ(dma.read_word(DmaDevice::STATUS), 0);
+}
+
+TEST(DmaTest, FaultingTransferSetsError) {
+  Memory mem(1 << 16);
+  DmaDevice dma;
+  dma.write_word(DmaDevice::SRC, 0xFFF0);
+  dma.write_word(DmaDevice::LEN, 64);  // Runs past the end of memory
+  dma.write_word(DmaDevice::CONTROL, DmaDevice::START);
+  dma.tick(mem, 1000);
+  EXPECT_EQ(dma.read_word(DmaDevice::STATUS), DmaDevice::ERROR);
+  EXPECT_EQ(dma.transfers(), 0);
+}
+
+TEST(DmaTest, GuestProgramOverlapsTransferWithPolling) {
+  CPU cpu;
+  auto dma = std::make_shared<DmaDevice>();
+  cpu.get_memory().map_device(DmaDevice::DEFAULT_BASE, Memory::PAGE_SIZE, dma);
+
+  cpu.load_program(dma_copy_program());
+  for (address_t i = 0; i < 64; i += 4) {
+    cpu.get_memory().write_word(0x4000 + i, 0x100 + i);
+  }
+  cpu.get_registers().write(1, 0x4000);
+  cpu.get_registers().write(2, 0x8000);
+  cpu.get_registers().write(3, 64);
+
+  cpu.run();
+
+  ASSERT_FALSE(cpu.is_faulted());
+  for (address_t i = 0; i < 64; i += 4) {
+    EXPECT_EQ(cpu.get_memory().read_word(0x8000 + i), 0x100 + i);
+  }
+  // Five setup instructions, then at least 8 + 64/4 cycles of polling
+  EXPECT_GE(cpu.get_instruction_count(), 5u + 24u);
+  EXPECT_EQ(dma->bytes_read() + dma->bytes_written(), 128);
+}
+
+TEST(DmaTest, ForkGetsItsOwnController) {
+  CPU parent;
+  auto dma = std::make_shared<DmaDevice>();
+  parent.get_memory().map_device(DmaDevice::DEFAULT_BASE, Memory::PAGE_SIZE, dma);
+  parent.load_program(dma_copy_program());
+  parent.get_memory().write_word(0x4000, 42);
+  parent.get_registers().write(1, 0x4000);
+  parent.get_registers().write(2, 0x8000);
+  parent.get_registers().write(3, 4);
+
+  CPU child = parent.fork();
+  child.run();
+
+  EXPECT_EQ(child.get_memory().read_word(0x8000), 42);
+  EXPECT_EQ(parent.get_memory().read_word(0x8000), 0);
+  EXPECT_EQ(dma->transfers(), 0);
+}
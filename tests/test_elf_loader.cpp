@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include "core/elf_loader.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+constexpr address_t TEXT_BASE = 0x00400000;
+constexpr uint32_t SEGMENT_OFFSET = 0x1000;
+constexpr uint32_t SEGMENT_FILESZ = 0x2000;
+
+void put16(std::vector<uint8_t>& out, size_t at, uint16_t value) {
+  out[at] = static_cast<uint8_t>(value >> 8);
+  out[at + 1] = static_cast<uint8_t>(value);
+}
+
+void put32(std::vector<uint8_t>& out, size_t at, uint32_t value) {
+  for (int i = 0; i < 4; ++i) out[at + i] = static_cast<uint8_t>(value >> (24 - 8 * i));
+}
+
+// Executable with one PT_LOAD segment (two file pages plus a .bss page) and a
+// symbol table naming `main` and `table`
+std::vector<uint8_t> build_elf() {
+  std::vector<uint8_t> elf(SEGMENT_OFFSET + SEGMENT_FILESZ, 0);
+
+  const uint8_t ident[] = {0x7F, 'E', 'L', 'F', 1, 2, 1};
+  std::copy(std::begin(ident), std::end(ident), elf.begin());
+  put16(elf, 16, 2);                // ET_EXEC
+  put16(elf, 18, 8);                // EM_MIPS
+  put32(elf, 24, TEXT_BASE + 4);    // Entry skips the first word
+  put32(elf, 28, 52);               // Program headers
+  put32(elf, 32, 0x200);            // Section headers
+  put16(elf, 42, 32);
+  put16(elf, 44, 1);
+  put16(elf, 46, 40);
+  put16(elf, 48, 3);
+
+  put32(elf, 52, 1);                // PT_LOAD
+  put32(elf, 52 + 4, SEGMENT_OFFSET);
+  put32(elf, 52 + 8, TEXT_BASE);
+  put32(elf, 52 + 16, SEGMENT_FILESZ);
+  put32(elf, 52 + 20, SEGMENT_FILESZ + 0x1000);
+
+  const char strings[] = "\0main\0table";
+  std::copy(std::begin(strings), std::end(strings), elf.begin() + 0x100);
+  put32(elf, 0x130, 1);             // main
+  put32(elf, 0x134, TEXT_BASE);
+  put32(elf, 0x138, 16);
+  elf[0x13C] = 0x12;                // GLOBAL FUNC
+  put16(elf, 0x13E, 1);
+  put32(elf, 0x140, 6);             // table
+  put32(elf, 0x144, TEXT_BASE + 0x1000);
+  put32(elf, 0x148, 8);
+  elf[0x14C] = 0x11;                // GLOBAL OBJECT
+  put16(elf, 0x14E, 1);
+
+  put32(elf, 0x228 + 4, 2);         // .symtab
+  put32(elf, 0x228 + 16, 0x120);
+  put32(elf, 0x228 + 20, 48);
+  put32(elf, 0x228 + 24, 2);
+  put32(elf, 0x250 + 4, 3);         // .strtab
+  put32(elf, 0x250 + 16, 0x100);
+  put32(elf, 0x250 + 20, sizeof(strings));
+
+  put32(elf, SEGMENT_OFFSET + 4, 0x20080007);  // addi $t0, $zero, 7
+  put32(elf, SEGMENT_OFFSET + 8, 0x20090FF9);  // addi $t1, $zero, 0xFF9; then halt
+  put32(elf, SEGMENT_OFFSET + 0x1000, 0xCAFEBABE);
+  return elf;
+}
+
+std::string write_temp(const std::string& name, const std::vector<uint8_t>& bytes) {
+  std::string path = ::testing::TempDir() + name;
+  std::ofstream out(path, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  return path;
+}
+
+} // namespace
+
+TEST(ElfLoaderTest, MapsSegmentsLazilyAndStartsAtEntry) {
+  std::string path = write_temp("ez_arch_test.elf", build_elf());
+  ASSERT_TRUE(ElfLoader::is_elf(path));
+
+  CPU cpu;
+  ElfProgram program = ElfLoader::load(path, cpu);
+  std::remove(path.c_str());  // The mapping outlives the directory entry
+
+  EXPECT_EQ(program.entry, TEXT_BASE + 4);
+  EXPECT_EQ(program.segments, 1);
+  EXPECT_EQ(program.file_bytes, SEGMENT_FILESZ);
+  EXPECT_EQ(cpu.get_registers().get_pc(), TEXT_BASE + 4);
+  EXPECT_EQ(cpu.get_memory().lazy_pages(), 2);
+
+  cpu.run();
+  EXPECT_EQ(cpu.get_registers().read(8), 7);
+  EXPECT_EQ(cpu.get_registers().read(9), 0xFF9);
+  EXPECT_EQ(cpu.get_memory().lazy_pages(), 1);  // Only the code page was touched
+
+  EXPECT_EQ(cpu.get_memory().read_word(TEXT_BASE + 0x1000), 0xCAFEBABE);
+  EXPECT_EQ(cpu.get_memory().read_word(TEXT_BASE + 0x2000), 0);  // .bss
+}
+
+TEST(ElfLoaderTest, LoadsSymbolTable) {
+  std::string path = write_temp("ez_arch_symbols.elf", build_elf());
+  CPU cpu;
+  ElfProgram program = ElfLoader::load(path, cpu);
+  std::remove(path.c_str());
+
+  ASSERT_EQ(program.symbols.size(), 2);
+  EXPECT_EQ(program.symbols.describe(TEXT_BASE), "main");
+  EXPECT_EQ(program.symbols.describe(TEXT_BASE + 8), "main+0x8");
+  EXPECT_EQ(program.symbols.describe(TEXT_BASE + 0x1004), "table+0x4");
+  EXPECT_EQ(program.symbols.describe(TEXT_BASE + 0x20), "");  // Past main's size
+  EXPECT_EQ(program.symbols.describe(0), "");
+
+  ASSERT_NE(program.symbols.lookup("table"), nullptr);
+  EXPECT_EQ(program.symbols.lookup("table")->address, TEXT_BASE + 0x1000);
+  EXPECT_EQ(program.symbols.lookup("missing"), nullptr);
+}
+
+TEST(ElfLoaderTest, RejectsOtherFiles) {
+  std::vector<uint8_t> elf = build_elf();
+  elf[5] = 1;  // Little-endian
+  std::string path = write_temp("ez_arch_le.elf", elf);
+  CPU cpu;
+  EXPECT_THROW(ElfLoader::load(path, cpu), std::runtime_error);
+  std::remove(path.c_str());
+
+  std::string text = write_temp("ez_arch_not.elf", {'0', '0', '0', '0', '\n'});
+  EXPECT_FALSE(ElfLoader::is_elf(text));
+  EXPECT_THROW(ElfLoader::load(text, cpu), std::runtime_error);
+  std::remove(text.c_str());
+
+  EXPECT_THROW(ElfLoader::load("/nonexistent/ez_arch.elf", cpu), std::runtime_error);
+}
+
+TEST(ElfLoaderTest, BadLaterSegmentLeavesCpuUntouched) {
+  std::vector<uint8_t> elf = build_elf();
+  put16(elf, 44, 2);
+  put32(elf, 84, 1);                // Second PT_LOAD, misaligned
+  put32(elf, 84 + 4, SEGMENT_OFFSET);
+  put32(elf, 84 + 8, TEXT_BASE + 0x10002);
+  put32(elf, 84 + 16, 4);
+  put32(elf, 84 + 20, 4);
+  std::string path = write_temp("ez_arch_bad_segment.elf", elf);
+
+  CPU cpu;
+  cpu.load_program({0x20080007, 0x00000000});
+  cpu.get_registers().set_pc(4);
+  EXPECT_THROW(ElfLoader::load(path, cpu), std::runtime_error);
+  std::remove(path.c_str());
+
+  EXPECT_EQ(cpu.get_memory().read_word(0), 0x20080007u);
+  EXPECT_EQ(cpu.get_memory().lazy_pages(), 0u);
+  EXPECT_EQ(cpu.get_registers().get_pc(), 4u);
+}
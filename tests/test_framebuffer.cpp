@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include "core/cpu.hpp"
+#include "core/framebuffer.hpp"
+
+using namespace ez_arch;
+
+TEST(FramebufferTest, WritesStoreOpaqueRgba) {
+  FramebufferDevice fb(4, 2);
+  fb.write_word(4 * 5, 0x00112233);  // Pixel (1, 1)
+
+  const uint8_t* p = fb.row_pixels(1) + 4;
+  EXPECT_EQ(p[0], 0x11);
+  EXPECT_EQ(p[1], 0x22);
+  EXPECT_EQ(p[2], 0x33);
+  EXPECT_EQ(p[3], 0xFF);
+  EXPECT_EQ(fb.read_word(4 * 5), 0x00112233);
+}
+
+TEST(FramebufferTest, TracksDirtyRows) {
+  FramebufferDevice fb(8, 8);
+
+  // Reset leaves the whole buffer dirty for the first upload
+  std::vector<RowSpan> spans = fb.take_dirty_rows();
+  ASSERT_EQ(spans.size(), 1u);
+  EXPECT_EQ(spans[0].first, 0u);
+  EXPECT_EQ(spans[0].count, 8u);
+  EXPECT_TRUE(fb.take_dirty_rows().empty());
+
+  // Rows apart stay apart; adjacent rows merge
+  fb.write_word(4 * (8 * 7), 1);      // Row 7
+  fb.write_word(4 * (8 * 3 + 2), 1);  // Row 3
+  fb.write_word(4 * (8 * 0), 1);      // Row 0
+  fb.write_word(4 * (8 * 2), 1);      // Row 2
+  spans = fb.take_dirty_rows();
+  ASSERT_EQ(spans.size(), 3u);
+  EXPECT_EQ(spans[0].first, 0u);
+  EXPECT_EQ(spans[0].count, 1u);
+  EXPECT_EQ(spans[1].first, 2u);
+  EXPECT_EQ(spans[1].count, 2u);
+  EXPECT_EQ(spans[2].first, 7u);
+  EXPECT_EQ(spans[2].count, 1u);
+  EXPECT_TRUE(fb.take_dirty_rows().empty());
+}
+
+TEST(FramebufferTest, CopiesDirtyRowsForAnotherThread) {
+  FramebufferDevice fb(4, 4);
+  std::vector<uint8_t> rows;
+  fb.take_dirty_rows(rows);
+
+  fb.write_word(4 * (4 * 1 + 2), 0x00112233);  // Row 1
+  fb.write_word(4 * (4 * 3), 0x00445566);      // Row 3
+  std::vector<RowSpan> spans = fb.take_dirty_rows(rows);
+  ASSERT_EQ(spans.size(), 2u);
+  ASSERT_EQ(rows.size(), 2u * 4 * 4);
+  EXPECT_EQ(rows[2 * 4], 0x11);          // Row 1, pixel 2
+  EXPECT_EQ(rows[4 * 4 + 2], 0x66);      // Row 3, pixel 0
+  EXPECT_TRUE(fb.take_dirty_rows(rows).empty());
+  EXPECT_TRUE(rows.empty());
+}
+
+TEST(FramebufferTest, GuestStoresReachTheFramebuffer) {
+  CPU cpu;
+  auto fb = std::make_shared<FramebufferDevice>();
+  cpu.get_memory().map_device(FramebufferDevice::DEFAULT_BASE, fb->mapped_size(), fb);
+
+  std::vector<word_t> program = {
+    (word_t{Opcode::ORI} << 26) | (1 << 16) | 0xABCD,   // ori $1, $0, 0xABCD
+    (word_t{Opcode::SW} << 26) | (1 << 16) | 0x8000,    // sw $1, -32768($0)
+    0x00000000
+  };
+  cpu.load_program(program);
+  cpu.run();
+
+  EXPECT_FALSE(cpu.is_faulted());
+  EXPECT_EQ(fb->read_word(0), 0x0000ABCD);
+  EXPECT_EQ(cpu.get_memory().read_word(FramebufferDevice::DEFAULT_BASE), 0x0000ABCD);
+}
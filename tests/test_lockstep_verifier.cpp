@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "core/lockstep_verifier.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+// Sums 1..n into $t3 through memory, storing each partial sum to its own word
+std::vector<word_t> sum_program(int16_t n) {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 8, n),
+    make_i_instruction(Opcode::ADDI, 9, 9, 4),        // loop:
+    make_r_instruction(11, 8, 11, 0, Funct::ADD),
+    make_i_instruction(Opcode::SW, 9, 11, 0x1000),
+    make_i_instruction(Opcode::LW, 9, 10, 0x1000),    // 0x10
+    make_i_instruction(Opcode::ADDI, 8, 8, -1),
+    make_i_instruction(Opcode::BNE, 8, 0, -6),
+    0x00000000
+  };
+}
+
+constexpr uint64_t SUM_LENGTH = 1 + 6 * 500;
+
+// step(), but the 137th instruction leaves a wrong register or memory word
+class FaultyEngine : public ExecutionEngine {
+public:
+    explicit FaultyEngine(bool memory) : m_memory(memory) {}
+    std::string_view name() const override { return "faulty"; }
+
+    uint64_t run(CPU& cpu, uint64_t max_instructions) override {
+      uint64_t start = cpu.get_instruction_count();
+      while (!cpu.is_halted() && cpu.get_instruction_count() - start < max_instructions) {
+        cpu.step();
+        if (cpu.get_instruction_count() != 137) continue;
+        if (m_memory) {
+          cpu.get_memory().write_word(0x3000, 0xBAD);
+        } else {
+          cpu.get_registers().write(11, cpu.get_registers().read(11) + 1);
+        }
+      }
+      return cpu.get_instruction_count() - start;
+    }
+
+private:
+    bool m_memory;
+};
+
+VerifyConfig config_for(VerifyGranularity granularity) {
+  VerifyConfig config;
+  config.granularity = granularity;
+  config.interval = 50;
+  return config;
+}
+
+} // namespace
+
+TEST(LockstepVerifierTest, BuiltInEnginesMatchReference) {
+  for (const char* name : {"stage", "run"}) {
+    for (VerifyGranularity granularity : {VerifyGranularity::INSTRUCTION, VerifyGranularity::BLOCK,
+                                          VerifyGranularity::INTERVAL}) {
+      CPU cpu;
+      cpu.load_program(sum_program(500));
+      std::unique_ptr<ExecutionEngine> engine = ExecutionEngine::create(name);
+      VerifyResult result = LockstepVerifier::run(cpu, *engine, config_for(granularity));
+      EXPECT_FALSE(result.divergence) << name;
+      EXPECT_TRUE(result.halted) << name;
+      EXPECT_EQ(result.instructions, SUM_LENGTH) << name;
+      EXPECT_EQ(cpu.get_registers().read(11), 500 * 501 / 2) << name;
+    }
+  }
+  EXPECT_THROW(ExecutionEngine::create("jit"), std::invalid_argument);
+}
+
+TEST(LockstepVerifierTest, FindsExactDivergingInstructionAtAnyGranularity) {
+  uint64_t block_comparisons = 0;
+  for (VerifyGranularity granularity : {VerifyGranularity::INSTRUCTION, VerifyGranularity::BLOCK,
+                                        VerifyGranularity::INTERVAL}) {
+    CPU cpu;
+    cpu.load_program(sum_program(500));
+    FaultyEngine engine(false);
+    VerifyResult result = LockstepVerifier::run(cpu, engine, config_for(granularity));
+    ASSERT_TRUE(result.divergence);
+    EXPECT_EQ(result.divergence->instruction, 136);
+    EXPECT_EQ(result.divergence->pc, 0x10);
+    EXPECT_EQ(result.divergence->word, sum_program(500)[4]);
+    EXPECT_EQ(result.instructions, 136);
+    ASSERT_EQ(result.divergence->differences.size(), 1);
+    const StateDifference& difference = result.divergence->differences[0];
+    EXPECT_EQ(difference.location, "$t3");
+    EXPECT_EQ(difference.actual, difference.expected + 1);
+
+    // The CPU is left right after the bad instruction
+    EXPECT_EQ(cpu.get_instruction_count(), 137);
+    if (granularity == VerifyGranularity::BLOCK) block_comparisons = result.comparisons;
+  }
+  EXPECT_LT(block_comparisons, 137u);
+}
+
+TEST(LockstepVerifierTest, ReportsMemoryDifferences) {
+  CPU cpu;
+  cpu.load_program(sum_program(500));
+  FaultyEngine engine(true);
+  VerifyResult result = LockstepVerifier::run(cpu, engine, config_for(VerifyGranularity::INTERVAL));
+  ASSERT_TRUE(result.divergence);
+  EXPECT_EQ(result.divergence->instruction, 136);
+  ASSERT_EQ(result.divergence->differences.size(), 1);
+  EXPECT_EQ(result.divergence->differences[0].location, "0x00003000");
+  EXPECT_EQ(result.divergence->differences[0].expected, 0);
+  EXPECT_EQ(result.divergence->differences[0].actual, 0xBAD);
+}
+
+TEST(LockstepVerifierTest, RejectsZeroInterval) {
+  CPU cpu;
+  cpu.load_program(sum_program(5));
+  StageEngine engine;
+  VerifyConfig config = config_for(VerifyGranularity::INTERVAL);
+  config.interval = 0;
+  EXPECT_THROW(LockstepVerifier::run(cpu, engine, config), std::invalid_argument);
+}
+
+TEST(LockstepVerifierTest, LoopDetectionDoesNotCountAsDivergence) {
+  CPU cpu;
+  cpu.load_program({
+    make_i_instruction(Opcode::ADDI, 0, 1, 1),
+    make_i_instruction(Opcode::BEQ, 0, 0, -1),  // Spins on itself
+  });
+  cpu.set_loop_detection(true);
+  std::unique_ptr<ExecutionEngine> engine = ExecutionEngine::create("run");
+  VerifyConfig config = config_for(VerifyGranularity::INTERVAL);
+  config.interval = 1000;  // Long enough for CPU::run to sample the loop
+  config.max_instructions = 5000;
+  VerifyResult result = LockstepVerifier::run(cpu, *engine, config);
+  EXPECT_FALSE(result.divergence);
+  EXPECT_EQ(result.instructions, 5000);
+  EXPECT_FALSE(result.halted);
+  EXPECT_TRUE(cpu.loop_detection());
+}
@@ -88,6 +88,29 @@ TEST(MemoryTest, LoadProgramAtOffset) {
   EXPECT_EQ(mem.read_word(104), 0xCAFEBABE);
 }
 
+TEST(MemoryTest, LoadProgramAcrossPageBoundary) {
+  Memory mem;
+  std::vector<word_t> program(2000);
+  for (size_t i = 0; i < program.size(); ++i) {
+    program[i] = static_cast<word_t>(i * 0x01010101);
+  }
+  mem.load_program(program, 0xFF0);
+
+  EXPECT_EQ(mem.read_word(0xFF0), 0);
+  EXPECT_EQ(mem.read_word(0x1000), 4 * 0x01010101u);
+  EXPECT_EQ(mem.read_word(0xFF0 + 1999 * 4), 1999 * 0x01010101u);
+}
+
+TEST(MemoryTest, LoadBigEndianImage) {
+  Memory mem(1024);
+  const uint8_t image[] = {0x12, 0x34, 0x56, 0x78, 0xDE, 0xAD, 0xBE};
+  mem.load_image(image, sizeof(image), 8);
+
+  EXPECT_EQ(mem.read_word(8), 0x12345678);
+  EXPECT_EQ(mem.read_word(12), 0xDEADBE00);
+  EXPECT_EQ(mem.read_byte(14), 0xBE);
+}
+
 TEST(MemoryTest, LoadEmptyProgram) {
   Memory mem(1024);
   std::vector<word_t> program = {};
@@ -132,7 +155,7 @@ TEST(MemoryTest, CustomSize) {
 
 TEST(MemoryTest, DefaultSize) {
   Memory mem;
-  EXPECT_EQ(mem.size(), 1024 * 1024);  // 1MB default
+  EXPECT_EQ(mem.size(), 1ULL << 32);  // Full 32-bit address space
 }
 
 // Edge Cases
@@ -175,3 +198,402 @@ TEST(MemoryTest, NonZeroInitialValue) {
   EXPECT_EQ(mem.read_word(496), 0x00000000);
   EXPECT_EQ(mem.read_word(504), 0x00000000);
 }
+
+// Sparse Paging Tests
+TEST(MemoryTest, NoPagesUntilFirstWrite) {
+  Memory mem;
+  EXPECT_EQ(mem.read_word(0x10000000), 0);
+  EXPECT_EQ(mem.read_byte(0x7FFFFFFF), 0);
+  EXPECT_EQ(mem.resident_pages(), 0);
+}
+
+TEST(MemoryTest, HighAddresses) {
+  Memory mem;
+  mem.write_word(0x10000000, 0x11111111);  // Data segment
+  mem.write_word(0x7FFFFFFC, 0x22222222);  // Top of stack
+  mem.write_word(0xFFFFFFFC, 0x33333333);  // Last word
+
+  EXPECT_EQ(mem.read_word(0x10000000), 0x11111111);
+  EXPECT_EQ(mem.read_word(0x7FFFFFFC), 0x22222222);
+  EXPECT_EQ(mem.read_word(0xFFFFFFFC), 0x33333333);
+  EXPECT_EQ(mem.resident_pages(), 3);
+}
+
+TEST(MemoryTest, WritesWithinPageShareOnePage) {
+  Memory mem;
+  mem.write_word(0x2000, 1);
+  mem.write_word(0x2FFC, 2);
+  mem.write_byte(0x2800, 3);
+  EXPECT_EQ(mem.resident_pages(), 1);
+}
+
+TEST(MemoryTest, ResetReleasesPages) {
+  Memory mem;
+  mem.write_word(0x10000000, 0xDEADBEEF);
+  mem.reset();
+  EXPECT_EQ(mem.resident_pages(), 0);
+  EXPECT_EQ(mem.read_word(0x10000000), 0);
+}
+
+TEST(MemoryTest, CopyIsIndependent) {
+  Memory original;
+  original.write_word(0x1000, 0xAAAAAAAA);
+
+  Memory copy(original);
+  copy.write_word(0x1000, 0xBBBBBBBB);
+
+  EXPECT_EQ(original.read_word(0x1000), 0xAAAAAAAA);
+  EXPECT_EQ(copy.read_word(0x1000), 0xBBBBBBBB);
+  EXPECT_EQ(copy.resident_pages(), 1);
+}
+
+// Faults
+TEST(MemoryTest, OutOfRangeAccessFaults) {
+  Memory mem(1024);
+  EXPECT_THROW(mem.read_word(1024), MemoryFault);
+  EXPECT_THROW(mem.write_word(0x80000000, 1), MemoryFault);
+  EXPECT_THROW(mem.read_byte(1024), MemoryFault);
+  EXPECT_THROW(mem.write_byte(0xFFFFFFFF, 1), MemoryFault);
+  EXPECT_EQ(mem.resident_pages(), 0);
+}
+
+TEST(MemoryTest, MisalignedWordAccessFaults) {
+  Memory mem;
+  try {
+    mem.write_word(0x102, 1);
+    FAIL() << "Expected MemoryFault";
+  } catch (const MemoryFault& fault) {
+    EXPECT_EQ(fault.kind(), MemoryFault::Kind::MISALIGNED);
+    EXPECT_EQ(fault.address(), 0x102);
+  }
+  EXPECT_THROW(mem.read_word(0x101), MemoryFault);
+}
+
+TEST(MemoryTest, LoadProgramPastEndFaults) {
+  Memory mem(1024);
+  std::vector<word_t> program(4, 0x11111111);
+  EXPECT_THROW(mem.load_program(program, 1012), MemoryFault);
+}
+
+// Dirty tracking
+TEST(MemoryTest, EpochTracksWrittenPages) {
+  Memory mem;
+  mem.write_word(0x1000, 1);
+  mem.write_word(0x5000, 2);
+
+  uint64_t epoch = mem.begin_epoch();
+  EXPECT_TRUE(mem.pages_written_since(epoch).empty());
+
+  mem.write_word(0x5004, 3);
+  mem.write_byte(0x9000, 4);  // Newly allocated page
+  std::vector<address_t> written = mem.pages_written_since(epoch);
+  ASSERT_EQ(written.size(), 2);
+  EXPECT_EQ(written[0], 0x5000);
+  EXPECT_EQ(written[1], 0x9000);
+}
+
+TEST(MemoryTest, RestoreSinceCopiesOnlyWrittenPages) {
+  Memory mem;
+  mem.write_word(0x1000, 0x11111111);
+  mem.write_word(0x2000, 0x22222222);
+
+  Memory baseline(mem);
+  uint64_t epoch = mem.begin_epoch();
+
+  mem.write_word(0x2000, 0xDEADBEEF);
+  mem.write_word(0x70000000, 0xCAFEBABE);
+  EXPECT_EQ(mem.resident_pages(), 3);
+
+  uint64_t next = mem.restore_since(baseline, epoch);
+  EXPECT_GT(next, epoch);
+  EXPECT_EQ(mem.read_word(0x1000), 0x11111111);
+  EXPECT_EQ(mem.read_word(0x2000), 0x22222222);
+  EXPECT_EQ(mem.read_word(0x70000000), 0);
+  EXPECT_EQ(mem.resident_pages(), 2);
+  EXPECT_TRUE(mem.pages_written_since(next).empty());
+
+  // Tracking keeps working after a restore
+  mem.write_word(0x1000, 5);
+  EXPECT_EQ(mem.pages_written_since(next).size(), 1);
+  mem.restore_since(baseline, next);
+  EXPECT_EQ(mem.read_word(0x1000), 0x11111111);
+}
+
+// Copy-on-write
+TEST(MemoryTest, ForkSharesPagesUntilWritten) {
+  Memory parent;
+  parent.write_word(0x1000, 0x11111111);
+  parent.write_word(0x2000, 0x22222222);
+
+  Memory child = parent.fork();
+  EXPECT_EQ(parent.shared_pages(), 2);
+  EXPECT_EQ(child.read_word(0x1000), 0x11111111);
+
+  child.write_word(0x1000, 0xCCCCCCCC);
+  parent.write_word(0x2000, 0xAAAAAAAA);
+
+  EXPECT_EQ(parent.read_word(0x1000), 0x11111111);
+  EXPECT_EQ(parent.read_word(0x2000), 0xAAAAAAAA);
+  EXPECT_EQ(child.read_word(0x1000), 0xCCCCCCCC);
+  EXPECT_EQ(child.read_word(0x2000), 0x22222222);
+  EXPECT_EQ(parent.shared_pages(), 0);
+  EXPECT_EQ(child.resident_pages(), 2);
+}
+
+TEST(MemoryTest, ForkOfForkStaysIsolated) {
+  Memory root;
+  root.write_byte(0x3000, 0x5A);
+  Memory a = root.fork();
+  Memory b = a.fork();
+
+  b.write_byte(0x3000, 0x01);
+  a.write_byte(0x3001, 0x02);
+
+  EXPECT_EQ(root.read_word(0x3000), 0x5A000000);
+  EXPECT_EQ(a.read_word(0x3000), 0x5A020000);
+  EXPECT_EQ(b.read_word(0x3000), 0x01000000);
+}
+
+// Memory-mapped devices
+namespace {
+
+class RecordingDevice : public Device {
+public:
+  word_t read_word(address_t offset) override {
+    ++reads;
+    return 0xD0000000 | offset;
+  }
+  void write_word(address_t offset, word_t value) override {
+    last_offset = offset;
+    last_value = value;
+  }
+  void reset() override { ++resets; }
+
+  int reads = 0;
+  int resets = 0;
+  address_t last_offset = 0;
+  word_t last_value = 0;
+};
+
+} // namespace
+
+TEST(MemoryTest, DeviceReceivesAccessesInItsRange) {
+  Memory mem;
+  auto device = std::make_shared<RecordingDevice>();
+  mem.map_device(0xFFFF0000, 0x2000, device);
+
+  EXPECT_EQ(mem.read_word(0xFFFF0010), 0xD0000010);
+  mem.write_word(0xFFFF1004, 0x12345678);
+  EXPECT_EQ(device->last_offset, 0x1004);
+  EXPECT_EQ(device->last_value, 0x12345678);
+
+  // Bytes go through the containing word
+  EXPECT_EQ(mem.read_byte(0xFFFF0020), 0xD0);
+  mem.write_byte(0xFFFF0003, 0xAB);
+  EXPECT_EQ(device->last_offset, 0);
+  EXPECT_EQ(device->last_value, 0xD00000AB);
+
+  // RAM next to the device is untouched
+  mem.write_word(0xFFFEFFFC, 7);
+  EXPECT_EQ(mem.read_word(0xFFFEFFFC), 7);
+  EXPECT_EQ(mem.resident_pages(), 1);
+}
+
+TEST(MemoryTest, DeviceMappingSurvivesResetAndFork) {
+  Memory mem;
+  auto device = std::make_shared<RecordingDevice>();
+  mem.write_word(0x4000, 1);  // RAM replaced by the mapping
+  mem.map_device(0x4000, Memory::PAGE_SIZE, device);
+  EXPECT_EQ(mem.resident_pages(), 0);
+
+  mem.reset();
+  EXPECT_EQ(device->resets, 1);
+  EXPECT_EQ(mem.read_word(0x4000), 0xD0000000);
+
+  Memory child = mem.fork();
+  child.write_word(0x4008, 9);
+  EXPECT_EQ(device->last_value, 9);
+}
+
+TEST(MemoryTest, RejectsBadDeviceRanges) {
+  Memory mem(1 << 20);
+  auto device = std::make_shared<RecordingDevice>();
+  EXPECT_THROW(mem.map_device(0x100, Memory::PAGE_SIZE, device), std::invalid_argument);
+  EXPECT_THROW(mem.map_device(0x1000, 100, device), std::invalid_argument);
+  EXPECT_THROW(mem.map_device(1 << 20, Memory::PAGE_SIZE, device), std::invalid_argument);
+
+  mem.map_device(0x2000, 2 * Memory::PAGE_SIZE, device);
+  EXPECT_THROW(mem.map_device(0x3000, Memory::PAGE_SIZE, device), std::invalid_argument);
+  EXPECT_EQ(mem.device_count(), 1);
+}
+
+TEST(MemoryTest, CopyBlockAcrossPages) {
+  Memory mem;
+  for (address_t i = 0; i < 3 * Memory::PAGE_SIZE; i += 4) {
+    mem.write_word(0x10000 + i, i);
+  }
+  mem.copy_block(0x20800, 0x10000, 3 * Memory::PAGE_SIZE);
+  for (address_t i = 0; i < 3 * Memory::PAGE_SIZE; i += 4) {
+    ASSERT_EQ(mem.read_word(0x20800 + i), i);
+  }
+}
+
+TEST(MemoryTest, CopyBlockOverlappingAndUnaligned) {
+  Memory mem;
+  mem.write_word(0x100, 0x01020304);
+  mem.write_word(0x104, 0x05060708);
+
+  mem.copy_block(0x102, 0x100, 6);  // Overlapping, like memmove
+  EXPECT_EQ(mem.read_word(0x100), 0x01020102);
+  EXPECT_EQ(mem.read_word(0x104), 0x03040506);
+
+  EXPECT_THROW(mem.copy_block(0, 0xFFFFFFF0, 32), MemoryFault);
+}
+
+TEST(MemoryTest, CopyBlockLargeOverlappingRanges) {
+  // Far more than is sensible to stage through a host buffer
+  constexpr uint64_t LENGTH = 64ull << 20;
+  constexpr address_t SRC = 0x10000000;
+  Memory mem;
+  for (uint64_t offset = 0; offset < LENGTH; offset += Memory::PAGE_SIZE) {
+    mem.write_word(static_cast<address_t>(SRC + offset), static_cast<word_t>(offset));
+  }
+  mem.write_word(static_cast<address_t>(SRC + LENGTH - 4), 0xCAFEF00D);
+
+  // Up one word, then back down; the data survives both ways
+  mem.copy_block(SRC + 4, SRC, LENGTH);
+  EXPECT_EQ(mem.read_word(SRC + 4 + 0x123000), 0x123000u);
+  EXPECT_EQ(mem.read_word(static_cast<address_t>(SRC + LENGTH)), 0xCAFEF00D);
+  mem.copy_block(SRC, SRC + 4, LENGTH);
+  EXPECT_EQ(mem.read_word(SRC + 0x123000), 0x123000u);
+  EXPECT_EQ(mem.read_word(static_cast<address_t>(SRC + LENGTH - 4)), 0xCAFEF00D);
+
+  // Unaligned takes the byte path, in the same directions
+  constexpr uint64_t BYTES = 1 << 20;
+  mem.copy_block(SRC + 1, SRC, BYTES);
+  EXPECT_EQ(mem.read_byte(SRC + 1 + 0x1000), 0x00);
+  EXPECT_EQ(mem.read_word(SRC + 0x1000), 0x00000010u);
+  mem.copy_block(SRC, SRC + 1, BYTES);
+  EXPECT_EQ(mem.read_word(SRC + 0x1000), 0x00001000u);
+}
+
+// Lazily mapped images
+namespace {
+
+std::shared_ptr<const uint8_t> counting_image(size_t size) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(size);
+  for (size_t i = 0; i < size; ++i) (*bytes)[i] = static_cast<uint8_t>(i / 4 + i % 4);
+  return std::shared_ptr<const uint8_t>(bytes, bytes->data());
+}
+
+} // namespace
+
+TEST(MemoryTest, MapImageCopiesPagesOnFirstTouch) {
+  Memory mem;
+  auto image = counting_image(4 * Memory::PAGE_SIZE + 8);
+  mem.map_image(image, 4 * Memory::PAGE_SIZE + 8, 0x10800);
+
+  // Partial pages at both ends are copied right away
+  EXPECT_EQ(mem.lazy_pages(), 3);
+  EXPECT_EQ(mem.resident_pages(), 2);
+
+  EXPECT_EQ(mem.read_byte(0x10800), 0);
+  EXPECT_EQ(mem.read_word(0x11800), 0x00010203u + 0x01010101u * (0x1000 / 4 % 256));
+  EXPECT_EQ(mem.lazy_pages(), 2);
+
+  // A write keeps the rest of the page
+  mem.write_byte(0x12800, 0xAA);
+  EXPECT_EQ(mem.read_byte(0x12801), image.get()[0x2001]);
+  EXPECT_EQ(mem.lazy_pages(), 1);
+
+  // Whole-memory visitors see every image page
+  size_t visited = 0;
+  mem.for_each_page([&](address_t, const word_t*, uint64_t) { ++visited; });
+  EXPECT_EQ(visited, 5);
+  EXPECT_EQ(mem.lazy_pages(), 0);
+}
+
+TEST(MemoryTest, MapImageSurvivesForkAndRestore) {
+  Memory mem;
+  auto image = counting_image(2 * Memory::PAGE_SIZE);
+  mem.map_image(image, 2 * Memory::PAGE_SIZE, 0x4000);
+
+  Memory baseline = mem.fork();
+  uint64_t epoch = mem.begin_epoch();
+  mem.write_word(0x4000, 0xDEADBEEF);
+
+  // The baseline never touched the page, so restoring maps it lazily again
+  mem.restore_since(baseline, epoch);
+  EXPECT_EQ(mem.lazy_pages(), 2);
+  EXPECT_EQ(mem.read_word(0x4000), 0x00010203u);
+  EXPECT_EQ(baseline.read_word(0x4000), 0x00010203u);
+  EXPECT_EQ(mem.read_word(0x5000), 0x00010203u + 0x01010101u * (0x1000 / 4 % 256));
+
+  mem.reset();
+  EXPECT_EQ(mem.lazy_pages(), 0);
+  EXPECT_EQ(mem.read_word(0x4000), 0);
+}
+
+TEST(MemoryTest, WatchesTrapOnlyWatchedAccesses) {
+  Memory mem;
+  mem.write_word(0x2000, 1);  // Resident before the watch is set
+  mem.add_watch(0x2004, 8);
+  mem.add_watch(0x9000, 4, true);
+
+  mem.write_word(0x2000, 2);
+  mem.write_word(0x200C, 3);
+  mem.write_word(0x3004, 4);
+  EXPECT_EQ(mem.read_word(0x2004), 0);  // Reads only hit read watches
+  EXPECT_FALSE(mem.watch_hit());
+
+  mem.write_byte(0x200B, 0xAA);
+  ASSERT_TRUE(mem.watch_hit());
+  EXPECT_EQ(mem.watch_hit()->addr, 0x200B);
+  EXPECT_TRUE(mem.watch_hit()->write);
+  mem.write_word(0x2004, 5);
+  EXPECT_EQ(mem.watch_hit()->addr, 0x200B);  // The first hit is kept
+
+  mem.clear_watch_hit();
+  EXPECT_EQ(mem.read_word(0x9000), 0);
+  ASSERT_TRUE(mem.watch_hit());
+  EXPECT_FALSE(mem.watch_hit()->write);
+
+  mem.clear_watch_hit();
+  mem.copy_block(0x2000, 0x5000, 16);  // Block copies count too
+  EXPECT_TRUE(mem.watch_hit());
+
+  EXPECT_THROW(mem.add_watch(0x2008, 8), std::invalid_argument);
+  EXPECT_THROW(mem.add_watch(0x2000, 0), std::invalid_argument);
+  Memory small(1 << 16);
+  EXPECT_THROW(small.add_watch(0xFFFE, 4), std::invalid_argument);
+}
+
+TEST(MemoryTest, WatchesSurviveResetAndFork) {
+  Memory mem;
+  mem.add_watch(0x2000, 4);
+
+  mem.reset();
+  mem.write_word(0x2000, 1);
+  EXPECT_TRUE(mem.watch_hit());
+
+  Memory child = mem.fork();
+  EXPECT_FALSE(child.watch_hit());
+  child.write_word(0x2000, 2);
+  EXPECT_TRUE(child.watch_hit());
+
+  // Removing a watch stops the trapping, and other memories can take it over
+  EXPECT_TRUE(mem.remove_watch(0x2000));
+  EXPECT_FALSE(mem.remove_watch(0x2000));
+  mem.clear_watch_hit();
+  mem.write_word(0x2000, 3);
+  EXPECT_FALSE(mem.watch_hit());
+
+  mem.copy_watches(child);
+  mem.write_word(0x2000, 4);
+  EXPECT_TRUE(mem.watch_hit());
+  child.clear_watches();
+  child.clear_watch_hit();
+  child.write_word(0x2000, 5);
+  EXPECT_FALSE(child.watch_hit());
+  EXPECT_EQ(mem.watches().size(), 1);
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <random>
+#include "core/parallel_cache_sim.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+std::vector<MemoryAccess> random_accesses(size_t count) {
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<address_t> addr(0, 0x3FFFF);
+  std::vector<MemoryAccess> accesses;
+  for (size_t i = 0; i < count; ++i) {
+    accesses.push_back({addr(rng) & ~address_t{3}, static_cast<AccessKind>(i % 3)});
+  }
+  return accesses;
+}
+
+} // namespace
+
+TEST(ParallelCacheSimTest, MatchesSerialCacheModel) {
+  CacheConfig config{16384, 32, 4};
+  std::vector<MemoryAccess> accesses = random_accesses(20000);
+
+  CacheModel serial(config);
+  for (const MemoryAccess& access : accesses) {
+    serial.access(access.addr);
+  }
+
+  for (unsigned threads : {1u, 3u, 8u}) {
+    CacheSimStats stats = ParallelCacheSim::run(accesses, config, threads);
+    EXPECT_EQ(stats.accesses, serial.accesses());
+    EXPECT_EQ(stats.misses, serial.misses());
+    EXPECT_EQ(stats.fetch_misses + stats.load_misses + stats.store_misses, stats.misses);
+  }
+}
+
+TEST(ParallelCacheSimTest, MoreThreadsThanSets) {
+  CacheConfig config{64, 16, 2};  // 2 sets
+  std::vector<MemoryAccess> accesses = random_accesses(100);
+  CacheSimStats stats = ParallelCacheSim::run(accesses, config, 16);
+  EXPECT_EQ(stats.accesses, 100);
+}
+
+TEST(ParallelCacheSimTest, TraceFileRoundTrip) {
+  std::vector<MemoryAccess> accesses = random_accesses(50);
+  std::string path = ::testing::TempDir() + "ez_arch_access_trace.bin";
+
+  ASSERT_TRUE(save_access_trace(path, accesses));
+  std::vector<MemoryAccess> loaded;
+  ASSERT_TRUE(load_access_trace(path, loaded));
+  std::remove(path.c_str());
+
+  ASSERT_EQ(loaded.size(), accesses.size());
+  for (size_t i = 0; i < accesses.size(); ++i) {
+    EXPECT_EQ(loaded[i].addr, accesses[i].addr);
+    EXPECT_EQ(loaded[i].kind, accesses[i].kind);
+  }
+}
+
+TEST(ParallelCacheSimTest, RejectsMissingTraceFile) {
+  std::vector<MemoryAccess> loaded;
+  EXPECT_FALSE(load_access_trace("/nonexistent/ez_arch_trace.bin", loaded));
+}
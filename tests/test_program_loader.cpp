@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include "core/program_loader.hpp"
+
+using namespace ez_arch;
+
+TEST(ProgramLoaderTest, ParsesHexLines) {
+  const char* text =
+      "# comment\n"
+      "20080005\n"
+      "\n"
+      "0x2009000A\n"
+      "  01095020   # add $t2, $t0, $t1\n"
+      "deadBEEF\r\n"
+      "not hex\n"
+      "00000000";
+
+  for (bool swar : {true, false}) {
+    HexProgram program = ProgramLoader::parse_hex(text, swar);
+    ASSERT_EQ(program.words.size(), 5);
+    EXPECT_EQ(program.words[0], 0x20080005);
+    EXPECT_EQ(program.words[1], 0x2009000A);
+    EXPECT_EQ(program.words[2], 0x01095020);
+    EXPECT_EQ(program.words[3], 0xDEADBEEF);
+    EXPECT_EQ(program.words[4], 0);
+    ASSERT_EQ(program.bad_lines.size(), 1);
+    EXPECT_EQ(program.bad_lines[0], "not hex");
+  }
+}
+
+TEST(ProgramLoaderTest, SwarDecoderMatchesFromChars) {
+  std::mt19937 rng(42);
+  const std::string alphabet = "0123456789abcdefABCDEF@`gG/: xX\x10\x7f";
+  std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+
+  std::string text;
+  for (int line = 0; line < 2000; ++line) {
+    for (int i = 0; i < 8; ++i) {
+      // Mostly valid digits, so both outcomes are well covered
+      text += (line % 4 == 0) ? alphabet[pick(rng)] : alphabet[pick(rng) % 22];
+    }
+    text += '\n';
+  }
+
+  HexProgram fast = ProgramLoader::parse_hex(text, true);
+  HexProgram slow = ProgramLoader::parse_hex(text, false);
+  EXPECT_EQ(fast.words, slow.words);
+  EXPECT_EQ(fast.bad_lines, slow.bad_lines);
+  EXPECT_GT(fast.words.size(), 1500);
+}
+
+TEST(ProgramLoaderTest, ReadsHexFile) {
+  std::string path = ::testing::TempDir() + "ez_arch_program.hex";
+  {
+    std::ofstream out(path);
+    out << "20080005\n00000000\n";
+  }
+  HexProgram program = ProgramLoader::read_hex_file(path);
+  std::remove(path.c_str());
+
+  EXPECT_EQ(program.words, (std::vector<word_t>{0x20080005, 0}));
+  EXPECT_THROW(ProgramLoader::read_hex_file("/nonexistent/ez_arch.hex"), std::runtime_error);
+}
+
+TEST(ProgramLoaderTest, LoadsBigEndianBinaryImage) {
+  std::string path = ::testing::TempDir() + "ez_arch_program.bin";
+  EXPECT_TRUE(ProgramLoader::is_binary_image(path));
+  EXPECT_FALSE(ProgramLoader::is_binary_image("program.hex"));
+  {
+    // addi $t0, $zero, 5; halt; then a partial trailing word
+    const unsigned char image[] = {0x20, 0x08, 0x00, 0x05, 0, 0, 0, 0, 0xAB, 0xCD};
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(image), sizeof(image));
+  }
+
+  CPU cpu;
+  EXPECT_EQ(ProgramLoader::load_binary_file(path, cpu), 10);
+  std::remove(path.c_str());
+
+  EXPECT_EQ(cpu.get_memory().read_word(0), 0x20080005);
+  EXPECT_EQ(cpu.get_memory().read_word(8), 0xABCD0000);
+  cpu.run();
+  EXPECT_EQ(cpu.get_registers().read(8), 5);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "core/dma.hpp"
+#include "core/run_cache.hpp"
+#include "core/state_hash.hpp"
+#include "instruction_encoding.hpp"
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+
+using namespace ez_arch;
+
+namespace {
+
+// Counts r1 down from 100, storing each value to 0x2004, 0x2008, ...
+std::vector<word_t> countdown_program() {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 1, 100),
+    make_i_instruction(Opcode::ADDI, 2, 2, 4),       // loop:
+    make_i_instruction(Opcode::SW, 2, 1, 0x2000),
+    make_i_instruction(Opcode::ADDI, 1, 1, 0xFFFF),
+    make_i_instruction(Opcode::BNE, 1, 0, 0xFFFC),   // bne $1, $0, loop
+    0x00000000
+  };
+}
+
+std::string fresh_directory(const char* name) {
+  std::string directory = ::testing::TempDir() + name;
+  std::filesystem::remove_all(directory);
+  return directory;
+}
+
+} // namespace
+
+TEST(RunCacheTest, RepeatedRunRestoresStoredResult) {
+  RunCache cache(fresh_directory("ez_arch_run_cache"));
+
+  CPU first;
+  first.load_program(countdown_program());
+  EXPECT_EQ(cache.run(first), 1 + 100 * 4);
+  EXPECT_EQ(cache.misses(), 1);
+
+  CPU second;
+  second.load_program(countdown_program());
+  EXPECT_EQ(cache.run(second), 1 + 100 * 4);
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_TRUE(second.is_halted());
+  EXPECT_EQ(second.get_instruction_count(), first.get_instruction_count());
+  EXPECT_EQ(StateHasher::hash(second), StateHasher::hash(first));
+  EXPECT_EQ(second.get_memory().read_word(0x2004), 100);
+
+  // A different budget or starting state is a different run
+  CPU partial;
+  partial.load_program(countdown_program());
+  EXPECT_EQ(cache.run(partial, 50), 50);
+  partial.get_registers().write(5, 1);
+  EXPECT_EQ(cache.run(partial, 50), 50);
+  EXPECT_EQ(cache.misses(), 3);
+
+  // Results are relative to where the run started
+  CPU resumed;
+  resumed.load_program(countdown_program());
+  resumed.run(50);
+  resumed.get_registers().write(5, 1);
+  uint64_t start = resumed.get_instruction_count();
+  EXPECT_EQ(cache.run(resumed, 50), 50);
+  EXPECT_EQ(cache.hits(), 2);
+  EXPECT_EQ(resumed.get_instruction_count(), start + 50);
+}
+
+TEST(RunCacheTest, RunsUsingDevicesAreNotStored) {
+  RunCache cache(fresh_directory("ez_arch_run_cache_devices"));
+  auto make_cpu = [] {
+    CPU cpu;
+    cpu.get_memory().map_device(DmaDevice::DEFAULT_BASE, Memory::PAGE_SIZE,
+                                std::make_shared<DmaDevice>());
+    return cpu;
+  };
+
+  CPU touches = make_cpu();
+  touches.load_program({make_i_instruction(Opcode::LW, 0, 1, 0xF010), 0x00000000});
+  cache.run(touches);
+  CPU again = make_cpu();
+  again.load_program({make_i_instruction(Opcode::LW, 0, 1, 0xF010), 0x00000000});
+  cache.run(again);
+  EXPECT_EQ(cache.hits(), 0);
+
+  // A mapped but unused device does not matter
+  CPU ignores = make_cpu();
+  ignores.load_program(countdown_program());
+  cache.run(ignores);
+  CPU repeat = make_cpu();
+  repeat.load_program(countdown_program());
+  cache.run(repeat);
+  EXPECT_EQ(cache.hits(), 1);
+}
+
+TEST(RunCacheTest, CollidingEntryForAnotherStateIsAMiss) {
+  std::string directory = fresh_directory("ez_arch_run_cache_collision");
+  RunCache cache(directory);
+
+  CPU stored;
+  stored.load_program(countdown_program());
+  cache.run(stored);
+
+  // Give the entry the name the other program's run would look up, as a
+  // hash collision would
+  CPU other;
+  other.load_program(countdown_program());
+  other.get_registers().write(7, 1);
+  std::ostringstream hash;
+  hash << std::hex << std::setw(16) << std::setfill('0') << StateHasher::hash(other);
+  for (const auto& file : std::filesystem::directory_iterator(directory)) {
+    std::string name = file.path().filename().string();
+    std::filesystem::rename(file.path(), file.path().parent_path() / (hash.str() + name.substr(16)));
+  }
+
+  EXPECT_EQ(cache.run(other), 1 + 100 * 4);
+  EXPECT_EQ(cache.hits(), 0);
+  EXPECT_EQ(cache.misses(), 2);
+  EXPECT_EQ(other.get_registers().read(7), 1);
+
+  // The entry already installed under that name stays, whole, and the
+  // losing write leaves nothing behind
+  size_t entries = 0;
+  for (const auto& file : std::filesystem::directory_iterator(directory)) {
+    EXPECT_TRUE(file.is_directory());
+    EXPECT_EQ(file.path().filename().string().find(".tmp"), std::string::npos);
+    ++entries;
+  }
+  EXPECT_EQ(entries, 1u);
+}
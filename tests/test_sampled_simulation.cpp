@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include "core/cpu.hpp"
+#include "core/sampled_simulation.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+// 6-instruction loop body with a store, a load-use hazard and a backward branch
+std::vector<word_t> loop_program(int16_t iterations) {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 8, iterations),
+    make_i_instruction(Opcode::ADDI, 9, 9, 1),
+    make_i_instruction(Opcode::SW, 0, 9, 0x200),
+    make_i_instruction(Opcode::LW, 0, 10, 0x200),
+    make_r_instruction(10, 9, 11, 0, Funct::ADD),
+    make_i_instruction(Opcode::ADDI, 8, 8, -1),
+    make_i_instruction(Opcode::BNE, 8, 0, -6),
+    0x00000000
+  };
+}
+
+} // namespace
+
+TEST(SampledSimulationTest, EstimateTracksDetailedRun) {
+  SamplingConfig config;
+  config.period = 1000;
+  config.warmup = 100;
+  config.window = 200;
+
+  CPU detailed_cpu;
+  detailed_cpu.load_program(loop_program(3000));
+  TimingModel model(config.timing);
+  for (const TraceRecord& record : TraceRecorder::record(detailed_cpu, 1000000)) {
+    model.consume(record);
+  }
+
+  CPU sampled_cpu;
+  sampled_cpu.load_program(loop_program(3000));
+  SamplingResult result = SampledSimulator::run(sampled_cpu, config);
+
+  EXPECT_TRUE(result.halted);
+  EXPECT_EQ(result.instructions, model.stats().instructions);
+  EXPECT_EQ(result.samples, 18);
+  EXPECT_LT(result.detailed_instructions, result.instructions / 2);
+
+  double actual = static_cast<double>(model.stats().cycles);
+  EXPECT_LT(std::fabs(result.estimated_cycles - actual) / actual, 0.02);
+}
+
+TEST(SampledSimulationTest, ShortRunUsesPartialWindow) {
+  SamplingConfig config;
+  config.period = 1000;
+  config.warmup = 2;
+  config.window = 500;
+
+  CPU cpu;
+  cpu.load_program(loop_program(3));
+  SamplingResult result = SampledSimulator::run(cpu, config);
+
+  EXPECT_TRUE(result.halted);
+  EXPECT_EQ(result.instructions, 1 + 3 * 6);
+  EXPECT_EQ(result.samples, 1);
+  EXPECT_GT(result.mean_cpi, 1.0);
+}
+
+TEST(SampledSimulationTest, RespectsInstructionBudget) {
+  SamplingConfig config;
+  config.period = 100;
+  config.warmup = 10;
+  config.window = 10;
+  config.max_instructions = 250;
+
+  CPU cpu;
+  cpu.load_program(loop_program(3000));
+  SamplingResult result = SampledSimulator::run(cpu, config);
+
+  EXPECT_FALSE(result.halted);
+  EXPECT_EQ(result.instructions, 250);
+  EXPECT_EQ(result.samples, 3);
+}
+
+TEST(SampledSimulationTest, RejectsWindowLargerThanPeriod) {
+  SamplingConfig config;
+  config.period = 100;
+  config.warmup = 60;
+  config.window = 60;
+
+  CPU cpu;
+  EXPECT_THROW(SampledSimulator::run(cpu, config), std::invalid_argument);
+}
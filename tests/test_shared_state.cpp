@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include "core/shared_state.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+std::string segment_name(const char* test) {
+  return std::string("ez_arch_test_") + test + "_" + std::to_string(getpid());
+}
+
+} // namespace
+
+TEST(SharedStateTest, MirrorFollowsPublishedState) {
+  SharedStatePublisher publisher(segment_name("mirror"));
+  SharedStateSubscriber subscriber(publisher.name());
+
+  CPU cpu;
+  cpu.load_program({
+    make_i_instruction(Opcode::ADDI, 0, 1, 7),     // r1 = 7
+    make_i_instruction(Opcode::SW, 0, 1, 0x2000),  // mem[0x2000] = r1
+    0x00000000
+  });
+
+  CPU mirror;
+  EXPECT_FALSE(subscriber.sync(mirror));  // Nothing published yet
+
+  publisher.publish(cpu);
+  ASSERT_TRUE(subscriber.sync(mirror));
+  EXPECT_EQ(mirror.get_memory().read_word(0), cpu.get_memory().read_word(0));
+  EXPECT_FALSE(subscriber.sync(mirror));  // No new publish
+
+  cpu.run();
+  publisher.publish(cpu);
+  ASSERT_TRUE(subscriber.sync(mirror));
+  EXPECT_EQ(mirror.get_registers().read(1), 7);
+  EXPECT_EQ(mirror.get_registers().get_pc(), cpu.get_registers().get_pc());
+  EXPECT_EQ(mirror.get_memory().read_word(0x2000), 7);
+  EXPECT_TRUE(mirror.is_halted());
+  EXPECT_EQ(mirror.get_instruction_count(), 2);
+}
+
+TEST(SharedStateTest, DroppedPagesReadAsZero) {
+  SharedStatePublisher publisher(segment_name("dropped"));
+  SharedStateSubscriber subscriber(publisher.name());
+
+  CPU cpu;
+  CPU mirror;
+  cpu.get_memory().write_word(0x5000, 0xDEADBEEF);
+  publisher.publish(cpu);
+  ASSERT_TRUE(subscriber.sync(mirror));
+  EXPECT_EQ(mirror.get_memory().read_word(0x5000), 0xDEADBEEF);
+
+  cpu.reset();
+  cpu.get_memory().write_word(0x6000, 1);
+  publisher.publish(cpu);
+  ASSERT_TRUE(subscriber.sync(mirror));
+  EXPECT_EQ(mirror.get_memory().read_word(0x5000), 0);
+  EXPECT_EQ(mirror.get_memory().read_word(0x6000), 1);
+}
+
+TEST(SharedStateTest, OnlyChangedPagesAreRepublished) {
+  SharedStatePublisher publisher(segment_name("delta"), 2);
+  SharedStateSubscriber subscriber(publisher.name());
+
+  CPU cpu;
+  CPU mirror;
+  cpu.get_memory().write_word(0x1000, 1);
+  cpu.get_memory().write_word(0x2000, 2);
+  cpu.get_memory().write_word(0x3000, 3);  // No slot left
+  publisher.publish(cpu);
+  EXPECT_TRUE(publisher.overflowed());
+  ASSERT_TRUE(subscriber.sync(mirror));
+
+  // Scribble on the mirror: an unchanged page must not be copied again
+  mirror.get_memory().write_word(0x1000, 99);
+  cpu.get_memory().write_word(0x2000, 20);
+  publisher.publish(cpu);
+  ASSERT_TRUE(subscriber.sync(mirror));
+  EXPECT_EQ(mirror.get_memory().read_word(0x1000), 99);
+  EXPECT_EQ(mirror.get_memory().read_word(0x2000), 20);
+}
+
+TEST(SharedStateTest, MissingSegmentThrows) {
+  EXPECT_THROW(SharedStateSubscriber("ez_arch_test_missing_segment"), std::runtime_error);
+}
+
+TEST(SharedStateTest, LazyImagePagesStayLazy) {
+  SharedStatePublisher publisher(segment_name("lazy"));
+  SharedStateSubscriber subscriber(publisher.name());
+
+  auto bytes = std::make_shared<std::vector<uint8_t>>(4 * Memory::PAGE_SIZE);
+  for (size_t i = 0; i < bytes->size(); ++i) (*bytes)[i] = static_cast<uint8_t>(i * 7);
+  CPU cpu;
+  cpu.get_memory().map_image(std::shared_ptr<const uint8_t>(bytes, bytes->data()), bytes->size(),
+                             0x10000);
+  ASSERT_EQ(cpu.get_memory().lazy_pages(), 4u);
+
+  CPU mirror;
+  publisher.publish(cpu);
+  EXPECT_EQ(cpu.get_memory().lazy_pages(), 4u);
+  ASSERT_TRUE(subscriber.sync(mirror));
+  EXPECT_EQ(mirror.get_memory().read_word(0x12000), 0x00070E15u);
+
+  // A write copies one page in; the rest stay lazy and unchanged
+  cpu.get_memory().write_word(0x13000, 0xDEADBEEF);
+  publisher.publish(cpu);
+  EXPECT_EQ(cpu.get_memory().lazy_pages(), 3u);
+  ASSERT_TRUE(subscriber.sync(mirror));
+  EXPECT_EQ(mirror.get_memory().read_word(0x13000), 0xDEADBEEF);
+  EXPECT_EQ(mirror.get_memory().read_word(0x13004), cpu.get_memory().read_word(0x13004));
+  EXPECT_EQ(mirror.get_memory().read_word(0x11000), cpu.get_memory().read_word(0x11000));
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include "core/state_file.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+std::string temp_path(const char* name) { return ::testing::TempDir() + name; }
+
+size_t file_size(const std::string& path) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  return static_cast<size_t>(in.tellg());
+}
+
+} // namespace
+
+TEST(StateFileTest, RoundTripRestoresFullState) {
+  CPU cpu;
+  cpu.load_program({
+    make_i_instruction(Opcode::ADDI, 0, 1, 7),     // r1 = 7
+    make_i_instruction(Opcode::SW, 0, 1, 0x2000),  // mem[0x2000] = r1
+    make_i_instruction(Opcode::ADDI, 1, 2, 3),     // r2 = r1 + 3
+    0x00000000
+  });
+  cpu.get_memory().write_word(0xF0000000, 0xCAFEBABE);  // Far above the old 64KB window
+  cpu.step();
+  cpu.step_stage();
+  cpu.step_stage();  // Mid-instruction
+
+  std::string path = temp_path("ez_arch_state.ezs");
+  StateFileInfo saved = StateFile::save(path, cpu);
+  EXPECT_EQ(saved.pages, 2);
+  EXPECT_EQ(saved.file_bytes, file_size(path));
+
+  CPU restored;
+  restored.get_registers().write(5, 99);  // Overwritten by the load
+  StateFileInfo loaded = StateFile::load(path, restored);
+  std::remove(path.c_str());
+  EXPECT_EQ(loaded.pages, 2);
+  EXPECT_TRUE(loaded.compressed);
+
+  EXPECT_EQ(restored.get_registers().read(1), 7);
+  EXPECT_EQ(restored.get_registers().read(5), 0);
+  EXPECT_EQ(restored.get_registers().get_pc(), cpu.get_registers().get_pc());
+  EXPECT_EQ(restored.get_current_stage(), cpu.get_current_stage());
+  EXPECT_EQ(restored.get_instruction_count(), cpu.get_instruction_count());
+  EXPECT_EQ(restored.get_memory().read_word(0xF0000000), 0xCAFEBABE);
+
+  cpu.run();
+  restored.run();
+  EXPECT_EQ(restored.get_registers().read(2), 10);
+  EXPECT_EQ(restored.get_memory().read_word(0x2000), 7);
+  EXPECT_EQ(restored.get_instruction_count(), cpu.get_instruction_count());
+}
+
+TEST(StateFileTest, CompressesOnlyWhenSmaller) {
+  CPU cpu;
+  for (address_t i = 0; i < Memory::PAGE_SIZE; i += 4) {
+    cpu.get_memory().write_word(0x10000 + i, i % 64);  // Repetitive
+  }
+  std::mt19937 rng(7);
+  for (address_t i = 0; i < Memory::PAGE_SIZE; i += 4) {
+    cpu.get_memory().write_word(0x20000 + i, rng());  // Incompressible
+  }
+  cpu.get_memory().write_word(0x30000, 1);
+  cpu.get_memory().write_word(0x30000, 0);  // Resident but zero: not stored
+
+  std::string packed = temp_path("ez_arch_packed.ezs");
+  std::string raw = temp_path("ez_arch_raw.ezs");
+  EXPECT_EQ(StateFile::save(packed, cpu).pages, 2);
+  StateFile::save(raw, cpu, false);
+  EXPECT_LT(file_size(packed), file_size(raw) - Memory::PAGE_SIZE / 2);
+
+  for (const std::string& path : {packed, raw}) {
+    CPU restored;
+    StateFile::load(path, restored);
+    std::remove(path.c_str());
+    for (address_t addr : {0x10000u, 0x10FFCu, 0x20000u, 0x20FFCu}) {
+      EXPECT_EQ(restored.get_memory().read_word(addr), cpu.get_memory().read_word(addr));
+    }
+    EXPECT_EQ(restored.get_memory().resident_pages(), 2);
+  }
+}
+
+TEST(StateFileTest, RejectsBadFiles) {
+  CPU cpu;
+  cpu.get_memory().write_word(0x1000, 42);
+  std::string path = temp_path("ez_arch_bad.ezs");
+  StateFile::save(path, cpu);
+
+  // Truncate the page payload
+  size_t size = file_size(path);
+  std::vector<char> bytes(size);
+  std::ifstream(path, std::ios::binary).read(bytes.data(), static_cast<std::streamsize>(size));
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(bytes.data(), static_cast<std::streamsize>(size - 4));
+
+  CPU restored;
+  EXPECT_THROW(StateFile::load(path, restored), std::runtime_error);
+  EXPECT_EQ(restored.get_memory().resident_pages(), 0);
+
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a state file";
+  EXPECT_THROW(StateFile::load(path, restored), std::runtime_error);
+  std::remove(path.c_str());
+
+  EXPECT_THROW(StateFile::load("/nonexistent/ez_arch.ezs", restored), std::runtime_error);
+}
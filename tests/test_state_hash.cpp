@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "core/state_hash.hpp"
+#include "core/dma.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+TEST(StateHashTest, IncrementalHashMatchesFullHash) {
+  CPU cpu;
+  cpu.load_program({make_i_instruction(Opcode::ADDI, 0, 1, 7), 0x00000000});
+  StateHasher hasher(cpu);
+  EXPECT_EQ(hasher.update(), StateHasher::hash(cpu));
+
+  uint64_t before = StateHasher::hash(cpu);
+  cpu.get_memory().write_word(0x5000, 42);
+  cpu.get_memory().write_word(0x9000, 1);
+  cpu.step();
+  uint64_t after = hasher.update();
+  EXPECT_EQ(after, StateHasher::hash(cpu));
+  EXPECT_NE(after, before);
+
+  // Undoing the changes gives the old hash back
+  cpu.get_memory().write_word(0x5000, 0);
+  cpu.get_memory().write_word(0x9000, 0);
+  cpu.get_registers().write(1, 0);
+  cpu.get_registers().set_pc(0);
+  EXPECT_EQ(hasher.update(), before);
+}
+
+TEST(StateHashTest, LazyImagePagesHashWithoutCopyingIn) {
+  auto bytes = std::make_shared<std::vector<uint8_t>>(8 * Memory::PAGE_SIZE);
+  for (size_t i = 0; i < bytes->size(); ++i) (*bytes)[i] = static_cast<uint8_t>(i * 13);
+  CPU cpu;
+  cpu.get_memory().map_image(std::shared_ptr<const uint8_t>(bytes, bytes->data()), bytes->size(),
+                             0x40000);
+  ASSERT_EQ(cpu.get_memory().lazy_pages(), 8u);
+
+  StateHasher hasher(cpu);
+  uint64_t lazy = StateHasher::hash(cpu);
+  EXPECT_EQ(cpu.get_memory().lazy_pages(), 8u);
+
+  // Copying pages in leaves the hash alone; writing one changes it
+  CPU copied = cpu.fork();
+  for (address_t addr = 0x40000; addr < 0x48000; addr += Memory::PAGE_SIZE) {
+    copied.get_memory().read_word(addr);
+  }
+  ASSERT_EQ(copied.get_memory().lazy_pages(), 0u);
+  EXPECT_EQ(StateHasher::hash(copied), lazy);
+
+  cpu.get_memory().write_word(0x42000, 0);
+  EXPECT_EQ(hasher.update(), StateHasher::hash(cpu));
+  EXPECT_NE(hasher.update(), lazy);
+  EXPECT_EQ(cpu.get_memory().lazy_pages(), 7u);
+}
+
+TEST(StateHashTest, PagesWrittenAgainAreRehashed) {
+  CPU cpu;
+  StateHasher hasher(cpu);
+  for (word_t value = 1; value <= 3; ++value) {
+    cpu.get_memory().write_word(0x7000, value);
+    EXPECT_EQ(hasher.update(), StateHasher::hash(cpu));
+  }
+}
+
+TEST(StateHashTest, SameContentsHashAlikeHoweverTouched) {
+  CPU a;
+  CPU b;
+  b.get_memory().write_word(0x3000, 0);  // Allocates a page of zeros
+  EXPECT_EQ(StateHasher::hash(a), StateHasher::hash(b));
+
+  a.get_memory().write_word(0x3000, 5);
+  EXPECT_NE(StateHasher::hash(a), StateHasher::hash(b));
+  b.get_memory().write_word(0x3000, 5);
+  EXPECT_EQ(StateHasher::hash(a), StateHasher::hash(b));
+
+  // Same word at a different address is a different state
+  a.get_memory().write_word(0x3000, 0);
+  a.get_memory().write_word(0x3004, 5);
+  EXPECT_NE(StateHasher::hash(a), StateHasher::hash(b));
+}
+
+TEST(StateHashTest, RunHaltsOnRepeatedState) {
+  // r1 cycles 1, 2, 3, 0, ... with a store each time round, forever
+  CPU cpu;
+  cpu.load_program({
+    make_i_instruction(Opcode::ADDI, 1, 1, 1),      // loop:
+    make_i_instruction(Opcode::ANDI, 1, 1, 3),
+    make_i_instruction(Opcode::SW, 0, 1, 0x4000),
+    make_i_instruction(Opcode::BEQ, 0, 0, 0xFFFC),  // beq $0, $0, loop
+  });
+  cpu.set_loop_detection(true);
+  cpu.run(10000000);
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_TRUE(cpu.loop_detected());
+  EXPECT_LT(cpu.get_instruction_count(), 10000u);
+  EXPECT_EQ(cpu.get_registers().get_pc(), 0);
+
+  // Runs shorter than a sample interval find it at the same point
+  CPU chunked;
+  chunked.load_program({
+    make_i_instruction(Opcode::ADDI, 1, 1, 1),
+    make_i_instruction(Opcode::ANDI, 1, 1, 3),
+    make_i_instruction(Opcode::SW, 0, 1, 0x4000),
+    make_i_instruction(Opcode::BEQ, 0, 0, 0xFFFC),
+  });
+  chunked.set_loop_detection(true);
+  for (int i = 0; i < 1000 && !chunked.is_halted(); ++i) chunked.run(100);
+  EXPECT_TRUE(chunked.loop_detected());
+  EXPECT_EQ(chunked.get_instruction_count(), cpu.get_instruction_count());
+}
+
+TEST(StateHashTest, EndingAndProgressingLoopsAreNotFlagged) {
+  CPU cpu;
+  cpu.set_loop_detection(true);
+  cpu.load_program({
+    make_i_instruction(Opcode::ORI, 0, 1, 0xFFFF),  // Counts r1 down from 65535
+    make_i_instruction(Opcode::ADDI, 1, 1, 0xFFFF), // loop:
+    make_i_instruction(Opcode::BNE, 1, 0, 0xFFFE),
+    0x00000000
+  });
+  cpu.run();
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_FALSE(cpu.loop_detected());
+
+  // A counter that keeps going never repeats
+  cpu.reset();
+  cpu.load_program({make_i_instruction(Opcode::ADDI, 1, 1, 1), make_i_instruction(Opcode::BEQ, 0, 0, 0xFFFE)});
+  EXPECT_EQ(cpu.run(200000), 200000);
+  EXPECT_FALSE(cpu.is_halted());
+}
+
+TEST(StateHashTest, LoopCountingInDeviceRegisterIsNotFlagged) {
+  // Counts to 1000 in the DMA source register, with the registers the same
+  // at every backward branch
+  CPU cpu;
+  cpu.get_memory().map_device(DmaDevice::DEFAULT_BASE, Memory::PAGE_SIZE,
+                              std::make_shared<DmaDevice>());
+  cpu.set_loop_detection(true);
+  cpu.load_program({
+    make_i_instruction(Opcode::ORI, 0, 3, 1000),
+    make_i_instruction(Opcode::LW, 0, 1, 0xF000),   // loop:
+    make_i_instruction(Opcode::ADDI, 1, 1, 1),
+    make_i_instruction(Opcode::SW, 0, 1, 0xF000),
+    make_i_instruction(Opcode::BEQ, 1, 3, 2),       // beq $1, $3, done
+    make_i_instruction(Opcode::ANDI, 1, 1, 0),
+    make_i_instruction(Opcode::BEQ, 0, 0, 0xFFFA),  // beq $0, $0, loop
+    0x00000000                                      // done:
+  });
+  cpu.run();
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_FALSE(cpu.loop_detected());
+  EXPECT_EQ(cpu.get_memory().read_word(DmaDevice::DEFAULT_BASE + DmaDevice::SRC), 1000);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include "core/cpu.hpp"
+#include "core/state_hash.hpp"
+#include "core/time_parallel.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+// Sums 1..n into r11 through memory, storing each partial sum to its own word
+std::vector<word_t> sum_program(int16_t n) {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 8, n),
+    make_i_instruction(Opcode::ADDI, 9, 9, 4),        // loop:
+    make_r_instruction(11, 8, 11, 0, Funct::ADD),
+    make_i_instruction(Opcode::SW, 9, 11, 0x1000),
+    make_i_instruction(Opcode::LW, 9, 10, 0x1000),
+    make_i_instruction(Opcode::ADDI, 8, 8, -1),
+    make_i_instruction(Opcode::BNE, 8, 0, -6),
+    0x00000000
+  };
+}
+
+constexpr uint64_t sum_length(uint64_t n) { return 1 + 6 * n; }
+
+TimeParallelConfig small_config() {
+  TimeParallelConfig config;
+  config.segment_length = 1000;
+  config.warmup = 200;
+  config.threads = 4;
+  return config;
+}
+
+} // namespace
+
+TEST(TimeParallelTest, MatchesOneSequentialSegment) {
+  TimeParallelConfig sequential_config = small_config();
+  sequential_config.segment_length = sequential_config.max_instructions;
+  CPU sequential_cpu;
+  sequential_cpu.load_program(sum_program(2000));
+  TimeParallelResult sequential = TimeParallelSimulator::run(sequential_cpu, sequential_config);
+  EXPECT_EQ(sequential.segments, 1);
+  EXPECT_TRUE(sequential.halted);
+
+  CPU cpu;
+  cpu.load_program(sum_program(2000));
+  TimeParallelResult result = TimeParallelSimulator::run(cpu, small_config());
+  EXPECT_EQ(result.segments, sum_length(2000) / 1000 + 1);
+  EXPECT_EQ(result.mispredictions, 0);
+  EXPECT_EQ(result.checkpoints.size(), result.segments - 1);
+  EXPECT_TRUE(result.halted);
+
+  // Counts are exact; the warm-ups see enough history for cycles to match too
+  EXPECT_EQ(result.instructions, sum_length(2000));
+  EXPECT_EQ(result.stats.instructions, sequential.stats.instructions);
+  EXPECT_EQ(result.stage_busy, sequential.stage_busy);
+  EXPECT_EQ(result.stage_busy[static_cast<size_t>(ExecutionStage::MEMORY_ACCESS)], 2 * 2000);
+  EXPECT_EQ(result.stats.dcache_accesses, sequential.stats.dcache_accesses);
+  EXPECT_EQ(result.stats.cycles, sequential.stats.cycles);
+  EXPECT_EQ(StateHasher::hash(cpu), StateHasher::hash(sequential_cpu));
+  EXPECT_EQ(cpu.get_registers().read(11), 2000 * 2001 / 2);
+}
+
+TEST(TimeParallelTest, ReexecutesSegmentsWithWrongPredictions) {
+  CPU expected_cpu;
+  expected_cpu.load_program(sum_program(2000));
+  TimeParallelResult expected = TimeParallelSimulator::run(expected_cpu, small_config());
+
+  // Checkpoints of another program's run are at the right places but wrong
+  CPU other;
+  other.load_program(sum_program(1990));
+  TimeParallelResult stale = TimeParallelSimulator::run(other, small_config());
+
+  CPU cpu;
+  cpu.load_program(sum_program(2000));
+  TimeParallelResult result = TimeParallelSimulator::run(cpu, small_config(), stale.checkpoints);
+  EXPECT_EQ(result.mispredictions, stale.checkpoints.size());
+  EXPECT_EQ(result.instructions, expected.instructions);
+  EXPECT_EQ(result.stage_busy, expected.stage_busy);
+  EXPECT_EQ(StateHasher::hash(cpu), StateHasher::hash(expected_cpu));
+
+  // The validated checkpoints predict a repeat perfectly
+  CPU repeat;
+  repeat.load_program(sum_program(2000));
+  TimeParallelResult again = TimeParallelSimulator::run(repeat, small_config(), result.checkpoints);
+  EXPECT_EQ(again.mispredictions, 0);
+  EXPECT_EQ(again.stats.cycles, expected.stats.cycles);
+  EXPECT_EQ(again.instructions, expected.instructions);
+}
+
+TEST(TimeParallelTest, RejectsWarmupLongerThanSegment) {
+  CPU cpu;
+  cpu.load_program(sum_program(10));
+  TimeParallelConfig config = small_config();
+  config.warmup = config.segment_length + 1;
+  EXPECT_THROW(TimeParallelSimulator::run(cpu, config), std::invalid_argument);
+}
@@ -0,0 +1,312 @@
+#include <gtest/gtest.h>
+#include "core/time_travel.hpp"
+#include "core/dma.hpp"
+#include "instruction_encoding.hpp"
+
+using namespace ez_arch;
+
+namespace {
+
+// Counts r1 down from 50, storing each value to 0x2004, 0x2008, ...
+std::vector<word_t> countdown_program() {
+  return {
+    make_i_instruction(Opcode::ADDI, 0, 1, 50),
+    make_i_instruction(Opcode::ADDI, 2, 2, 4),       // loop:
+    make_i_instruction(Opcode::SW, 2, 1, 0x2000),
+    make_i_instruction(Opcode::ADDI, 1, 1, 0xFFFF),
+    make_i_instruction(Opcode::BNE, 1, 0, 0xFFFC),   // bne $1, $0, loop
+    0x00000000
+  };
+}
+
+constexpr uint64_t COUNTDOWN_LENGTH = 1 + 50 * 4;
+
+// Copies 16 bytes with the DMA controller, polling STATUS until DONE
+std::vector<word_t> dma_program() {
+  return {
+    make_i_instruction(Opcode::ORI, 0, 1, 0x1000),
+    make_i_instruction(Opcode::ORI, 0, 2, 0x3000),
+    make_i_instruction(Opcode::ORI, 0, 3, 16),
+    make_i_instruction(Opcode::SW, 0, 1, 0xF000),
+    make_i_instruction(Opcode::SW, 0, 2, 0xF004),
+    make_i_instruction(Opcode::SW, 0, 3, 0xF008),
+    make_i_instruction(Opcode::ORI, 0, 4, DmaDevice::START),
+    make_i_instruction(Opcode::SW, 0, 4, 0xF00C),
+    make_i_instruction(Opcode::LW, 0, 5, 0xF010),    // poll:
+    make_i_instruction(Opcode::ANDI, 5, 5, DmaDevice::DONE),
+    make_i_instruction(Opcode::BEQ, 5, 0, 0xFFFD),
+    0x00000000
+  };
+}
+
+void load_dma_program(CPU& cpu) {
+  cpu.get_memory().map_device(DmaDevice::DEFAULT_BASE, Memory::PAGE_SIZE,
+                              std::make_shared<DmaDevice>(DmaConfig{20, 1}));
+  cpu.load_program(dma_program());
+  cpu.get_memory().write_word(0x1000, 0x11223344);
+}
+
+struct State {
+  std::vector<word_t> registers;
+  uint64_t count;
+  ExecutionStage stage;
+  std::vector<word_t> words;
+
+  bool operator==(const State& other) const {
+    return registers == other.registers && count == other.count && stage == other.stage &&
+           words == other.words;
+  }
+};
+
+State capture(CPU& cpu) {
+  State state{{}, cpu.get_instruction_count(), cpu.get_current_stage(), {}};
+  for (register_id_t i = 0; i < RegisterFile::NUM_REGISTERS; ++i) {
+    state.registers.push_back(cpu.get_registers().read(i));
+  }
+  state.registers.push_back(cpu.get_registers().get_pc());
+  for (address_t addr = 0x2000; addr < 0x2100; addr += 4) {
+    state.words.push_back(cpu.get_memory().read_word(addr));
+  }
+  state.words.push_back(cpu.get_memory().read_word(0x3000));
+  state.words.push_back(cpu.get_memory().read_word(DmaDevice::DEFAULT_BASE + DmaDevice::STATUS));
+  return state;
+}
+
+// The state at every instruction boundary of a plain run
+std::vector<State> reference_states(CPU& cpu) {
+  std::vector<State> states{capture(cpu)};
+  while (!cpu.is_halted()) {
+    cpu.step();
+    if (!cpu.is_halted()) states.push_back(capture(cpu));
+  }
+  return states;
+}
+
+} // namespace
+
+TEST(TimeTravelTest, StepBackUndoesEachInstruction) {
+  CPU reference;
+  reference.load_program(countdown_program());
+  std::vector<State> expected = reference_states(reference);
+
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu);
+  for (int i = 0; i < 30; ++i) EXPECT_TRUE(history.step());
+  EXPECT_EQ(history.undo_depth(), 30);
+
+  for (uint64_t at = 29; at > 10; --at) {
+    ASSERT_TRUE(history.step_back());
+    EXPECT_EQ(capture(cpu), expected[at]) << "at instruction " << at;
+  }
+  ASSERT_TRUE(history.step_back(11));
+  EXPECT_EQ(capture(cpu), expected[0]);
+  EXPECT_FALSE(history.step_back());
+
+  // Going forward again reproduces the same run
+  EXPECT_EQ(history.run(), COUNTDOWN_LENGTH);
+  EXPECT_EQ(cpu.get_memory().read_word(0x2004), 50);
+  EXPECT_EQ(cpu.get_memory().read_word(0x20C8), 1);
+}
+
+TEST(TimeTravelTest, SeekReplaysFromNearestCheckpoint) {
+  CPU reference;
+  reference.load_program(countdown_program());
+  std::vector<State> expected = reference_states(reference);
+
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu, 16);
+  EXPECT_EQ(history.run(), COUNTDOWN_LENGTH);
+  EXPECT_EQ(history.last(), COUNTDOWN_LENGTH);
+  EXPECT_EQ(history.checkpoint_count(), 1 + COUNTDOWN_LENGTH / 16);
+
+  for (uint64_t at : {37u, 5u, 200u, 0u, 128u, 129u}) {
+    ASSERT_TRUE(history.seek(at));
+    EXPECT_EQ(capture(cpu), expected[at]) << "at instruction " << at;
+  }
+
+  // Stepping back after a seek replays instead of undoing
+  ASSERT_TRUE(history.step_back(3));
+  EXPECT_EQ(capture(cpu), expected[126]);
+
+  // Forward execution from the middle truncates the old future
+  history.step();
+  EXPECT_EQ(history.last(), 127);
+  EXPECT_FALSE(history.seek(COUNTDOWN_LENGTH + 10));
+  EXPECT_TRUE(cpu.is_halted());
+  EXPECT_EQ(history.last(), COUNTDOWN_LENGTH);
+}
+
+TEST(TimeTravelTest, ThinsCheckpointsOnLongRuns) {
+  CPU reference;
+  reference.load_program(countdown_program());
+  std::vector<State> expected = reference_states(reference);
+
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu, 4, 8);
+  history.run();
+  EXPECT_LE(history.checkpoint_count(), 8);
+  EXPECT_GT(history.interval(), 4);
+
+  for (uint64_t at : {100u, 3u, 199u}) {
+    ASSERT_TRUE(history.seek(at));
+    EXPECT_EQ(capture(cpu), expected[at]) << "at instruction " << at;
+  }
+}
+
+TEST(TimeTravelTest, ReverseContinueStopsAtLatestMatch) {
+  CPU reference;
+  reference.load_program(countdown_program());
+  std::vector<State> expected = reference_states(reference);
+
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu, 16);
+  history.run();
+
+  auto r1_is_10 = [](const CPU& c) { return c.get_registers().read(1) == 10; };
+  ASSERT_TRUE(history.reverse_continue(r1_is_10));
+  uint64_t hit = history.position();
+  EXPECT_EQ(cpu.get_registers().read(1), 10);
+  EXPECT_EQ(capture(cpu), expected[hit]);
+  EXPECT_NE(expected[hit + 1].registers[1], 10);
+
+  // Already matching here: goes to the previous match
+  ASSERT_TRUE(history.reverse_continue(r1_is_10));
+  EXPECT_EQ(history.position(), hit - 1);
+
+  State before = capture(cpu);
+  EXPECT_FALSE(history.reverse_continue([](const CPU& c) { return c.get_registers().read(1) == 99; }));
+  EXPECT_EQ(capture(cpu), before);
+}
+
+TEST(TimeTravelTest, DeviceAccessFallsBackToReplay) {
+  CPU reference;
+  load_dma_program(reference);
+  std::vector<State> expected = reference_states(reference);
+  ASSERT_EQ(reference.get_memory().read_word(0x3000), 0x11223344);
+
+  CPU cpu;
+  load_dma_program(cpu);
+  TimeTravel history(cpu);
+  while (history.step()) {
+  }
+  EXPECT_EQ(capture(cpu).words, capture(reference).words);
+
+  // Device stores and polls are never in the undo log, so this replays and
+  // the controller is back to its earlier state too
+  for (uint64_t at = expected.size() - 1; at > 0; --at) {
+    ASSERT_TRUE(history.seek(at - 1));
+    EXPECT_EQ(capture(cpu), expected[at - 1]) << "at instruction " << at - 1;
+  }
+}
+
+TEST(TimeTravelTest, RunStopsAfterWatchedWrite) {
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu, 16);
+  history.run();
+
+  // Watches set now still apply after seeking back past checkpoints
+  cpu.get_memory().add_watch(0x2010, 4);
+  ASSERT_TRUE(history.seek(2));
+  EXPECT_FALSE(cpu.get_memory().watch_hit());
+
+  history.run();
+  EXPECT_FALSE(cpu.is_halted());
+  ASSERT_TRUE(cpu.get_memory().watch_hit());
+  EXPECT_EQ(cpu.get_memory().watch_hit()->addr, 0x2010);
+  EXPECT_EQ(cpu.get_memory().read_word(0x2010), 47);  // Fourth iteration's store
+  EXPECT_EQ(history.position(), 1 + 3 * 4 + 2);  // Stopped right after the store
+
+  history.run();
+  EXPECT_TRUE(cpu.is_halted());
+}
+
+TEST(TimeTravelTest, PatchCodeKeepsHistoryBeforeFirstFetch) {
+  std::vector<word_t> appended = countdown_program();
+  appended.back() = make_i_instruction(Opcode::ADDI, 3, 3, 7);
+  appended.push_back(0x00000000);
+  std::vector<word_t> shortened = appended;
+  shortened[0] = make_i_instruction(Opcode::ADDI, 0, 1, 10);
+
+  CPU reference;
+  reference.load_program(appended);
+  std::vector<State> expected = reference_states(reference);
+  CPU shortened_reference;
+  shortened_reference.load_program(shortened);
+  std::vector<State> expected_shortened = reference_states(shortened_reference);
+
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu, 16);
+  history.set_fetch_tracking(true);
+  EXPECT_EQ(history.run(), COUNTDOWN_LENGTH);
+
+  // The halt was fetched last, so the whole run still holds
+  EXPECT_EQ(history.patch_code(0x14, {appended[5], appended[6]}), COUNTDOWN_LENGTH);
+  EXPECT_FALSE(cpu.is_halted());
+  EXPECT_EQ(history.position(), COUNTDOWN_LENGTH);
+  EXPECT_EQ(history.run(), 1);
+  EXPECT_EQ(capture(cpu), expected.back());
+  ASSERT_TRUE(history.seek(50));
+  EXPECT_EQ(capture(cpu), expected[50]);
+
+  // Unchanged words do not count as edits
+  EXPECT_EQ(history.patch_code(0x04, {appended[1]}), history.last());
+
+  // The first instruction changes everything after it
+  EXPECT_EQ(history.patch_code(0x00, {shortened[0]}), 0);
+  EXPECT_EQ(history.position(), 0);
+  history.run();
+  EXPECT_EQ(capture(cpu), expected_shortened.back());
+  ASSERT_TRUE(history.seek(7));
+  EXPECT_EQ(capture(cpu), expected_shortened[7]);
+}
+
+TEST(TimeTravelTest, StageStepsRecordFetchesForPatchCode) {
+  std::vector<word_t> shortened = countdown_program();
+  shortened[0] = make_i_instruction(Opcode::ADDI, 0, 1, 10);
+  CPU reference;
+  reference.load_program(shortened);
+  reference.run();
+
+  CPU cpu;
+  cpu.load_program(countdown_program());
+  TimeTravel history(cpu);
+  history.set_fetch_tracking(true);
+  for (int i = 0; i < 7; ++i) ASSERT_TRUE(history.step_stage());  // Into the second instruction
+  ASSERT_EQ(history.position(), 1);
+  ASSERT_NE(cpu.get_current_stage(), ExecutionStage::FETCH);
+
+  // The first instruction already ran with the old immediate
+  EXPECT_EQ(history.patch_code(0x00, {shortened[0]}), 0);
+  EXPECT_EQ(history.position(), 0);
+  EXPECT_EQ(cpu.get_current_stage(), ExecutionStage::FETCH);
+  history.run();
+  EXPECT_EQ(capture(cpu), capture(reference));
+}
+
+TEST(TimeTravelTest, LoopDetectionSpansCheckpointIntervals) {
+  // r1 cycles 1, 2, 3, 0, ... with a store each time round, forever
+  std::vector<word_t> program = {
+    make_i_instruction(Opcode::ADDI, 1, 1, 1),
+    make_i_instruction(Opcode::ANDI, 1, 1, 3),
+    make_i_instruction(Opcode::SW, 0, 1, 0x4000),
+    make_i_instruction(Opcode::BEQ, 0, 0, 0xFFFC),
+  };
+  CPU reference;
+  reference.load_program(program);
+  reference.set_loop_detection(true);
+  reference.run();
+  ASSERT_TRUE(reference.loop_detected());
+
+  CPU cpu;
+  cpu.load_program(program);
+  cpu.set_loop_detection(true);
+  TimeTravel history(cpu, 100);  // Shorter than a loop detection sample
+  EXPECT_EQ(history.run(), reference.get_instruction_count());
+  EXPECT_TRUE(cpu.loop_detected());
+}